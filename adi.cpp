@@ -1,17 +1,32 @@
 #include <cstdio>
 #include <cstdlib>
+#include <csignal>
 #include "utility/common.h"
 #include <unistd.h>
 #include <time.h>
 #include "math/qmath.h"
 
+#ifndef ADI_HEADLESS
 #include "bcm_host.h"
+#endif
 
 #include "GLES2/gl2.h"
 #include "EGL/egl.h"
 #include "EGL/eglext.h"
 
+#include "platform.h"
 #include "mqtt.h"
+#include "dcsbios.h"
+#include "recorder.h"
+#include "latency.h"
+#include "sphere.h"
+#include "sphere_mesh.h"	// generated, see Makefile
+#include "pacing.h"
+#include "texture.h"
+#include "balldiff.h"
+#include "layer.h"
+#include "utility/log.h"
+#include "utility/clock.h"
 
 #define STBI_ONLY_PNG
 #include "nanovg/src/stb_image.h"
@@ -19,18 +34,15 @@
 #define NANOVG_GLES2_IMPLEMENTATION
 #include "nanovg/src/nanovg_gl.h"
 
-extern "C" {
-#include "revision.h"
-}
-
-
 struct AppState
 {
 	// dispmanx / EGL objects
 	u32 		screenWidth;
 	u32 		screenHeight;
+#ifndef ADI_HEADLESS
 	DISPMANX_DISPLAY_HANDLE_T dispmanDisplay;
 	DISPMANX_ELEMENT_HANDLE_T dispmanElement;
+#endif
 	EGLDisplay 	display;
 	EGLSurface 	surface;
 	EGLContext 	context;
@@ -38,11 +50,8 @@ struct AppState
 	GLuint 		vShader;
 	GLuint 		fShader;
 	GLuint 		program;
-	GLuint 		fbo;
-	GLuint 		renderTex;
 	// shader attribs and uniforms
 	GLint 		attrVertexPosition;
-	GLint 		attrVertexNormal;
 	GLint 		attrVertexUV;
 	GLint 		unifModelView;
 	GLint 		unifModelViewProj;
@@ -50,138 +59,100 @@ struct AppState
 	GLint 		unifCameraPos;
 	GLint 		unifDiffuseColor;
 	GLint 		unifDiffuseTex;
+	// procedural ball shader, see drawBallProcedural
+	GLuint 		ballVShader;
+	GLuint 		ballFShader;
+	GLuint 		ballProgram;
+	GLint 		attrBallCorner;
+	GLint 		unifBallQuadToClip;
+	GLint 		unifBallViewToModel;
+	GLint 		unifBallCenter;
+	GLint 		unifBallRadius;
+	GLint 		unifBallCameraPos;
 	// texture buffers
-	GLuint 		texBackupADI;
+	Texture		texBackupADI;
 	// NanoVG state
 	NVGcontext*	vg;
 	i32 		fontNormal;
 	i32 		fontBold;
 	i32 		fontIcons;
+	StaticLayer	staticVector;		// artwork that never changes, see drawStaticVector
 };
 
 
 struct TimeState
 {
-	timespec	tsNow;
 	u64			now_nsec;
 	u64			prev_nsec;
 	r32			dt_ms;
-	r32			fps;
+	r32			fps;			// presented frames per second
+	u32			fpsFrames;		// presented since fpsPrev_nsec
 	u64			fpsPrev_nsec;
 };
 
 
+enum BallRenderer : u8
+{
+	Ball_Mesh = 0,		// tessellated sphere sampling backup_adi.png
+	Ball_Procedural		// one quad, ray-sphere intersection and markings in the fragment shader
+};
+
+
+enum InputSource : u8
+{
+	Input_MQTT = 0,		// DCS-BIOS values relayed through the mosquitto broker
+	Input_DCSBIOS,		// DCS-BIOS export stream received directly over UDP multicast
+	Input_Replay		// capture file made with --record, no network
+};
+
+
+struct AppOptions
+{
+	InputSource	input;
+	const char*	recordFile;		// capture MQTT messages to this file, or nullptr
+	const char*	replayFile;
+	r32			replaySpeed;	// 1 = recorded timing, 0 = as fast as possible
+	bool		exitAfterReplay;
+	u32			maxFrames;		// exit after this many frames, 0 = run until signaled
+	bool		latencyOverlay;
+	u32			latencyDumpSec;	// log latency histograms this often, 0 = off
+	PacingMode	pacing;
+	u32			swapInterval;	// vblanks per frame in vsync mode
+	r32			fixedHz;		// frame rate in fixed mode
+	r32			sampleDelay_ms;	// vsync mode, delay input sampling after the swap returns
+	bool		skipUnchanged;	// don't draw or swap frames identical to the one on screen
+	i32			lodLevel;		// ball level of detail, -1 = pick from the on-screen size
+	r32			lodMaxError_px;	// facet error allowed when picking the level
+	TextureQuality texQuality;
+	BallRenderer ballRenderer;
+	bool		ballDiff;		// render both ways every frame and report the pixel difference
+	bool		retainedVector;	// record static NanoVG artwork once and composite it each frame
+	bool		tessCache;		// reuse NanoVG path tessellation across frames, see nvgTessellationCache
+	bool		vectorBatch;	// merge NanoVG calls with the same paint into single draws, NVG_BATCH_CALLS
+	bool		sdfText;		// distance field glyphs, one per glyph for every size, NVG_SDF_TEXT
+#ifdef ADI_HEADLESS
+	u32			headlessWidth;
+	u32			headlessHeight;
+	u32			dumpEvery;		// write every Nth frame to dumpDir, 0 = off
+	const char*	dumpDir;
+#endif
+};
+
+
 volatile bool running = true;
+AppOptions options{};
 AppState state{};
 TimeState timer{};
 MQTTState mqttState{};
+LatencyTracker latency;
+FramePacer pacer;
 
 
 bool initOpenGL()
 {
-	static EGL_DISPMANX_WINDOW_T nativeWindow;
-
-	static const EGLint attributeList[] =
-	{
-		EGL_RED_SIZE,		8,
-		EGL_GREEN_SIZE,		8,
-		EGL_BLUE_SIZE,		8,
-		EGL_ALPHA_SIZE,		8,
-		EGL_DEPTH_SIZE,		0,
-		EGL_STENCIL_SIZE,	0,
-		EGL_SURFACE_TYPE,	EGL_WINDOW_BIT,
-		EGL_SAMPLE_BUFFERS,	1,
-		EGL_SAMPLES,		4, // 4x MSAA
-		EGL_MIN_SWAP_INTERVAL, 0,
-		EGL_NONE
-	};
-
-	static const EGLint contextAttributes[] = 
-	{
-		EGL_CONTEXT_CLIENT_VERSION, 2,
-		EGL_NONE
-	};
-
-	// get an EGL display connection
-	state.display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
-	assert(state.display != EGL_NO_DISPLAY);
-
-	// initialize the EGL display connection
-	EGLBoolean result = eglInitialize(state.display, nullptr, nullptr);
-	assert(result != EGL_FALSE);
-
-	// get an appropriate EGL frame buffer configuration
-	EGLConfig config;
-	EGLint numConfig;
-	result = eglChooseConfig(
-		state.display,
-		attributeList,
-		&config,
-		1,
-		&numConfig);
-	assert(result != EGL_FALSE);
-
-	// get an appropriate EGL frame buffer configuration
-	result = eglBindAPI(EGL_OPENGL_ES_API);
-	assert(result != EGL_FALSE);
-
-	// create an EGL rendering context
-	state.context = eglCreateContext(
-		state.display,
-		config,
-		EGL_NO_CONTEXT,
-		contextAttributes);
-	assert(state.context != EGL_NO_CONTEXT);
-
-	// create an EGL window surface
-	i32 success = graphics_get_display_size(
-		0, // LCD
-		&state.screenWidth,
-		&state.screenHeight);
-	assert(success >= 0);
-
-	VC_RECT_T dstRect{};
-	dstRect.x = 0;
-	dstRect.y = 0;
-	dstRect.width = state.screenWidth;
-	dstRect.height = state.screenHeight;
-	
-	VC_RECT_T srcRect{};
-	srcRect.x = 0;
-	srcRect.y = 0;
-	srcRect.width = state.screenWidth << 16;
-	srcRect.height = state.screenHeight << 16;        
-
-	state.dispmanDisplay = vc_dispmanx_display_open(0); // LCD
-	DISPMANX_UPDATE_HANDLE_T dispmanUpdate = vc_dispmanx_update_start(0);
-			
-	state.dispmanElement = vc_dispmanx_element_add(
-		dispmanUpdate,
-		state.dispmanDisplay,
-		0, // layer
-		&dstRect,
-		0, // src
-		&srcRect,
-		DISPMANX_PROTECTION_NONE,
-		nullptr, // alpha
-		nullptr, // clamp
-		(DISPMANX_TRANSFORM_T)0); // transform
-		
-	nativeWindow.element = state.dispmanElement;
-	nativeWindow.width = state.screenWidth;
-	nativeWindow.height = state.screenHeight;
-	vc_dispmanx_update_submit_sync(dispmanUpdate);
-	
-	state.surface = eglCreateWindowSurface(
-		state.display,
-		config,
-		&nativeWindow,
-		nullptr);
-	assert(state.surface != EGL_NO_SURFACE);
-
-	// connect the context to the surface
-	result = eglMakeCurrent(state.display, state.surface, state.surface, state.context);
-	assert(result != EGL_FALSE);
+	if (!initDisplay()) {
+		return false;
+	}
 
 	// Set background color and clear buffers
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -190,28 +161,6 @@ bool initOpenGL()
 	// Enable back face culling.
 	glEnable(GL_CULL_FACE);
 
-	// create a texture
-	glGenTextures(1, &state.renderTex);
-	glBindTexture(GL_TEXTURE_2D,state.renderTex);
-	glTexImage2D(
-		GL_TEXTURE_2D,
-		0,
-		GL_RGB,
-		state.screenWidth,
-		state.screenHeight,
-		0,
-		GL_RGB,
-		GL_UNSIGNED_SHORT_5_6_5,
-		0);
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	
-	// create the FBO
-	glGenFramebuffers(1, &state.fbo);
-	glBindFramebuffer(GL_FRAMEBUFFER,state.fbo);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, state.renderTex, 0);
-	glBindFramebuffer(GL_FRAMEBUFFER,0);
-
 	glViewport(0, 0, (GLsizei)state.screenWidth, (GLsizei)state.screenHeight);
 
 	ASSERT_GL_ERROR;
@@ -238,6 +187,47 @@ void showProgramLog(
 }
 
 
+bool buildProgram(
+	const GLchar* vShaderSource,
+	const GLchar* fShaderSource,
+	GLuint& vShader,
+	GLuint& fShader,
+	GLuint& program)
+{
+	GLint status = GL_FALSE;
+
+	vShader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vShader, 1, &vShaderSource, 0);
+	glCompileShader(vShader);
+	glGetShaderiv(vShader, GL_COMPILE_STATUS, &status);
+	if (status != GL_TRUE) {
+		showShaderLog(vShader);
+		return false;
+	}
+
+	fShader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fShader, 1, &fShaderSource, 0);
+	glCompileShader(fShader);
+	glGetShaderiv(fShader, GL_COMPILE_STATUS, &status);
+	if (status != GL_TRUE) {
+		showShaderLog(fShader);
+		return false;
+	}
+
+	program = glCreateProgram();
+	glAttachShader(program, vShader);
+	glAttachShader(program, fShader);
+	glLinkProgram(program);
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE) {
+		showProgramLog(program);
+		return false;
+	}
+
+	return true;
+}
+
+
 bool initShaders()
 {
 	const GLchar *vShaderSource =
@@ -247,8 +237,7 @@ bool initShaders()
 		"uniform mat4 modelViewProj;"
 		"uniform mat4 normalMatrix;"		// inverse transpose of upper-left 3x3 of modelView"
 		// Input Variables
-		"attribute vec3 vertexPosition;"	// in modelspace
-		"attribute vec3 vertexNormal;"
+		"attribute vec3 vertexPosition;"	// unit sphere in modelspace, scaled by modelView
 		"attribute vec2 vertexUV;"
 		// Output Variables
 		"varying vec4 positionViewspace;"
@@ -257,13 +246,14 @@ bool initShaders()
 
 		"void main() {"
 			"positionViewspace = modelView * vec4(vertexPosition, 1.0);"
-			"normalViewspace = normalize(normalMatrix * vec4(vertexNormal, 0.0)).xyz;"
+			"normalViewspace = normalize(normalMatrix * vec4(vertexPosition, 0.0)).xyz;"
 			"uv = vertexUV;"
 			"gl_Position = modelViewProj * vec4(vertexPosition, 1.0);"
 		"}";
 
 	const GLchar *fShaderSource =
 		"#version 100\n"
+		"precision mediump float;"
 		// Uniforms
 		"uniform sampler2D diffuseTex;"
 		"uniform vec3 cameraPos;"
@@ -278,38 +268,11 @@ bool initShaders()
 			"gl_FragColor = vec4(diffuse * lightIntensity, 1.0);"
 		"}";
 
-	GLint status = GL_FALSE;
-
-	state.vShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(state.vShader, 1, &vShaderSource, 0);
-	glCompileShader(state.vShader);
-	glGetShaderiv(state.vShader, GL_COMPILE_STATUS, &status);
-	if (status != GL_TRUE) {
-		showShaderLog(state.vShader);
-		return false;
-	}
-
-	state.fShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(state.fShader, 1, &fShaderSource, 0);
-	glCompileShader(state.fShader);
-	glGetShaderiv(state.fShader, GL_COMPILE_STATUS, &status);
-	if (status != GL_TRUE) {
-		showShaderLog(state.fShader);
-		return false;
-	}
-
-	state.program = glCreateProgram();
-	glAttachShader(state.program, state.vShader);
-	glAttachShader(state.program, state.fShader);
-	glLinkProgram(state.program);
-	glGetProgramiv(state.program, GL_LINK_STATUS, &status);
-	if (status != GL_TRUE) {
-		showProgramLog(state.program);
+	if (!buildProgram(vShaderSource, fShaderSource, state.vShader, state.fShader, state.program)) {
 		return false;
 	}
 
 	state.attrVertexPosition = glGetAttribLocation(state.program, "vertexPosition");
-	state.attrVertexNormal   = glGetAttribLocation(state.program, "vertexNormal");
 	state.attrVertexUV       = glGetAttribLocation(state.program, "vertexUV");
 
 	state.unifModelView     = glGetUniformLocation(state.program, "modelView");
@@ -325,30 +288,136 @@ bool initShaders()
 }
 
 
-void cleanupOpenGL()
+/**
+ * The ball without a mesh or texture. A screen-aligned quad covers the ball's silhouette, which is
+ * an exact circle under the orthographic projection, and each fragment finds its point on the
+ * sphere analytically. The model space direction is mapped to the same uv the mesh uses, and the
+ * markings of backup_adi.png are rebuilt in its 2048x512 texel space:
+ *	sky left of texel x 1024, ground right of it
+ *	a mark every 5 degrees of pitch, every 2048/72 texels, 4 texels wide
+ *	0 and 180 degrees, horizon, white dashes between y 108 and 409, the 0 degree one on a dark strip
+ *	+-90 degrees, full height lines
+ *	10 degrees, y 135 to 382
+ *	5 degrees, y 235 to 282
+ * black on sky, white on ground. The pitch numerals and CLIMB/DIVE lettering are not drawn.
+ */
+bool initBallShader()
 {
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-	eglSwapBuffers(state.display, state.surface);
+	const GLchar *vShaderSource =
+		"#version 100\n"
+		// Uniforms
+		"uniform mat4 quadToClip;"			// unit quad to the ball's screen square
+		// Input Variables
+		"attribute vec2 vertexCorner;"
+		// Output Variables
+		"varying vec2 corner;"
+
+		"void main() {"
+			"corner = vertexCorner;"
+			"gl_Position = quadToClip * vec4(vertexCorner, 0.0, 1.0);"
+		"}";
+
+	const GLchar *fShaderSource =
+		"#version 100\n"
+		"#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+		"precision highp float;\n"			// texel positions need more than mediump's 10 bits
+		"#else\n"
+		"precision mediump float;\n"
+		"#endif\n"
+		// Uniforms
+		"uniform mat3 viewToModel;"			// rotation only, inverse of the modelView rotation
+		"uniform vec3 center;"				// ball center in viewspace
+		"uniform float radius;"
+		"uniform vec3 cameraPos;"
+		// Input Variables
+		"varying vec2 corner;"				// viewspace xy relative to the center, over radius
+
+		"const float PI = 3.14159265;"
+		"const float MARK_SPACING = 2048.0 / 72.0;"
+		"const vec3 SKY = vec3(0.671, 0.737, 0.780);"
+		"const vec3 GROUND = vec3(0.012);"
+		"const vec3 SKY_MARK = vec3(0.0);"
+		"const vec3 GROUND_MARK = vec3(0.980, 0.996, 0.980);"
+
+		"void main() {"
+			"float r2 = dot(corner, corner);"
+			"if (r2 > 1.0) { discard; }"
+			"vec3 normal = vec3(corner, sqrt(1.0 - r2));"	// front facing hemisphere
+			"vec3 dir = viewToModel * normal;"
+			"if (abs(dir.x) > 0.70710678) { discard; }"		// mesh covers +-45 degrees of longitude
+
+			"float x = fract(atan(dir.y, dir.z) / (2.0 * PI) + 1.0) * 2048.0;"
+			"float y = (asin(dir.x) / (0.5 * PI) + 0.5) * 512.0;"
+
+			"bool sky = (x < 1024.0);"
+			"vec3 color = (sky ? SKY : GROUND);"
+			"vec3 mark = (sky ? SKY_MARK : GROUND_MARK);"
+
+			"float k = floor(x / MARK_SPACING + 0.5);"
+			"float dx = abs(x - k * MARK_SPACING);"
+			"k = mod(k, 72.0);"
+			"if (mod(k + 0.5, 36.0) < 1.0) {"				// horizon
+				"if (dx < 3.0 && y >= 108.0 && y < 409.0 && mod(y - 108.0, 54.8) < 27.0) {"
+					"color = GROUND_MARK;"
+				"}"
+				"else if (dx < 3.0 && k < 1.0) {"
+					"color = GROUND;"
+				"}"
+			"}"
+			"else if (dx < 2.0) {"
+				"if (mod(k + 0.5, 36.0) < 19.0 && mod(k + 0.5, 36.0) > 18.0) {"
+					"color = mark;"
+				"}"
+				"else if (mod(k, 2.0) < 0.5 ? (y >= 135.0 && y < 382.0) : (y >= 235.0 && y < 282.0)) {"
+					"color = mark;"
+				"}"
+			"}"
+
+			// same lighting as the mesh shader
+			"vec3 positionViewspace = center + normal * radius;"
+			"float lightIntensity = dot(normalize(cameraPos - positionViewspace), normal);"
+			"gl_FragColor = vec4(color * lightIntensity, 1.0);"
+		"}";
+
+	if (!buildProgram(vShaderSource, fShaderSource, state.ballVShader, state.ballFShader, state.ballProgram)) {
+		return false;
+	}
+
+	state.attrBallCorner = glGetAttribLocation(state.ballProgram, "vertexCorner");
+
+	state.unifBallQuadToClip  = glGetUniformLocation(state.ballProgram, "quadToClip");
+	state.unifBallViewToModel = glGetUniformLocation(state.ballProgram, "viewToModel");
+	state.unifBallCenter      = glGetUniformLocation(state.ballProgram, "center");
+	state.unifBallRadius      = glGetUniformLocation(state.ballProgram, "radius");
+	state.unifBallCameraPos   = glGetUniformLocation(state.ballProgram, "cameraPos");
 
-	eglDestroySurface(state.display, state.surface);
+	ASSERT_GL_ERROR;
+
+	return true;
+}
 
-	DISPMANX_UPDATE_HANDLE_T dispmanUpdate = vc_dispmanx_update_start(0);
-	int s = vc_dispmanx_element_remove(dispmanUpdate, state.dispmanElement);
-	assert(s == 0);
-	vc_dispmanx_update_submit_sync(dispmanUpdate);
-	s = vc_dispmanx_display_close(state.dispmanDisplay);
-	assert(s == 0);
 
-	// Release OpenGL resources
-	eglMakeCurrent(state.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
-	eglDestroyContext(state.display, state.context);
-	eglTerminate(state.display);
+void cleanupOpenGL()
+{
+	cleanupDisplay();
 }
 
 
 bool initNanoVG()
 {
-	state.vg = nvgCreateGLES2(NVG_ANTIALIAS | NVG_STENCIL_STROKES);
+	int flags = NVG_ANTIALIAS | NVG_STENCIL_STROKES;
+	if (options.vectorBatch) {
+		flags |= NVG_BATCH_CALLS;
+	}
+	if (options.sdfText) {
+		flags |= NVG_SDF_TEXT;
+	}
+	state.vg = nvgCreateGLES2(flags);
+	if (!state.vg) {
+		fprintf(stderr, "Could not create the NanoVG context\n");
+		return false;
+	}
+	nvgTessellationCache(state.vg, options.tessCache);
 
 	return true;
 }
@@ -356,37 +425,25 @@ bool initNanoVG()
 
 void cleanupNanoVG()
 {
+	freeStaticLayer(state.staticVector);
 	nvgDeleteGLES2(state.vg);
 }
 
 
 bool loadTextures()
 {
-	int w, h, n;
-	const char* adiBackupFilename = "backup_adi.png";
+	const char* ktxFilename = "backup_adi.ktx";
+	const char* pngFilename = "backup_adi.png";
+	Texture& tex = state.texBackupADI;
 
-	uint8_t* img = stbi_load(adiBackupFilename, &w, &h, &n, 3);
-	if (img == nullptr) {
-		fprintf(stderr, "Texture load failed: %s - %s\n", adiBackupFilename, stbi_failure_reason());
+	if (!loadTexture(ktxFilename, pngFilename, options.texQuality, tex)) {
 		return false;
 	}
 
-	glGenTextures(1, &state.texBackupADI);
-	glBindTexture(GL_TEXTURE_2D, state.texBackupADI);
-	glTexImage2D(
-		GL_TEXTURE_2D,
-		0,					// level
-		GL_RGB,				// internal format
-		w, h,				// width, height
-		0,					// border
-		GL_RGB,				// format
-		GL_UNSIGNED_BYTE,	// type
-		img);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	stbi_image_free(img);
+	printf("Texture %s: %ux%u %s, tier %u, %u levels, %u bytes, filter %s\n",
+		   (tex.compressed ? ktxFilename : pngFilename),
+		   tex.width, tex.height, (tex.compressed ? "ETC1" : "RGB"), options.texQuality.tier,
+		   tex.levels, tex.bytes, textureFilterName(options.texQuality.filter));
 
 	return true;
 }
@@ -394,7 +451,7 @@ bool loadTextures()
 
 void freeTextures()
 {
-	glDeleteTextures(1, &state.texBackupADI);
+	freeTexture(state.texBackupADI);
 }
 
 
@@ -449,44 +506,164 @@ void drawLabel(
 	nvgText(state.vg, x, y+h*0.5f, text, nullptr);
 }
 
-void drawPitchLadder()
+/**
+ * Rows covered by the static vector layer, the pitch ladder line and its antialiasing fringe. Grow
+ * it as markings are added, composite cost scales with the area.
+ */
+#define STATIC_VECTOR_HEIGHT		4
+
+void drawPitchLadder(
+	NVGcontext* vg)
+{
+	nvgBeginPath(vg);
+	nvgMoveTo(vg, -0.5f, 0.5f);
+	nvgLineTo(vg, 0.6f, 0.5f);
+	nvgStrokeColor(vg, nvgRGBA(255,255,255,255));
+	nvgStroke(vg);
+}
+
+
+/**
+ * The NanoVG artwork that does not move with the ball or change with the data. With
+ * --vector retained it is drawn once into state.staticVector, otherwise every frame. Everything
+ * it draws must stay inside STATIC_VECTOR_HEIGHT rows from the top of the screen.
+ */
+void drawStaticVector(
+	NVGcontext* vg)
 {
-	nvgBeginPath(state.vg);
-	nvgMoveTo(state.vg, -0.5f, 0.5f);
-	nvgLineTo(state.vg, 0.6f, 0.5f);
-	nvgStrokeColor(state.vg, nvgRGBA(255,255,255,255));
-	nvgStroke(state.vg);
+	drawPitchLadder(vg);
 }
 
 
+void printStaticVectorSummary()
+{
+	const StaticLayer& layer = state.staticVector;
+	if (layer.records == 0) {
+		return;
+	}
+
+	printf("Static vector: %ux%u layer recorded %u times, %.2f ms the last time\n",
+		   layer.width, layer.height, layer.records, (r64)layer.record_nsec * 1e-6);
+}
+
+
+void printTessCacheSummary()
+{
+	int hits = 0, misses = 0, bypassed = 0;
+	nvgTessellationCacheStats(state.vg, &hits, &misses, &bypassed);
+	if (hits + misses + bypassed == 0) {
+		return;
+	}
+
+	printf("Tessellation cache: %d paths reused, %d tessellated into the cache, %d not cacheable\n",
+		   hits, misses, bypassed);
+}
+
+
+void printVectorStreamSummary()
+{
+	NVGLstreamStats stream;
+	nvglStreamStatsGLES2(state.vg, &stream);
+	if (stream.flushes == 0) {
+		return;
+	}
+
+	printf("Vector streaming: %d flushes, %.1f KB mean, %.1f KB max per flush, %d buffer allocations, "
+		   "upload %.1f us mean, %.1f us max, %d over %.1f ms\n",
+		   stream.flushes,
+		   (r64)stream.bytes / (r64)stream.flushes / 1024.0,
+		   (r64)stream.maxBytes / 1024.0,
+		   stream.reallocs,
+		   (r64)stream.uploadNsec / (r64)stream.flushes * 1e-3,
+		   (r64)stream.maxUploadNsec * 1e-3,
+		   stream.slowUploads, NANOVG_GL_SLOW_UPLOAD_NSEC * 1e-6);
+	if (stream.fenced) {
+		printf("Vertex ring: %d of %d slots reused before the GPU was done with them\n",
+			   stream.stalls, stream.flushes);
+	}
+	else {
+		printf("Vertex ring: no fence sync, stalls not measured\n");
+	}
+}
+
+
+void printVectorDrawSummary()
+{
+	NVGLdrawStats draw;
+	nvglDrawStatsGLES2(state.vg, &draw);
+	if (draw.flushes == 0) {
+		return;
+	}
+
+	printf("Vector draws: %.1f calls, %.1f batches, %.1f draws per flush, "
+		   "%d uniform uploads, %d skipped, %d flushes too large to batch\n",
+		   (r64)draw.calls / (r64)draw.flushes,
+		   (r64)draw.batches / (r64)draw.flushes,
+		   (r64)draw.draws / (r64)draw.flushes,
+		   draw.uniformUploads, draw.uniformsSkipped, draw.unbatchedFlushes);
+}
+
+
+void printTextAtlasSummary()
+{
+	int uploads = 0, texels = 0;
+	nvgTextAtlasStats(state.vg, &uploads, &texels);
+	if (uploads == 0) {
+		return;
+	}
+
+	printf("Text atlas: %s glyphs, %d texture updates, %.1f KB uploaded\n",
+		   options.sdfText ? "distance field" : "bitmap", uploads, (r64)texels / 1024.0);
+}
+
+
+bool initStaticVector()
+{
+	if (!options.retainedVector) {
+		return true;
+	}
+	return initStaticLayer(state.staticVector, state.vg, 0.0f, 0.0f,
+						   state.screenWidth, STATIC_VECTOR_HEIGHT, drawStaticVector);
+}
+
+
+/**
+ * CPU cost of the per-frame transform work, timed around ballTransform
+ */
+struct TransformStats
+{
+	u64			frames;
+	u64			total_nsec;
+	u64			max_nsec;
+	u64			last_nsec;			// most recent frame
+};
+
+
 struct ARU2BA
 {
-	void*		buffer;		// single malloc'd buffer
-	
-	vec3*		verts;		// pointers into buffer
-	vec3*		normals;
-	vec2*		texCoords;
-	u16*		indexes;
-	
-	GLuint		glVertexBuffer;
+	GLuint		glVertexBuffer;		// SphereVertex, interleaved
 	GLuint		glIndexBuffer;
 	u32			numVerts;
-	u32			numIndexes;
-	uintptr_t	vertsOffset;
-	uintptr_t	normalsOffset;
-	uintptr_t	texCoordsOffset;
+	u32			lodLevel;
+	SphereLod	lod;				// range of glIndexBuffer drawn
+	GLuint		glQuadBuffer;		// corners of the procedural ball's quad
 
 	// current state
-	r32			pitch;
-	r32			bank;
+	quat		attitude;			// see ballAttitude
 	r32			turn;
 	
 	// target state for interpolation
-	r32			targetPitch;
-	r32			targetBank;
+	quat		targetAttitude;
 	r32			targetTurn;
 
-	mat4		orthoProjMat;
+	// view and projection, rebuilt only when their inputs change, see sceneView and sceneProjection
+	CameraCache	camera;
+	TransformStats	transformStats;
+
+	// slot ADI_BALL_TRANSFORM is the ball, other gauges drawn with the same view take the slots
+	// after it so all their matrices come from one transformBatch call
+	TransformBatch	transforms;
+	void*		transformsMemory;
 };
 
 
@@ -495,143 +672,121 @@ const vec3 xAxis{ 1, 0, 0 };
 const vec3 yAxis{ 0, 1, 0 };
 const vec3 zAxis{ 0, 0, 1 };
 
+#define ADI_BALL_TRANSFORM		0
+#define ADI_NUM_TRANSFORMS		1
+
+// the ball eases this fraction of the way to its target every ATTITUDE_EASING_PERIOD_MS
+#define ATTITUDE_EASING				0.25f
+#define ATTITUDE_EASING_PERIOD_MS	(1000.0f / 60.0f)
+
+
+/**
+ * Rolled by bank about z, then pitched about x, the order the ball's gimbals turn in
+ */
+quat ballAttitude(
+	r32 pitch,
+	r32 bank)
+{
+	return angleAxis(bank, zAxis) * angleAxis(pitch, xAxis);
+}
+
+
+/**
+ * ortho extents are taken from actual screen dimensions in inches
+ *  3.36"
+ * -------
+ * |     |
+ * |     | 4.48"
+ * |     |
+ * -------
+ * with origin at center, each coordinate is half of its dimension
+ */
+const mat4& sceneProjection(
+	ARU2BA& scene)
+{
+	return cameraOrthoRH(
+		scene.camera,
+		-1.68f,		// left
+		 1.68f,		// right
+		-2.24f,		// bottom
+		 2.24f,		// top
+		 0,			// near
+		 200.0f);	// far
+}
+
+
+const mat4& sceneView(
+	ARU2BA& scene)
+{
+	return cameraLookAtRH(
+		scene.camera,
+		cameraPos,		// eye
+		vec3{0, 0, 0},	// target
+		yAxis);			// up
+}
+
+
+/**
+ * Every level is already in the GPU buffers, switching only changes the index range drawn.
+ */
+void setARU2BALod(
+	ARU2BA& scene,
+	u32 level)
+{
+	assert(level < Q_countof(sphereMeshLods));
+	scene.lodLevel = level;
+	scene.lod = sphereMeshLods[level];
+}
+
 
 ARU2BA makeARU2BA()
 {
 	ARU2BA scene{};
 	
-	scene.pitch = scene.targetPitch = PIf; // start pitch and bank level
-	scene.bank  = scene.targetBank  = PIf;
+	scene.attitude = scene.targetAttitude = ballAttitude(PIf, PIf); // start pitch and bank level
 
-	r32 radius = 1.75f; // dimension in inches
-	
-	u32 numCols = 12;
-	u32 numColVerts = numCols + 1;
-	r32 radsPerColumn = 90.0f * DEG_TO_RADf / numCols;
-	r32 startColumnRads = -45.0f * DEG_TO_RADf;
-
-	u32 numRows = 48;
-	u32 numRowVerts = numRows + 1;
-	r32 radsPerRow = 360.0f * DEG_TO_RADf / numRows;
-
-	scene.numVerts = numColVerts * numRowVerts;
-	u32 vertexSize = sizeof(vec3) + sizeof(vec3) + sizeof(vec2); // position + normal + texCoord
-	size_t vBufferSize = vertexSize * scene.numVerts;
-	
-	u32 indexesPerCol = (numRowVerts * 2) + 2;		// number of triangles in strip + first 2 points (numRowVerts*2) + 2 points for degenerate
-	scene.numIndexes = indexesPerCol * numCols - 1;	// take one away for no degenerate on first column
-	size_t iBufferSize = sizeof(u16) * scene.numIndexes;
-
-	scene.buffer = malloc(vBufferSize + iBufferSize);
-	scene.vertsOffset = 0;
-	scene.normalsOffset = scene.vertsOffset + (sizeof(vec3) * scene.numVerts);
-	scene.texCoordsOffset = scene.normalsOffset + (sizeof(vec3) * scene.numVerts);
-	scene.verts     = (vec3*)((uintptr_t)scene.buffer + scene.vertsOffset);
-	scene.normals   = (vec3*)((uintptr_t)scene.buffer + scene.normalsOffset);
-	scene.texCoords = (vec2*)((uintptr_t)scene.buffer + scene.texCoordsOffset);
-	scene.indexes   = (u16*)((uintptr_t)scene.buffer + scene.texCoordsOffset + (sizeof(vec2) * scene.numVerts));
-
-	// create vertices
-	u32 v = 0;
-	r32 colRad = startColumnRads;
-
-	for(u32 c = 0;
-		c < numColVerts;
-		++c)
-	{
-		r32 colX = sinf(colRad);
-		r32 colUnitRadius = cosf(colRad);
-		r32 rowRad = 0;
+	scene.numVerts = Q_countof(sphereMeshVerts);
 
-		for(u32 r = 0;
-			r < numRowVerts;
-			++r)
-		{
-			vec3& vert = scene.verts[v];
-			vec3& norm = scene.normals[v];
-			vec2& tex  = scene.texCoords[v];
-
-			r32 rowY = (r != numRows
-				? sinf(rowRad)	// for all rows but the last
-				: sinf(0));		// ensure last row exactly equals first
-			r32 rowZ = (r != numRows
-				? cosf(rowRad)
-				: cosf(0));
-			
-			vert.x = colX;
-			vert.y = rowY * colUnitRadius;
-			vert.z = rowZ * colUnitRadius;
-			vert = normalize(vert);
-			norm = vert;
-			vert *= radius;
-			tex.s = (r32)r / (r32)numRows;
-			tex.t = (r32)c / (r32)numCols;
-
-			rowRad += radsPerRow;
-			++v;
-		}
-
-		colRad += radsPerColumn;
-	}
-	assert(v == scene.numVerts);
-
-	// create indexes for triangle strips
-	u32 i = 0;
-
-	for(u32 c = 0;
-		c < numCols;
-		++c)
-	{
-		u32 colBaseV = c * numRowVerts;
+	scene.transformsMemory = malloc(transformBatchBytes(ADI_NUM_TRANSFORMS));
+	initTransformBatch(scene.transforms, ADI_NUM_TRANSFORMS, scene.transformsMemory);
+	// vertices are on the unit sphere
+	scene.transforms.scale[ADI_BALL_TRANSFORM] = SPHERE_RADIUS;
 
-		// add point for degenerate triangle from end of row to start of next row
-		if (c > 0) {
-			scene.indexes[i++] = colBaseV;
-		}
-
-		for(u32 r = 0;
-			r < numRowVerts;
-			++r)
-		{
-			scene.indexes[i++] = colBaseV + r;
-			scene.indexes[i++] = colBaseV + r + numRowVerts;
-		}
-		// add point for degenerate triangle from end of row to start of next row
-		scene.indexes[i] = scene.indexes[i-1];
-		++i;
-	}
-	assert(i == scene.numIndexes);
-
-	// create vertex buffer
+	// upload straight from the mesh baked at build time, nothing to compute or free
 	glGenBuffers(1, &scene.glVertexBuffer);
 	glBindBuffer(GL_ARRAY_BUFFER, scene.glVertexBuffer);
-	glBufferData(GL_ARRAY_BUFFER, vBufferSize, scene.buffer, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(sphereMeshVerts), sphereMeshVerts, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-	// create index buffer
 	glGenBuffers(1, &scene.glIndexBuffer);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, scene.glIndexBuffer);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, iBufferSize, scene.indexes, GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(sphereMeshIndexes), sphereMeshIndexes, GL_STATIC_DRAW);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-	// set up projection matrices
-	/**
-	 * ortho extents are taken from actual screen dimensions in inches
-	 *  3.36"
-	 * -------
-	 * |     |
-	 * |     | 4.48"
-	 * |     |
-	 * -------
-	 * with origin at center, each coordinate is half of its dimension
-	 */
-	scene.orthoProjMat = orthoRH(
-		-1.68f,		// left
-		 1.68f,		// right
-		-2.24f,		// bottom
-		 2.24f,		// top
-		 0,			// near
-		 200.0f);	// far
+	// triangle strip, counter-clockwise
+	const r32 quadCorners[] = { -1, -1,  1, -1,  -1, 1,  1, 1 };
+
+	glGenBuffers(1, &scene.glQuadBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, scene.glQuadBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(quadCorners), quadCorners, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	r32 radius_px = sphereProjectedRadius(
+		sceneProjection(scene),
+		state.screenWidth,
+		state.screenHeight);
+	u32 level = (options.lodLevel >= 0
+		? min((u32)options.lodLevel, (u32)SPHERE_LOD_LEVELS - 1)
+		: selectSphereLod(radius_px, options.lodMaxError_px));
+	setARU2BALod(scene, level);
+
+	if (options.ballRenderer == Ball_Procedural) {
+		printf("Ball radius %.1f px, procedural shader\n", radius_px);
+	}
+	else {
+		printf("Ball radius %.1f px, level of detail %u (%u x %u), facet error %.2f px\n",
+			   radius_px, level, scene.lod.cols, scene.lod.rows, sphereLodError(level, radius_px));
+	}
 
 	return scene;
 }
@@ -642,50 +797,96 @@ void freeARU2BA(
 {
 	glDeleteBuffers(1, &scene.glVertexBuffer);
 	glDeleteBuffers(1, &scene.glIndexBuffer);
-	free(scene.buffer);
+	glDeleteBuffers(1, &scene.glQuadBuffer);
+	free(scene.transformsMemory);
+	scene.transformsMemory = nullptr;
 }
 
 
-void drawARU2BA(
+/**
+ * Model and view transforms shared by both ball renderers.
+ */
+struct BallTransform
+{
+	mat4		modelView;			// unit sphere to viewspace, includes SPHERE_RADIUS
+	mat4		mvp;
+	mat3		normal;				// inverse transpose of the upper-left 3x3 of modelView
+};
+
+
+/**
+ * Turns the ball to its attitude through the scene's TransformBatch. The view and projection come
+ * from the camera cache, and a rigid view lets the batch take the closed form normal matrix.
+ */
+BallTransform ballTransform(
 	ARU2BA& scene)
 {
-	glEnable(GL_CULL_FACE);
-	
+	u64 start_nsec = monotonicNsec();
+
+	const mat4& view = sceneView(scene);
+	const mat4& proj = sceneProjection(scene);
+
+	TransformBatch& batch = scene.transforms;
+	for (u32 e = 0; e < 4; ++e) {
+		batch.rotation[e][ADI_BALL_TRANSFORM] = scene.attitude.E[e];
+	}
+	batch.rigidView = scene.camera.viewRigid;
+
+	transformBatch(batch, view, proj);
+
+	BallTransform xf;
+	xf.modelView = batchModelView(batch, ADI_BALL_TRANSFORM);
+	xf.mvp = batchModelViewProj(batch, ADI_BALL_TRANSFORM);
+	xf.normal = batchNormal(batch, ADI_BALL_TRANSFORM);
+
+	TransformStats& ts = scene.transformStats;
+	ts.last_nsec = monotonicNsec() - start_nsec;
+	ts.total_nsec += ts.last_nsec;
+	ts.max_nsec = max(ts.max_nsec, ts.last_nsec);
+	++ts.frames;
+	return xf;
+}
+
+
+void printTransformSummary(
+	const ARU2BA& scene)
+{
+	const TransformStats& ts = scene.transformStats;
+	if (ts.frames == 0) {
+		return;
+	}
+
+	printf("Transforms: %llu frames, %.2f us mean, %.2f us max per frame, view built %u times, "
+		   "projection %u times, %s normal matrix\n",
+		   (unsigned long long)ts.frames,
+		   (r64)ts.total_nsec / (r64)ts.frames * 1e-3,
+		   (r64)ts.max_nsec * 1e-3,
+		   scene.camera.viewBuilds, scene.camera.projBuilds,
+		   (scene.camera.viewRigid ? "closed form" : "cofactor"));
+}
+
+
+void drawBallMesh(
+	ARU2BA& scene,
+	const BallTransform& xf)
+{
 	glUseProgram(state.program);
 
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, state.texBackupADI);//scene.glBallTex);
+	glBindTexture(GL_TEXTURE_2D, state.texBackupADI.name);//scene.glBallTex);
 	glUniform1i(state.unifDiffuseTex, 0);
 
-	// roll
-	mat4 modelToWorld = rotate(
-		mat4{},			// identity
-		scene.bank,
-		zAxis);
-	// pitch
-	modelToWorld = rotate(
-		modelToWorld,
-		scene.pitch,
-		xAxis);
-
-	mat4 viewMat = lookAtRH(
-		cameraPos,		// eye
-		vec3{0, 0, 0},	// target
-		yAxis);			// up
-	
-	mat4 modelView(viewMat * modelToWorld);
-	mat4 mvp(scene.orthoProjMat * modelView);
-	mat4 normalMat = make_mat4(transpose(inverse(make_mat3(modelView))));
+	mat4 normalMat = make_mat4(xf.normal);
 
 	glUniformMatrix4fv(
 		state.unifModelView,
 		1, GL_FALSE,
-		modelView.E);
+		xf.modelView.E);
 
 	glUniformMatrix4fv(
 		state.unifModelViewProj,
 		1, GL_FALSE,
-		mvp.E);
+		xf.mvp.E);
 
 	glUniformMatrix4fv(
 		state.unifNormalMatrix,
@@ -699,38 +900,30 @@ void drawARU2BA(
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, scene.glIndexBuffer);
 
 	glEnableVertexAttribArray(state.attrVertexPosition);
-	glEnableVertexAttribArray(state.attrVertexNormal);
 	glEnableVertexAttribArray(state.attrVertexUV);
 	
-	// vertex position
+	// vertex position, the normal is derived from it in the vertex shader
 	glVertexAttribPointer(
 		state.attrVertexPosition,
-		3,			// size
-		GL_FLOAT,	// type
-		GL_FALSE,	// normalized, fixed point?
-		0,			// stride, 0 = tightly packed
-		(const GLvoid*)scene.vertsOffset); // offset of position data in buffer
+		3,						// size
+		GL_SHORT,				// type
+		GL_TRUE,				// normalized, snorm16 to [-1,1]
+		sizeof(SphereVertex),	// stride
+		(const GLvoid*)offsetof(SphereVertex, x));
 
-	// normal
-	glVertexAttribPointer(
-		state.attrVertexNormal,
-		3, GL_FLOAT, GL_FALSE, 0,
-		(const GLvoid*)scene.normalsOffset);
-	
 	// texture coords
 	glVertexAttribPointer(
 		state.attrVertexUV,
-		2, GL_FLOAT, GL_FALSE, 0,
-		(const GLvoid*)scene.texCoordsOffset);
+		2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(SphereVertex),
+		(const GLvoid*)offsetof(SphereVertex, s));
 
 	glDrawElements(
 		GL_TRIANGLE_STRIP,		// mode
-		scene.numIndexes,		// element count
+		scene.lod.numIndexes,	// element count
 		GL_UNSIGNED_SHORT,		// type
-		(const GLvoid*)0);
+		(const GLvoid*)(sizeof(u16) * scene.lod.firstIndex));
 
 	glDisableVertexAttribArray(state.attrVertexPosition);
-	glDisableVertexAttribArray(state.attrVertexNormal);
 	glDisableVertexAttribArray(state.attrVertexUV);
 
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -742,43 +935,65 @@ void drawARU2BA(
 
 
 /**
- * interpolate val to target, smooths out "choppiness" from network updates
+ * Quad in front of the ball, the fragment shader does the rest, see initBallShader.
  */
-void interpolateValue(
-	r32& val,
-	const r32& target,
-	r32 easingFactor = 0.25f,
-	bool wrap = true,
-	r32 wrapVal = PIf * 2.0f,
-	r32 equalEpsilon = 0.0001f)
-{
-	r32 delta = target - val;
-	
-	if (wrap) {
-		// |-----------V=>----T---|W
-		// |--<=V-------------T---|W
-		if (target > val) {
-			r32 deltaWrap = wrapVal - target + val;
-			if (deltaWrap < delta) {
-				delta = -deltaWrap;
-			}
-		}
-		// |-----------T----<=V---|W
-		// |----T-------------V=>-|W
-		else if (target < val) {
-			r32 deltaWrap = wrapVal - val + target;
-			if (deltaWrap < -delta) {
-				delta = deltaWrap;
-			}
-		}
-	}
+void drawBallProcedural(
+	ARU2BA& scene,
+	const BallTransform& xf)
+{
+	glUseProgram(state.ballProgram);
+
+	// ortho view, the silhouette is a circle of SPHERE_RADIUS around the projected center
+	vec3 center{ xf.modelView[3].x, xf.modelView[3].y, xf.modelView[3].z };
+	mat4 quadToClip = scene.camera.proj
+		* scale(translate(mat4{}, center), vec3{ SPHERE_RADIUS, SPHERE_RADIUS, 1.0f });
+
+	// modelView is a rotation times SPHERE_RADIUS, its inverse is the transpose over the radius
+	mat3 viewToModel = transpose(make_mat3(xf.modelView)) / SPHERE_RADIUS;
+
+	glUniformMatrix4fv(
+		state.unifBallQuadToClip,
+		1, GL_FALSE,
+		quadToClip.E);
+
+	glUniformMatrix3fv(
+		state.unifBallViewToModel,
+		1, GL_FALSE,
+		viewToModel.E);
+
+	glUniform3fv(state.unifBallCenter, 1, center.E);
+	glUniform1f(state.unifBallRadius, SPHERE_RADIUS);
+	glUniform3fv(state.unifBallCameraPos, 1, cameraPos.E);
+
+	glBindBuffer(GL_ARRAY_BUFFER, scene.glQuadBuffer);
+	glEnableVertexAttribArray(state.attrBallCorner);
+	glVertexAttribPointer(
+		state.attrBallCorner,
+		2, GL_FLOAT, GL_FALSE, 0,
+		(const GLvoid*)0);
+
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
-	if (fabs(delta) < equalEpsilon) {
-		val = target;
+	glDisableVertexAttribArray(state.attrBallCorner);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	ASSERT_GL_ERROR;
+}
+
+
+void drawARU2BA(
+	ARU2BA& scene,
+	BallRenderer renderer)
+{
+	glEnable(GL_CULL_FACE);
+
+	BallTransform xf = ballTransform(scene);
+
+	if (renderer == Ball_Procedural) {
+		drawBallProcedural(scene, xf);
 	}
 	else {
-		// ease val toward target
-		val += delta * easingFactor;
+		drawBallMesh(scene, xf);
 	}
 }
 
@@ -786,40 +1001,161 @@ void interpolateValue(
 void updateARU2BA(
 	ARU2BA& scene)
 {
-	if (mqttState.pitch_nsec > 0) {
-		scene.targetPitch = (r32)mqttState.rawPitch / 65535.0f * PIf + (PIf * 0.5f);
-	}
-	else {
-		scene.targetPitch = PIf;
+	ADIValues adi;
+	u32 seq = seqlockRead(mqttState.snapshot, adi);
+
+	u64 recv_nsec = max(max(adi.pitch_nsec, adi.bank_nsec), adi.turn_nsec);
+	latencyOnSnapshot(latency, seq, recv_nsec, monotonicNsec());
+
+	r32 pitch = PIf;
+	if (adi.pitch_nsec > 0) {
+		pitch = (r32)adi.rawPitch / 65535.0f * PIf + (PIf * 0.5f);
 	}
 
-	if (mqttState.bank_nsec > 0) {
-		scene.targetBank = (r32)mqttState.rawBank / 65535.0f * PIf * 2.0f;
+	r32 bank = PIf;
+	if (adi.bank_nsec > 0) {
+		bank = (r32)adi.rawBank / 65535.0f * PIf * 2.0f;
 	}
-	else {
-		scene.targetBank = PIf;
+
+	// smooths out "choppiness" from network updates, slerp takes the shortest way so there is no
+	// wraparound to handle and no path bending near +-90 degrees pitch
+	scene.targetAttitude = ballAttitude(pitch, bank);
+	scene.attitude = slerpEase(
+		scene.attitude,
+		scene.targetAttitude,
+		ATTITUDE_EASING,
+		timer.dt_ms / ATTITUDE_EASING_PERIOD_MS);
+
+	latencyOnInterpolated(
+		latency,
+		memcmp(&scene.attitude, &scene.targetAttitude, sizeof(quat)) == 0);
+}
+
+
+/**
+ * Overlay text is formatted before drawing so the damage check can compare it with what is on
+ * screen. The FPS text is left out of the comparison and only formatted for frames that are drawn,
+ * otherwise its own updates would force a redraw once a second.
+ */
+struct OverlayText
+{
+	char		fps[16];
+	char		latency[2][64];
+};
+
+
+/**
+ * Everything the picture depends on, as of the last presented frame.
+ */
+struct FrameDamage
+{
+	bool		valid;		// false until the first frame is presented
+	quat		attitude;
+	r32			turn;
+	OverlayText	overlay;
+};
+
+
+void formatOverlay(
+	OverlayText& text)
+{
+	memset(&text, 0, sizeof(text));
+
+	if (options.latencyOverlay) {
+		const Histogram* hists[] = { &latency.photon, &latency.settled };
+		const char* names[] = { "photon", "settled" };
+
+		for (u32 h = 0; h < 2; ++h) {
+			snprintf(text.latency[h], sizeof(text.latency[h]), "%s p50 %.1f p99 %.1f max %.1f ms",
+					 names[h],
+					 (r64)histogramPercentile(*hists[h], 50.0) * 1e-6,
+					 (r64)histogramPercentile(*hists[h], 99.0) * 1e-6,
+					 (r64)hists[h]->max * 1e-6);
+		}
 	}
+}
 
-	interpolateValue(scene.pitch, scene.targetPitch);
-	interpolateValue(scene.bank,  scene.targetBank);
+
+void formatFPS(
+	OverlayText& text)
+{
+	snprintf(text.fps, sizeof(text.fps), "FPS: %.2f", timer.fps);
 }
 
 
-void drawFPS()
+bool frameChanged(
+	const FrameDamage& last,
+	const ARU2BA& scene,
+	const OverlayText& overlay)
 {
-	char fpsText[16] = {};
-	snprintf(fpsText, 16, "FPS: %.2f", timer.fps);
+	return !last.valid
+		|| memcmp(&last.attitude, &scene.attitude, sizeof(quat)) != 0
+		|| last.turn != scene.turn
+		|| memcmp(last.overlay.latency, overlay.latency, sizeof(overlay.latency)) != 0;
+}
+
 
+void markPresented(
+	FrameDamage& last,
+	const ARU2BA& scene,
+	const OverlayText& overlay)
+{
+	last.valid = true;
+	last.attitude = scene.attitude;
+	last.turn = scene.turn;
+	last.overlay = overlay;
+}
+
+
+void drawFPS(
+	const OverlayText& text)
+{
 	drawLabel(
-		fpsText,
+		text.fps,
 		10.0f, 10.0f,
 		0, 18.0f);
 }
 
 
+void drawLatency(
+	const OverlayText& text)
+{
+	for (u32 h = 0; h < 2; ++h) {
+		drawLabel(
+			text.latency[h],
+			10.0f, 30.0f + 20.0f * h,
+			0, 18.0f);
+	}
+}
+
+
+/**
+ * Called for presented frames only, so frames skipped as unchanged neither count nor move the
+ * FPS text.
+ */
+void updateFPS(
+	u64 present_nsec)
+{
+	if (timer.fpsPrev_nsec == 0) {
+		timer.fpsPrev_nsec = present_nsec;
+		return;
+	}
+	if (++timer.fpsFrames == 60) {
+		timer.fps = 60.0f / ((r32)(present_nsec - timer.fpsPrev_nsec) * 0.000000001f);
+		timer.fpsPrev_nsec = present_nsec;
+		timer.fpsFrames = 0;
+	}
+}
+
+
 void drawScene(
-	ARU2BA& scene)
+	ARU2BA& scene,
+	const OverlayText& overlay)
 {
+	if (options.retainedVector) {
+		updateStaticLayer(state.staticVector, state.vg);
+	}
+
 	// render to the main frame buffer
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	
@@ -840,20 +1176,32 @@ void drawScene(
 		state.screenHeight,
 		1.0f); // pixel ratio
 
-	drawPitchLadder();
+	if (options.retainedVector) {
+		drawStaticLayer(state.staticVector, state.vg);
+	}
+	else {
+		drawStaticVector(state.vg);
+	}
 
-	drawFPS();
+	drawFPS(overlay);
+
+	if (options.latencyOverlay) {
+		drawLatency(overlay);
+	}
 
 	nvgEndFrame(state.vg);
 
 	glEnable(GL_DEPTH_TEST);
 
-	drawARU2BA(scene);
+	drawARU2BA(scene, options.ballRenderer);
 
-	glFlush();
-	glFinish();
+	// no glFinish, the swap flushes and throttles, see pacing.h
+	presentFrame();
 
-	eglSwapBuffers(state.display, state.surface);
+	u64 present_nsec = monotonicNsec();
+	latencyOnPresent(latency, present_nsec);
+	pacingOnPresent(pacer, present_nsec);
+	updateFPS(present_nsec);
 	ASSERT_GL_ERROR;
 }
 
@@ -865,67 +1213,435 @@ void handleSignal(int s)
 }
 
 
-void updateTime(
-	u32 frame)
+void updateTime()
 {
 	// get current time
+	// same clock the input handlers stamp samples with
 	timer.prev_nsec = timer.now_nsec;
-	clock_gettime(CLOCK_MONOTONIC, &timer.tsNow);
-	timer.now_nsec = timer.tsNow.tv_sec * 1000000000 + timer.tsNow.tv_nsec;
+	timer.now_nsec = monotonicNsec();
 	// calc delta time
 	timer.dt_ms = (r32)(timer.now_nsec - timer.prev_nsec) * 0.000001f;
-	
-	// calc fps
-	if (frame > 0 && (frame % 60) == 0) {
-		timer.fps = 60.0f / ((r32)(timer.now_nsec - timer.fpsPrev_nsec) * 0.000000001f);
-		timer.fpsPrev_nsec = timer.now_nsec;
-	}
 }
 
 
-int main()
+void printUsage(
+	const char* bin)
 {
-	signal(SIGINT, handleSignal);
-	signal(SIGTERM, handleSignal);
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  --input mqtt|dcsbios   data source, MQTT broker (default) or DCS-BIOS UDP export stream\n"
+		"  --record <file>        capture all subscribed MQTT messages to file\n"
+		"  --replay <file>        use a capture as the data source instead of the network\n"
+		"  --replay-speed <x>     replay timing multiplier, default 1, 0 for as fast as possible\n"
+		"  --replay-exit          exit when the replay is finished\n"
+		"  --frames <n>           exit after n frames\n"
+		"  --latency-overlay      show motion-to-photon latency on screen\n"
+		"  --latency-dump <sec>   log motion-to-photon latency histograms every sec seconds\n"
+		"  --pacing vsync|fixed|uncapped\n"
+		"                         frame pacing, default vsync (uncapped for headless builds)\n"
+		"  --swap-interval <n>    vsync mode, vblanks per frame, default 1\n"
+		"  --fps <hz>             fixed mode frame rate, default 60\n"
+		"  --sample-delay <ms>    vsync mode, wait this long after each swap before sampling input\n"
+		"  --lod <n>              ball level of detail, 0 = finest, default picked from the screen size\n"
+		"  --lod-error <px>       facet error allowed when picking the level, default 1\n"
+		"  --tex-filter <mode>    ball texture sampling, nearest (default), bilinear, nearest-mip,\n"
+		"                         bilinear-mip, trilinear or aniso\n"
+		"  --tex-tier <n>         ball texture resolution, 0 = full (default), each tier halves it\n"
+		"  --tex-aniso <n>        max anisotropy for --tex-filter aniso, default 4\n"
+		"  --ball mesh|shader     ball renderer, textured mesh (default) or procedural fragment shader\n"
+		"  --ball-diff            render the ball both ways each frame and report the pixel difference\n"
+		"  --vector retained|immediate\n"
+		"                         static overlay artwork drawn once into a texture (default) or\n"
+		"                         tessellated every frame\n"
+		"  --path-cache on|off    keep tessellated NanoVG paths across frames, default on\n"
+		"  --vector-batch on|off  draw NanoVG calls with the same paint together, default on\n"
+		"  --text sdf|bitmap      distance field glyphs for every size (default) or a bitmap per size\n"
+		"  --redraw always|changed\n"
+		"                         skip frames identical to the one on screen, default changed\n"
+		"                         (always for headless builds)\n"
+#ifdef ADI_HEADLESS
+		"  --size <w>x<h>         headless surface size, default 480x640\n"
+		"  --dump-every <n>       write every nth frame as a PPM image\n"
+		"  --dump-dir <dir>       directory for frame dumps, default .\n"
+#endif
+		, bin);
+}
 
-	bcm_host_init();
 
-	if (get_processor_id() == PROCESSOR_BCM2838)
+bool parseOptions(
+	int argc,
+	char** argv,
+	AppOptions& opts)
+{
+	for(int a = 1;
+		a < argc;
+		++a)
 	{
-		fprintf(stderr, "This application is not available on the Pi4\n");
-		exit(0);
+		const char* arg = argv[a];
+		const char* val = (a + 1 < argc ? argv[a + 1] : nullptr);
+
+		if (strcmp(arg, "--input") == 0 && val) {
+			if (strcmp(val, "mqtt") == 0) {
+				opts.input = Input_MQTT;
+			}
+			else if (strcmp(val, "dcsbios") == 0) {
+				opts.input = Input_DCSBIOS;
+			}
+			else {
+				fprintf(stderr, "Unknown input source: %s\n", val);
+				return false;
+			}
+			++a;
+		}
+		else if (strcmp(arg, "--record") == 0 && val) {
+			opts.recordFile = val;
+			++a;
+		}
+		else if (strcmp(arg, "--replay") == 0 && val) {
+			opts.input = Input_Replay;
+			opts.replayFile = val;
+			++a;
+		}
+		else if (strcmp(arg, "--replay-speed") == 0 && val) {
+			opts.replaySpeed = (r32)atof(val);
+			++a;
+		}
+		else if (strcmp(arg, "--replay-exit") == 0) {
+			opts.exitAfterReplay = true;
+		}
+		else if (strcmp(arg, "--frames") == 0 && val) {
+			opts.maxFrames = (u32)strtoul(val, nullptr, 10);
+			++a;
+		}
+		else if (strcmp(arg, "--latency-overlay") == 0) {
+			opts.latencyOverlay = true;
+		}
+		else if (strcmp(arg, "--latency-dump") == 0 && val) {
+			opts.latencyDumpSec = (u32)strtoul(val, nullptr, 10);
+			++a;
+		}
+		else if (strcmp(arg, "--pacing") == 0 && val) {
+			if (strcmp(val, "vsync") == 0) {
+				opts.pacing = Pacing_VSync;
+			}
+			else if (strcmp(val, "fixed") == 0) {
+				opts.pacing = Pacing_Fixed;
+			}
+			else if (strcmp(val, "uncapped") == 0) {
+				opts.pacing = Pacing_Uncapped;
+			}
+			else {
+				fprintf(stderr, "Unknown pacing mode: %s\n", val);
+				return false;
+			}
+			++a;
+		}
+		else if (strcmp(arg, "--swap-interval") == 0 && val) {
+			opts.swapInterval = (u32)strtoul(val, nullptr, 10);
+			++a;
+		}
+		else if (strcmp(arg, "--fps") == 0 && val) {
+			opts.fixedHz = (r32)atof(val);
+			++a;
+		}
+		else if (strcmp(arg, "--lod") == 0 && val) {
+			opts.lodLevel = (i32)strtol(val, nullptr, 10);
+			++a;
+		}
+		else if (strcmp(arg, "--lod-error") == 0 && val) {
+			opts.lodMaxError_px = (r32)atof(val);
+			++a;
+		}
+		else if (strcmp(arg, "--tex-filter") == 0 && val) {
+			if (!parseTextureFilter(val, opts.texQuality.filter)) {
+				fprintf(stderr, "Unknown texture filter: %s\n", val);
+				return false;
+			}
+			++a;
+		}
+		else if (strcmp(arg, "--tex-tier") == 0 && val) {
+			opts.texQuality.tier = (u32)strtoul(val, nullptr, 10);
+			++a;
+		}
+		else if (strcmp(arg, "--tex-aniso") == 0 && val) {
+			opts.texQuality.maxAnisotropy = (r32)atof(val);
+			++a;
+		}
+		else if (strcmp(arg, "--ball") == 0 && val) {
+			if (strcmp(val, "mesh") == 0) {
+				opts.ballRenderer = Ball_Mesh;
+			}
+			else if (strcmp(val, "shader") == 0) {
+				opts.ballRenderer = Ball_Procedural;
+			}
+			else {
+				fprintf(stderr, "Unknown ball renderer: %s\n", val);
+				return false;
+			}
+			++a;
+		}
+		else if (strcmp(arg, "--ball-diff") == 0) {
+			opts.ballDiff = true;
+		}
+		else if (strcmp(arg, "--vector") == 0 && val) {
+			if (strcmp(val, "retained") == 0) {
+				opts.retainedVector = true;
+			}
+			else if (strcmp(val, "immediate") == 0) {
+				opts.retainedVector = false;
+			}
+			else {
+				fprintf(stderr, "Unknown vector mode: %s\n", val);
+				return false;
+			}
+			++a;
+		}
+		else if (strcmp(arg, "--path-cache") == 0 && val) {
+			if (strcmp(val, "on") == 0) {
+				opts.tessCache = true;
+			}
+			else if (strcmp(val, "off") == 0) {
+				opts.tessCache = false;
+			}
+			else {
+				fprintf(stderr, "Unknown path cache mode: %s\n", val);
+				return false;
+			}
+			++a;
+		}
+		else if (strcmp(arg, "--vector-batch") == 0 && val) {
+			if (strcmp(val, "on") == 0) {
+				opts.vectorBatch = true;
+			}
+			else if (strcmp(val, "off") == 0) {
+				opts.vectorBatch = false;
+			}
+			else {
+				fprintf(stderr, "Unknown vector batch mode: %s\n", val);
+				return false;
+			}
+			++a;
+		}
+		else if (strcmp(arg, "--text") == 0 && val) {
+			if (strcmp(val, "sdf") == 0) {
+				opts.sdfText = true;
+			}
+			else if (strcmp(val, "bitmap") == 0) {
+				opts.sdfText = false;
+			}
+			else {
+				fprintf(stderr, "Unknown text mode: %s\n", val);
+				return false;
+			}
+			++a;
+		}
+		else if (strcmp(arg, "--redraw") == 0 && val) {
+			if (strcmp(val, "always") == 0) {
+				opts.skipUnchanged = false;
+			}
+			else if (strcmp(val, "changed") == 0) {
+				opts.skipUnchanged = true;
+			}
+			else {
+				fprintf(stderr, "Unknown redraw mode: %s\n", val);
+				return false;
+			}
+			++a;
+		}
+		else if (strcmp(arg, "--sample-delay") == 0 && val) {
+			opts.sampleDelay_ms = (r32)atof(val);
+			++a;
+		}
+#ifdef ADI_HEADLESS
+		else if (strcmp(arg, "--size") == 0 && val) {
+			if (sscanf(val, "%ux%u", &opts.headlessWidth, &opts.headlessHeight) != 2
+				|| opts.headlessWidth == 0 || opts.headlessHeight == 0)
+			{
+				fprintf(stderr, "Invalid size: %s\n", val);
+				return false;
+			}
+			++a;
+		}
+		else if (strcmp(arg, "--dump-every") == 0 && val) {
+			opts.dumpEvery = (u32)strtoul(val, nullptr, 10);
+			++a;
+		}
+		else if (strcmp(arg, "--dump-dir") == 0 && val) {
+			opts.dumpDir = val;
+			++a;
+		}
+#endif
+		else {
+			printUsage(argv[0]);
+			return false;
+		}
 	}
 
-	if (initMQTT(&mqttState)
+	if (opts.recordFile && opts.input != Input_MQTT) {
+		fprintf(stderr, "--record is only supported with --input mqtt\n");
+		return false;
+	}
+
+	return true;
+}
+
+
+bool initInput()
+{
+	switch (options.input) {
+		case Input_MQTT:
+			return (!options.recordFile || initRecorder(options.recordFile))
+				&& initMQTT(&mqttState);
+		case Input_DCSBIOS:
+			return initDCSBIOS(&mqttState);
+		case Input_Replay:
+			return initReplay(&mqttState, options.replayFile, options.replaySpeed);
+	}
+	return false;
+}
+
+
+void cleanupInput()
+{
+	switch (options.input) {
+		case Input_MQTT:
+			cleanupMQTT();
+			cleanupRecorder();
+			break;
+		case Input_DCSBIOS:
+			cleanupDCSBIOS();
+			break;
+		case Input_Replay:
+			cleanupReplay();
+			break;
+	}
+}
+
+
+int main(
+	int argc,
+	char** argv)
+{
+	options.replaySpeed = 1.0f;
+	options.pacing = Pacing_VSync;
+	options.swapInterval = 1;
+	options.fixedHz = 60.0f;
+	options.skipUnchanged = true;
+	options.lodLevel = -1;
+	options.lodMaxError_px = 1.0f;
+	options.texQuality.filter = Filter_Nearest;
+	options.texQuality.maxAnisotropy = 4.0f;
+	options.retainedVector = true;
+	options.tessCache = true;
+	options.vectorBatch = true;
+	options.sdfText = true;
+#ifdef ADI_HEADLESS
+	// pbuffer swaps never wait for a display, run flat out for benchmarks unless asked otherwise
+	options.pacing = Pacing_Uncapped;
+	options.skipUnchanged = false;
+	options.headlessWidth = 480;
+	options.headlessHeight = 640;
+	options.dumpDir = ".";
+#endif
+
+	if (!parseOptions(argc, argv, options)) {
+		return 1;
+	}
+
+	signal(SIGINT, handleSignal);
+	signal(SIGTERM, handleSignal);
+
+	initLog();
+
+	if (initInput()
 		&& initOpenGL()
 		&& initShaders()
+		&& initBallShader()
 		&& initNanoVG()
-		&& loadTextures()
-		&& loadFonts(state.vg))
+		// the procedural ball needs no texture
+		&& ((options.ballRenderer == Ball_Procedural && !options.ballDiff) || loadTextures())
+		&& loadFonts(state.vg)
+		&& initStaticVector()
+		&& initFramePacer(pacer, options.pacing, options.swapInterval, options.fixedHz, options.sampleDelay_ms))
 	{
 		ARU2BA scene = makeARU2BA();
 		
+		OverlayText overlay;
+		FrameDamage damage{};
+
+		BallDiff ballDiff{};
+		if (options.ballDiff && !initBallDiff(ballDiff, state.screenWidth, state.screenHeight)) {
+			running = false;
+		}
+
 		u32 frame = 0;
-		updateTime(frame);
+		updateTime();
+		initLatencyTracker(latency);
 
 		while (running)
 		{
-			updateTime(frame);
+			pacingWait(pacer);
+			updateTime();
 			updateARU2BA(scene);
-			drawScene(scene);
+			formatOverlay(overlay);
+
+			if (!options.skipUnchanged || frameChanged(damage, scene, overlay)) {
+				if (options.ballDiff) {
+					ballDiffFrame(ballDiff, scene);
+				}
+				formatFPS(overlay);
+				drawScene(scene, overlay);
+				markPresented(damage, scene, overlay);
+			}
+			else {
+				latencyOnSkip(latency);
+				pacingOnSkip(pacer);
+			}
 			++frame;
+
+			if (options.latencyDumpSec > 0) {
+				latencyDumpStats(latency, timer.now_nsec, options.latencyDumpSec * 1000000000ULL);
+			}
+
+			if ((options.exitAfterReplay && options.input == Input_Replay && isReplayFinished())
+				|| (options.maxFrames > 0 && frame >= options.maxFrames))
+			{
+				running = false;
+			}
 		}
+		printTransformSummary(scene);
+		printStaticVectorSummary();
+		printTessCacheSummary();
+		printVectorStreamSummary();
+		printVectorDrawSummary();
+		printTextAtlasSummary();
 		freeARU2BA(scene);
+		printPacingSummary(pacer);
+		printBallDiffSummary(ballDiff);
+		freeBallDiff(ballDiff);
 	}
 
 	freeTextures();
 	cleanupNanoVG();
 	cleanupOpenGL();
-	cleanupMQTT();
+	cleanupInput();
+	cleanupLog();
 
 	return 0;
 }
 
 
 #include "mqtt.cpp"
+#include "dcsbios.cpp"
+#include "recorder.cpp"
+#include "latency.cpp"
+#include "pacing.cpp"
+#include "texture.cpp"
+#include "layer.cpp"
+#include "balldiff.cpp"
+#ifdef ADI_HEADLESS
+#include "platform_headless.cpp"
+#else
+#include "platform_rpi.cpp"
+#endif
 #include "nanovg/src/nanovg.c"
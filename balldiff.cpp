@@ -0,0 +1,112 @@
+#include "balldiff.h"
+
+
+bool initBallDiff(
+	BallDiff& bd,
+	u32 width,
+	u32 height)
+{
+	bd = BallDiff{};
+	bd.width = width;
+	bd.height = height;
+	bd.meshPixels = (u8*)malloc(width * height * 4);
+	bd.procPixels = (u8*)malloc(width * height * 4);
+
+	if (!bd.meshPixels || !bd.procPixels) {
+		fprintf(stderr, "Ball diff: out of memory\n");
+		freeBallDiff(bd);
+		return false;
+	}
+	return true;
+}
+
+
+void readBallPixels(
+	const BallDiff& bd,
+	ARU2BA& scene,
+	BallRenderer renderer,
+	u8* pixels)
+{
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+	drawARU2BA(scene, renderer);
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, bd.width, bd.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+}
+
+
+void ballDiffFrame(
+	BallDiff& bd,
+	ARU2BA& scene)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glEnable(GL_DEPTH_TEST);
+
+	readBallPixels(bd, scene, Ball_Mesh, bd.meshPixels);
+	readBallPixels(bd, scene, Ball_Procedural, bd.procPixels);
+
+	u64 covered = 0;
+	u64 off = 0;
+	u32 numPixels = bd.width * bd.height;
+
+	for (u32 p = 0; p < numPixels; ++p) {
+		const u8* m = bd.meshPixels + p * 4;
+		const u8* s = bd.procPixels + p * 4;
+
+		// the clear color is black
+		if ((m[0] | m[1] | m[2] | s[0] | s[1] | s[2]) == 0) {
+			continue;
+		}
+		++covered;
+
+		u32 pixelMax = 0;
+		for (u32 c = 0; c < 3; ++c) {
+			u32 d = (u32)abs((i32)m[c] - (i32)s[c]);
+			bd.absDiffSum += d;
+			pixelMax = max(pixelMax, d);
+		}
+		bd.maxDiff = max(bd.maxDiff, pixelMax);
+		off += (pixelMax > BALL_DIFF_THRESHOLD);
+	}
+
+	bd.covered += covered;
+	bd.off += off;
+
+	r64 frameOff = (covered ? (r64)off / (r64)covered : 0);
+	if (frameOff > bd.worstOff) {
+		bd.worstOff = frameOff;
+		bd.worstFrame = bd.frames;
+	}
+	++bd.frames;
+
+	ASSERT_GL_ERROR;
+}
+
+
+void printBallDiffSummary(
+	const BallDiff& bd)
+{
+	if (bd.frames == 0 || bd.covered == 0) {
+		return;
+	}
+
+	printf("Ball diff: %u frames, mesh vs procedural, %.2f%% of covered pixels off by more than %d, "
+		   "mean abs diff %.2f, max %u, worst frame %u at %.2f%% off\n",
+		   bd.frames,
+		   100.0 * (r64)bd.off / (r64)bd.covered,
+		   BALL_DIFF_THRESHOLD,
+		   (r64)bd.absDiffSum / (r64)(bd.covered * 3),
+		   bd.maxDiff,
+		   bd.worstFrame,
+		   100.0 * bd.worstOff);
+}
+
+
+void freeBallDiff(
+	BallDiff& bd)
+{
+	free(bd.meshPixels);
+	free(bd.procPixels);
+	bd.meshPixels = nullptr;
+	bd.procPixels = nullptr;
+}
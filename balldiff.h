@@ -0,0 +1,49 @@
+#ifndef _BALLDIFF_H
+#define _BALLDIFF_H
+
+#include "utility/types.h"
+
+#define BALL_DIFF_THRESHOLD		8		// a pixel is off when any channel differs by more than this
+
+struct ARU2BA;
+
+/**
+ * Pixel comparison of the two ball renderers, enabled with --ball-diff. Each drawn frame the ball
+ * is rendered alone with the mesh and then with the procedural shader into the back buffer, both
+ * are read back and compared, then the frame is drawn normally. Only pixels covered by either
+ * renderer count. Reading back stalls the pipeline, so frame times are meaningless in this mode.
+ */
+struct BallDiff {
+	u32			width;
+	u32			height;
+	u8*			meshPixels;			// RGBA
+	u8*			procPixels;
+
+	u32			frames;
+	u64			covered;			// pixels drawn by either renderer
+	u64			off;				// covered pixels beyond BALL_DIFF_THRESHOLD
+	u64			absDiffSum;			// over all channels of covered pixels
+	u32			maxDiff;			// largest channel difference seen
+	r64			worstOff;			// largest fraction of covered pixels off in one frame
+	u32			worstFrame;
+};
+
+bool initBallDiff(
+	BallDiff& bd,
+	u32 width,
+	u32 height);
+
+/**
+ * Call before drawScene, leaves the back buffer to be cleared by it.
+ */
+void ballDiffFrame(
+	BallDiff& bd,
+	ARU2BA& scene);
+
+void printBallDiffSummary(
+	const BallDiff& bd);
+
+void freeBallDiff(
+	BallDiff& bd);
+
+#endif
@@ -0,0 +1,255 @@
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cerrno>
+#include <atomic>
+#include <thread>
+#include "dcsbios.h"
+#include "utility/clock.h"
+#include "utility/log.h"
+
+
+#define DCSBIOS_SYNC_BYTE			0x55
+#define DCSBIOS_END_OF_FRAME_ADDR	0xFFFE
+#define DCSBIOS_RECV_TIMEOUT_MS		100
+#define DCSBIOS_STALE_NSEC			2000000000ULL	// no data for this long is treated as goodbye
+
+
+/**
+ * Export stream parser, one byte at a time since frames may span datagrams. The stream is a
+ * sequence of writes into a 64KB memory image:
+ *		[u16 address][u16 byte count][count bytes of u16 data]...
+ * all little endian. Four sync bytes (0x55) precede every frame and reset the parser, and a
+ * write to address 0xFFFE marks the end of a consistent frame.
+ */
+enum DCSBIOSParseState : u8 {
+	DCSBIOSParse_WaitForSync = 0,
+	DCSBIOSParse_AddressLow,
+	DCSBIOSParse_AddressHigh,
+	DCSBIOSParse_CountLow,
+	DCSBIOSParse_CountHigh,
+	DCSBIOSParse_DataLow,
+	DCSBIOSParse_DataHigh
+};
+
+struct DCSBIOSParser {
+	u16					memory[0x8000];	// export memory image, indexed by address / 2
+	u16					address;
+	u16					count;
+	u16					data;
+	u8					syncCount;
+	DCSBIOSParseState	state;
+};
+
+struct DCSBIOSIntOutput {
+	u16		address;
+	u16		mask;
+	u8		shift;
+};
+
+const DCSBIOSIntOutput adiPitchOutput{ DCSBIOS_ADI_PITCH_ADDR, 0xFFFF, 0 };
+const DCSBIOSIntOutput adiBankOutput { DCSBIOS_ADI_BANK_ADDR,  0xFFFF, 0 };
+const DCSBIOSIntOutput adiTurnOutput { DCSBIOS_ADI_TURN_ADDR,  0xFFFF, 0 };
+
+struct DCSBIOSReceiver {
+	int					socket = -1;
+	std::atomic<bool>	running;
+	std::thread			thread;
+	MQTTState*			mqttState;
+	u64					lastRecv_nsec;
+	u32					frames;
+	DCSBIOSParser		parser;
+};
+
+DCSBIOSReceiver dcsbios;
+
+
+u32 readOutput(
+	const DCSBIOSParser& parser,
+	const DCSBIOSIntOutput& output)
+{
+	return (parser.memory[output.address >> 1] & output.mask) >> output.shift;
+}
+
+
+void onDCSBIOSFrame(
+	DCSBIOSReceiver& rx)
+{
+	ADIValues& v = rx.mqttState->values;
+	u64 now_nsec = monotonicNsec();
+
+	v.rawPitch = readOutput(rx.parser, adiPitchOutput);
+	v.rawBank  = readOutput(rx.parser, adiBankOutput);
+	v.rawTurn  = readOutput(rx.parser, adiTurnOutput);
+	v.pitch_nsec = v.bank_nsec = v.turn_nsec = now_nsec;
+	seqlockWrite(rx.mqttState->snapshot, v);
+
+	++rx.frames;
+	logDebug("DCS-BIOS frame {}, pitch={}, bank={}, turn={}", rx.frames, v.rawPitch, v.rawBank, v.rawTurn);
+}
+
+
+/**
+ * Returns true when the byte completes an end-of-frame write.
+ */
+bool parseDCSBIOSByte(
+	DCSBIOSParser& p,
+	u8 c)
+{
+	bool endOfFrame = false;
+
+	switch (p.state) {
+		case DCSBIOSParse_WaitForSync:
+			break;
+
+		case DCSBIOSParse_AddressLow:
+			p.address = c;
+			p.state = DCSBIOSParse_AddressHigh;
+			break;
+
+		case DCSBIOSParse_AddressHigh:
+			p.address |= (u16)c << 8;
+			p.state = (p.address != 0x5555 ? DCSBIOSParse_CountLow : DCSBIOSParse_WaitForSync);
+			break;
+
+		case DCSBIOSParse_CountLow:
+			p.count = c;
+			p.state = DCSBIOSParse_CountHigh;
+			break;
+
+		case DCSBIOSParse_CountHigh:
+			p.count |= (u16)c << 8;
+			p.state = (p.count != 0 ? DCSBIOSParse_DataLow : DCSBIOSParse_AddressLow);
+			break;
+
+		case DCSBIOSParse_DataLow:
+			p.data = c;
+			--p.count;
+			p.state = DCSBIOSParse_DataHigh;
+			break;
+
+		case DCSBIOSParse_DataHigh:
+			p.data |= (u16)c << 8;
+			--p.count;
+			p.memory[p.address >> 1] = p.data;
+			endOfFrame = (p.address == DCSBIOS_END_OF_FRAME_ADDR);
+			p.address += 2;
+			p.state = (p.count > 0 && p.count < 0x8000 ? DCSBIOSParse_DataLow : DCSBIOSParse_AddressLow);
+			break;
+	}
+
+	// four sync bytes restart the parser from any state
+	p.syncCount = (c == DCSBIOS_SYNC_BYTE ? p.syncCount + 1 : 0);
+	if (p.syncCount == 4) {
+		p.syncCount = 0;
+		p.state = DCSBIOSParse_AddressLow;
+	}
+
+	return endOfFrame;
+}
+
+
+void dcsbiosReceiveLoop()
+{
+	DCSBIOSReceiver& rx = dcsbios;
+	u8 packet[2048];
+
+	while (rx.running.load(std::memory_order_relaxed)) {
+		ssize_t len = recv(rx.socket, packet, sizeof(packet), 0);
+		u64 now_nsec = monotonicNsec();
+
+		if (len <= 0) {
+			if (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+				logError("DCS-BIOS recv failed, errno={}", errno);
+			}
+
+			// the export stream stopped, equivalent to the MQTT goodbye message
+			if (rx.lastRecv_nsec != 0 && now_nsec - rx.lastRecv_nsec > DCSBIOS_STALE_NSEC) {
+				ADIValues& v = rx.mqttState->values;
+				v.pitch_nsec = v.bank_nsec = v.turn_nsec = 0;
+				seqlockWrite(rx.mqttState->snapshot, v);
+				rx.lastRecv_nsec = 0;
+				logInfo("DCS-BIOS export stream stopped");
+			}
+			continue;
+		}
+
+		rx.lastRecv_nsec = now_nsec;
+
+		for (ssize_t b = 0; b < len; ++b) {
+			if (parseDCSBIOSByte(rx.parser, packet[b])) {
+				onDCSBIOSFrame(rx);
+			}
+		}
+	}
+}
+
+
+bool initDCSBIOS(
+	MQTTState* mqttState)
+{
+	DCSBIOSReceiver& rx = dcsbios;
+	rx.mqttState = mqttState;
+	rx.parser.state = DCSBIOSParse_WaitForSync;
+
+	rx.socket = socket(AF_INET, SOCK_DGRAM, 0);
+	if (rx.socket < 0) {
+		fprintf(stderr, "DCS-BIOS socket error: %s\n", strerror(errno));
+		return false;
+	}
+
+	int reuse = 1;
+	setsockopt(rx.socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	// time out periodically so the thread can notice shutdown and a stalled stream
+	timeval timeout{ 0, DCSBIOS_RECV_TIMEOUT_MS * 1000 };
+	setsockopt(rx.socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(DCSBIOS_PORT);
+
+	if (bind(rx.socket, (sockaddr*)&addr, sizeof(addr)) < 0) {
+		fprintf(stderr, "DCS-BIOS bind error: %s\n", strerror(errno));
+		close(rx.socket);
+		rx.socket = -1;
+		return false;
+	}
+
+	ip_mreq mreq{};
+	mreq.imr_multiaddr.s_addr = inet_addr(DCSBIOS_MULTICAST_GROUP);
+	mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+
+	if (setsockopt(rx.socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+		fprintf(stderr, "DCS-BIOS multicast join error: %s\n", strerror(errno));
+		close(rx.socket);
+		rx.socket = -1;
+		return false;
+	}
+
+	rx.running.store(true, std::memory_order_relaxed);
+	rx.thread = std::thread(dcsbiosReceiveLoop);
+
+	printf("DCS-BIOS listening on %s:%d...\n", DCSBIOS_MULTICAST_GROUP, DCSBIOS_PORT);
+
+	return true;
+}
+
+
+void cleanupDCSBIOS()
+{
+	DCSBIOSReceiver& rx = dcsbios;
+
+	rx.running.store(false, std::memory_order_relaxed);
+	if (rx.thread.joinable()) {
+		rx.thread.join();
+	}
+	if (rx.socket >= 0) {
+		close(rx.socket);
+		rx.socket = -1;
+	}
+
+	printf("DCS-BIOS cleanup done, %u frames received\n", rx.frames);
+}
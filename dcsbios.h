@@ -0,0 +1,35 @@
+#ifndef _DCSBIOS_H
+#define _DCSBIOS_H
+
+#include "utility/types.h"
+#include "mqtt.h"
+
+#define DCSBIOS_MULTICAST_GROUP	"239.255.50.10"
+#define DCSBIOS_PORT			5010
+
+/**
+ * A-10C ADI integer outputs in the DCS-BIOS export memory map. Addresses are assigned by DCS-BIOS
+ * and can move between releases, so check them against the A-10C control reference of the
+ * installed version (override with -D if needed).
+ */
+#ifndef DCSBIOS_ADI_PITCH_ADDR
+#define DCSBIOS_ADI_PITCH_ADDR	0x1030
+#endif
+#ifndef DCSBIOS_ADI_BANK_ADDR
+#define DCSBIOS_ADI_BANK_ADDR	0x1032
+#endif
+#ifndef DCSBIOS_ADI_TURN_ADDR
+#define DCSBIOS_ADI_TURN_ADDR	0x1038
+#endif
+
+/**
+ * Starts a receiver thread that joins the DCS-BIOS export multicast group and publishes the ADI
+ * values to mqttState->snapshot at the end of every export frame, in the same form the MQTT
+ * handlers do.
+ */
+bool initDCSBIOS(
+	MQTTState* mqttState);
+
+void cleanupDCSBIOS();
+
+#endif
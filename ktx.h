@@ -0,0 +1,84 @@
+#ifndef _KTX_H
+#define _KTX_H
+
+#include <cstring>
+#include "utility/types.h"
+
+/**
+ * KTX 1.1 container for compressed textures, the subset written by tools/png_to_ktx.cpp and read
+ * by loadKTXTexture: one 2D ETC1 image with its mip chain, native byte order, no key/value data
+ * required. Each mip level is a u32 byte count followed by that many bytes of 4x4 blocks, so the
+ * loader hands the mapped file straight to glCompressedTexImage2D.
+ */
+#define KTX_ENDIANNESS				0x04030201
+#define KTX_GL_RGB					0x1907
+#define KTX_GL_ETC1_RGB8_OES		0x8D64
+#define KTX_MAX_LEVELS				16
+#define ETC1_BLOCK_BYTES			8
+
+static const u8 ktxIdentifier[12] = {
+	0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A	// «KTX 11»\r\n\x1A\n
+};
+
+struct KTXHeader {
+	u8		identifier[12];
+	u32		endianness;
+	u32		glType;					// 0 for compressed formats
+	u32		glTypeSize;				// 1 for compressed formats
+	u32		glFormat;				// 0 for compressed formats
+	u32		glInternalFormat;
+	u32		glBaseInternalFormat;
+	u32		pixelWidth;
+	u32		pixelHeight;
+	u32		pixelDepth;
+	u32		numberOfArrayElements;
+	u32		numberOfFaces;
+	u32		numberOfMipmapLevels;
+	u32		bytesOfKeyValueData;
+};
+static_assert(sizeof(KTXHeader) == 64, "");
+
+
+inline u32 etc1ImageSize(
+	u32 width,
+	u32 height)
+{
+	return ((width + 3) / 4) * ((height + 3) / 4) * ETC1_BLOCK_BYTES;
+}
+
+
+/**
+ * Levels in a full chain down to 1x1.
+ */
+inline u32 mipLevelCount(
+	u32 width,
+	u32 height)
+{
+	u32 levels = 1;
+	while (width > 1 || height > 1) {
+		width = (width > 1 ? width / 2 : 1);
+		height = (height > 1 ? height / 2 : 1);
+		++levels;
+	}
+	return levels;
+}
+
+
+/**
+ * Checks the header is the subset this code reads: a single 2D ETC1 image in native byte order.
+ */
+inline bool isETC1KTXHeader(
+	const KTXHeader& h)
+{
+	return memcmp(h.identifier, ktxIdentifier, sizeof(ktxIdentifier)) == 0
+		&& h.endianness == KTX_ENDIANNESS
+		&& h.glType == 0
+		&& h.glInternalFormat == KTX_GL_ETC1_RGB8_OES
+		&& h.pixelWidth > 0 && h.pixelHeight > 0
+		&& h.pixelDepth == 0
+		&& h.numberOfArrayElements == 0
+		&& h.numberOfFaces == 1
+		&& h.numberOfMipmapLevels >= 1 && h.numberOfMipmapLevels <= KTX_MAX_LEVELS;
+}
+
+#endif
@@ -0,0 +1,119 @@
+#include "latency.h"
+#include "utility/log.h"
+
+
+void initLatencyTracker(
+	LatencyTracker& lt)
+{
+	lt.lastSeq = 0;
+	lt.presentRecv_nsec = 0;
+	lt.settleRecv_nsec = 0;
+	lt.settledThisFrame = false;
+	lt.superseded = 0;
+	lt.lastDump_nsec = 0;
+
+	histogramReset(lt.pickup);
+	histogramReset(lt.photon);
+	histogramReset(lt.settled);
+}
+
+
+void latencyOnSnapshot(
+	LatencyTracker& lt,
+	u32 seq,
+	u64 recv_nsec,
+	u64 now_nsec)
+{
+	if (seq == lt.lastSeq) {
+		return;
+	}
+	lt.lastSeq = seq;
+
+	// cleared timestamps (goodbye), nothing to trace
+	if (recv_nsec == 0 || recv_nsec > now_nsec) {
+		return;
+	}
+
+	histogramRecord(lt.pickup, now_nsec - recv_nsec);
+
+	if (lt.settleRecv_nsec != 0) {
+		++lt.superseded;
+	}
+	lt.presentRecv_nsec = recv_nsec;
+	lt.settleRecv_nsec = recv_nsec;
+}
+
+
+void latencyOnInterpolated(
+	LatencyTracker& lt,
+	bool converged)
+{
+	lt.settledThisFrame = (converged && lt.settleRecv_nsec != 0);
+}
+
+
+void latencyOnPresent(
+	LatencyTracker& lt,
+	u64 now_nsec)
+{
+	if (lt.presentRecv_nsec != 0) {
+		histogramRecord(lt.photon, now_nsec - lt.presentRecv_nsec);
+		lt.presentRecv_nsec = 0;
+	}
+
+	if (lt.settledThisFrame) {
+		histogramRecord(lt.settled, now_nsec - lt.settleRecv_nsec);
+		lt.settleRecv_nsec = 0;
+		lt.settledThisFrame = false;
+	}
+}
+
+
+void latencyOnSkip(
+	LatencyTracker& lt)
+{
+	lt.presentRecv_nsec = 0;
+	if (lt.settledThisFrame) {
+		lt.settleRecv_nsec = 0;
+		lt.settledThisFrame = false;
+	}
+}
+
+
+void logLatencyHistogram(
+	const char* name,
+	const Histogram& h)
+{
+	logInfo("latency {}: n={} mean={} ms p50={} ms p99={} ms max={} ms",
+			name, h.total,
+			histogramMean(h) * 1e-6,
+			(r64)histogramPercentile(h, 50.0) * 1e-6,
+			(r64)histogramPercentile(h, 99.0) * 1e-6,
+			(r64)h.max * 1e-6);
+}
+
+
+void latencyDumpStats(
+	LatencyTracker& lt,
+	u64 now_nsec,
+	u64 period_nsec)
+{
+	if (lt.lastDump_nsec == 0) {
+		lt.lastDump_nsec = now_nsec;
+		return;
+	}
+	if (now_nsec - lt.lastDump_nsec < period_nsec) {
+		return;
+	}
+	lt.lastDump_nsec = now_nsec;
+
+	logLatencyHistogram("pickup", lt.pickup);
+	logLatencyHistogram("photon", lt.photon);
+	logLatencyHistogram("settled", lt.settled);
+	logInfo("latency: {} samples superseded before settling", lt.superseded);
+
+	histogramReset(lt.pickup);
+	histogramReset(lt.photon);
+	histogramReset(lt.settled);
+	lt.superseded = 0;
+}
@@ -0,0 +1,69 @@
+#ifndef _LATENCY_H
+#define _LATENCY_H
+
+#include "utility/types.h"
+#include "utility/histogram.h"
+
+/**
+ * Motion-to-photon tracing on the render thread. A sample is one published ADIValues snapshot,
+ * stamped with its receive time by the input handlers. Each sample is followed through
+ *	pickup		receive -> first updateARU2BA that reads the snapshot
+ *	photon		receive -> eglSwapBuffers returns for the first frame drawn with it
+ *	settled		receive -> eglSwapBuffers returns for the frame where interpolation reached it
+ * A sample replaced by a newer one before the ball settles is counted as superseded.
+ */
+struct LatencyTracker {
+	u32			lastSeq;
+	u64			presentRecv_nsec;	// sample waiting for its first present, 0 if none
+	u64			settleRecv_nsec;	// sample the interpolation is easing toward, 0 if none
+	bool		settledThisFrame;
+	u32			superseded;
+	u64			lastDump_nsec;
+
+	Histogram	pickup;
+	Histogram	photon;
+	Histogram	settled;
+};
+
+void initLatencyTracker(
+	LatencyTracker& lt);
+
+/**
+ * Call after reading the snapshot, with the seqlock sequence and newest receive stamp it holds.
+ */
+void latencyOnSnapshot(
+	LatencyTracker& lt,
+	u32 seq,
+	u64 recv_nsec,
+	u64 now_nsec);
+
+/**
+ * Call after interpolation, converged is true when the displayed state equals the target.
+ */
+void latencyOnInterpolated(
+	LatencyTracker& lt,
+	bool converged);
+
+/**
+ * Call when the swap for the frame returns.
+ */
+void latencyOnPresent(
+	LatencyTracker& lt,
+	u64 now_nsec);
+
+/**
+ * Call instead of latencyOnPresent when the frame was skipped because nothing visible changed.
+ * Pending samples did not move the picture, so they are dropped rather than traced.
+ */
+void latencyOnSkip(
+	LatencyTracker& lt);
+
+/**
+ * Log the histograms and reset them if at least period_nsec passed since the last dump.
+ */
+void latencyDumpStats(
+	LatencyTracker& lt,
+	u64 now_nsec,
+	u64 period_nsec);
+
+#endif
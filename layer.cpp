@@ -0,0 +1,97 @@
+#include "layer.h"
+#include "utility/clock.h"
+#include "nanovg/src/nanovg_gl_utils.h"	// second include, for the implementation
+
+
+bool initStaticLayer(
+	StaticLayer& layer,
+	NVGcontext* vg,
+	r32 x, r32 y,
+	u32 width, u32 height,
+	StaticLayerDraw draw)
+{
+	layer = StaticLayer{};
+
+	// NanoVG images are RGBA and premultiplied, the framebuffer gets the stencil buffer that
+	// nvgFill and NVG_STENCIL_STROKES need
+	layer.framebuffer = nvgluCreateFramebuffer(vg, (int)width, (int)height, 0);
+	if (!layer.framebuffer) {
+		fprintf(stderr, "Could not create a %ux%u static layer framebuffer\n", width, height);
+		return false;
+	}
+	layer.x = x;
+	layer.y = y;
+	layer.width = width;
+	layer.height = height;
+	layer.draw = draw;
+	layer.dirty = true;
+
+	return true;
+}
+
+
+void freeStaticLayer(
+	StaticLayer& layer)
+{
+	if (layer.framebuffer) {
+		nvgluDeleteFramebuffer(layer.framebuffer);
+	}
+	layer.framebuffer = nullptr;
+}
+
+
+void updateStaticLayer(
+	StaticLayer& layer,
+	NVGcontext* vg)
+{
+	if (!layer.dirty || !layer.framebuffer) {
+		return;
+	}
+	u64 start_nsec = monotonicNsec();
+
+	GLint viewport[4];
+	GLfloat clearColor[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+
+	nvgluBindFramebuffer(layer.framebuffer);
+	glViewport(0, 0, (GLsizei)layer.width, (GLsizei)layer.height);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+	nvgBeginFrame(vg, layer.width, layer.height, 1.0f);
+	nvgTranslate(vg, -layer.x, -layer.y);
+	layer.draw(vg);
+	nvgEndFrame(vg);
+
+	nvgluBindFramebuffer(nullptr);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+
+	layer.dirty = false;
+	++layer.records;
+	layer.record_nsec = monotonicNsec() - start_nsec;
+}
+
+
+void drawStaticLayer(
+	const StaticLayer& layer,
+	NVGcontext* vg)
+{
+	if (!layer.framebuffer) {
+		return;
+	}
+	r32 x = layer.x;
+	r32 y = layer.y;
+	r32 w = (r32)layer.width;
+	r32 h = (r32)layer.height;
+
+	// no antialiasing fringe, the quad covers whole pixels and the artwork is already antialiased
+	nvgSave(vg);
+	nvgShapeAntiAlias(vg, 0);
+	nvgBeginPath(vg);
+	nvgRect(vg, x, y, w, h);
+	nvgFillPaint(vg, nvgImagePattern(vg, x, y, w, h, 0.0f, layer.framebuffer->image, 1.0f));
+	nvgFill(vg);
+	nvgRestore(vg);
+}
@@ -0,0 +1,64 @@
+#ifndef _LAYER_H
+#define _LAYER_H
+
+#include "utility/types.h"
+#include "GLES2/gl2.h"
+#include "nanovg/src/nanovg.h"
+#include "nanovg/src/nanovg_gl_utils.h"
+
+/**
+ * Retained vector artwork for the parts of the display that never change: bezel, scale markings,
+ * fixed labels. The layer's draw function runs through NanoVG once, into an offscreen RGBA
+ * texture with the stencil buffer NanoVG's fills and strokes need. After that every frame
+ * composites the texture with one textured quad, so NanoVG only flattens and tessellates
+ * the dynamic elements. Mark the layer dirty when what its draw function draws changes and it is
+ * drawn again on the next update.
+ *
+ * The layer covers a rectangle of the screen, keep it to the artwork's bounds. Compositing runs
+ * NanoVG's fragment shader over every pixel of the rectangle, which is not free on the Pi's GPU
+ * (or llvmpipe, where a full 480x640 composite costs more than tessellating a few paths).
+ */
+typedef void (*StaticLayerDraw)(
+	NVGcontext* vg);
+
+struct StaticLayer {
+	NVGLUframebuffer*	framebuffer;
+	r32					x;				// top left corner of the layer on screen
+	r32					y;
+	u32					width;
+	u32					height;
+	StaticLayerDraw		draw;
+	bool				dirty;
+
+	u32					records;		// times the artwork was drawn into the texture
+	u64					record_nsec;	// how long the last of them took
+};
+
+bool initStaticLayer(
+	StaticLayer& layer,
+	NVGcontext* vg,
+	r32 x, r32 y,
+	u32 width, u32 height,
+	StaticLayerDraw draw);
+
+void freeStaticLayer(
+	StaticLayer& layer);
+
+/**
+ * Draws the artwork into the texture if the layer is dirty, in screen coordinates, translated so
+ * x, y lands on the texture's corner. Call outside nvgBeginFrame and nvgEndFrame, it runs a NanoVG
+ * frame of its own. The framebuffer, viewport and clear color are restored.
+ */
+void updateStaticLayer(
+	StaticLayer& layer,
+	NVGcontext* vg);
+
+/**
+ * Composites the layer where the artwork was drawn, call between nvgBeginFrame and nvgEndFrame.
+ * Whole pixel x and y keep the result identical to drawing the artwork directly.
+ */
+void drawStaticLayer(
+	const StaticLayer& layer,
+	NVGcontext* vg);
+
+#endif
@@ -0,0 +1,349 @@
+#ifndef _BATCH_H
+#define _BATCH_H
+
+#include <cmath>
+#include <cstring>
+#include "mat4.h"
+#include "mat3.h"
+#include "quat.h"
+#include "simd.h"
+
+/**
+ * Transforms for many instruments in one pass, stored as structure of arrays: one array per input
+ * and one per matrix element, element e of instrument i at [e][i], so the SIMD loop handles
+ * TRANSFORM_BATCH_LANES instruments per iteration with no shuffles.
+ *
+ * Every instrument is a model rotated by a unit quaternion, then uniformly scaled, which covers
+ * the ADI ball's attitude, a compass card and drum counters, all seen through one view and
+ * projection. The rotation is mat3_cast's, computed in the loop, so there is no trig per frame.
+ *
+ * Arrays are padded to a multiple of TRANSFORM_BATCH_LANES so the loop has no remainder, outputs
+ * past count are unspecified. The caller owns the memory, see transformBatchBytes, the math
+ * library does not allocate.
+ */
+#define TRANSFORM_BATCH_LANES		4
+#define TRANSFORM_BATCH_ARRAYS		(4 + 1 + 16 + 16 + 9)
+
+struct TransformBatch
+{
+	u32		count;
+	u32		stride;				// count rounded up to TRANSFORM_BATCH_LANES, length of every array
+	// in
+	r32*	rotation[4];		// unit quaternion, elements in the order of quat::E
+	r32*	scale;
+	bool	rigidView;			// the view's upper 3x3 is a rotation, see isRigid in camera.h
+	// out, elements in the order of mat4::E and mat3::E
+	r32*	modelView[16];
+	r32*	modelViewProj[16];
+	r32*	normal[9];			// inverse transpose of the upper 3x3 of modelView
+};
+
+
+inline u32 transformBatchStride(
+	u32 count)
+{
+	return (count + TRANSFORM_BATCH_LANES - 1) & ~(u32)(TRANSFORM_BATCH_LANES - 1);
+}
+
+
+size_t transformBatchBytes(
+	u32 count)
+{
+	return sizeof(r32) * transformBatchStride(count) * TRANSFORM_BATCH_ARRAYS;
+}
+
+
+/**
+ * memory holds transformBatchBytes(count). Rotations start at identity and scales at 1, padding
+ * included, so the padding lanes stay finite.
+ */
+void initTransformBatch(
+	TransformBatch& b,
+	u32 count,
+	void* memory)
+{
+	b.count = count;
+	b.stride = transformBatchStride(count);
+
+	r32* p = (r32*)memory;
+	for (u32 e = 0; e < 4; ++e) {
+		b.rotation[e] = p;
+		p += b.stride;
+	}
+	b.scale = p;	p += b.stride;
+	for (u32 e = 0; e < 16; ++e) {
+		b.modelView[e] = p;
+		p += b.stride;
+	}
+	for (u32 e = 0; e < 16; ++e) {
+		b.modelViewProj[e] = p;
+		p += b.stride;
+	}
+	for (u32 e = 0; e < 9; ++e) {
+		b.normal[e] = p;
+		p += b.stride;
+	}
+
+	b.rigidView = false;
+	memset(memory, 0, transformBatchBytes(count));
+	for (u32 i = 0; i < b.stride; ++i) {
+		b.rotation[0][i] = quat_default.w;
+		b.scale[i] = 1.0f;
+	}
+}
+
+
+/**
+ * Instruments first to end one at a time, the body of transformBatch_scalar. The normal matrix is
+ * transpose(inverse(make_mat3(modelView))) without the general inverse. With a rigid view
+ * modelView is a rotation times the scale, so that is modelView over the scale squared. Otherwise
+ * it is the cofactor matrix over the determinant, the columns of modelView crossed in pairs.
+ */
+void transformBatchRange_scalar(
+	TransformBatch& b,
+	const mat4& view,
+	const mat4& proj,
+	u32 first,
+	u32 end)
+{
+	// the model has no translation, so the last column of every modelView is view's
+	vec4 projViewTranslation = multiply_scalar(proj, view[3]);
+
+	for (u32 i = first; i < end; ++i) {
+		r32 qw = b.rotation[0][i], qx = b.rotation[1][i];
+		r32 qy = b.rotation[2][i], qz = b.rotation[3][i];
+		r32 s = b.scale[i];
+
+		r32 qxx = qx * qx, qyy = qy * qy, qzz = qz * qz;
+		r32 qxz = qx * qz, qxy = qx * qy, qyz = qy * qz;
+		r32 qwx = qw * qx, qwy = qw * qy, qwz = qw * qz;
+
+		// columns of mat3_cast(rotation) * scale
+		r32 model[3][3] = {
+			{ (1.0f - 2.0f * (qyy + qzz)) * s,
+			  (2.0f * (qxy + qwz)) * s,
+			  (2.0f * (qxz - qwy)) * s },
+			{ (2.0f * (qxy - qwz)) * s,
+			  (1.0f - 2.0f * (qxx + qzz)) * s,
+			  (2.0f * (qyz + qwx)) * s },
+			{ (2.0f * (qxz + qwy)) * s,
+			  (2.0f * (qyz - qwx)) * s,
+			  (1.0f - 2.0f * (qxx + qyy)) * s }
+		};
+
+		r32 mv[4][4];
+		for (u32 c = 0; c < 3; ++c) {
+			for (u32 r = 0; r < 4; ++r) {
+				mv[c][r] = view[0][r] * model[c][0] + view[1][r] * model[c][1]
+						   + view[2][r] * model[c][2];
+			}
+		}
+		for (u32 r = 0; r < 4; ++r) {
+			mv[3][r] = view[3][r];
+		}
+
+		for (u32 c = 0; c < 4; ++c) {
+			for (u32 r = 0; r < 4; ++r) {
+				b.modelView[c * 4 + r][i] = mv[c][r];
+				b.modelViewProj[c * 4 + r][i] = (c < 3
+					? proj[0][r] * mv[c][0] + proj[1][r] * mv[c][1]
+					  + proj[2][r] * mv[c][2] + proj[3][r] * mv[c][3]
+					: projViewTranslation[r]);
+			}
+		}
+
+		if (b.rigidView) {
+			r32 invScaleSq = 1.0f / (s * s);
+			for (u32 c = 0; c < 3; ++c) {
+				for (u32 r = 0; r < 3; ++r) {
+					b.normal[c * 3 + r][i] = mv[c][r] * invScaleSq;
+				}
+			}
+			continue;
+		}
+
+		r32 n[3][3];
+		for (u32 c = 0; c < 3; ++c) {
+			u32 c1 = (c + 1) % 3, c2 = (c + 2) % 3;
+			for (u32 r = 0; r < 3; ++r) {
+				u32 r1 = (r + 1) % 3, r2 = (r + 2) % 3;
+				n[c][r] = mv[c1][r1] * mv[c2][r2] - mv[c1][r2] * mv[c2][r1];
+			}
+		}
+		r32 invDeterminant = 1.0f / (mv[0][0] * n[0][0] + mv[0][1] * n[0][1] + mv[0][2] * n[0][2]);
+
+		for (u32 c = 0; c < 3; ++c) {
+			for (u32 r = 0; r < 3; ++r) {
+				b.normal[c * 3 + r][i] = n[c][r] * invDeterminant;
+			}
+		}
+	}
+}
+
+
+/**
+ * Reference for transformBatch, and the code that runs when there is no SIMD backend
+ */
+void transformBatch_scalar(
+	TransformBatch& b,
+	const mat4& view,
+	const mat4& proj)
+{
+	transformBatchRange_scalar(b, view, proj, 0, b.count);
+}
+
+
+/**
+ * Fills the outputs of the first count instruments from their inputs. The SIMD loop computes the
+ * same terms in the same order as transformBatch_scalar. An iteration costs more than one scalar
+ * instrument and less than two, so a lone instrument left after the last group, the whole batch
+ * when count is 1, goes through the scalar loop instead.
+ */
+void transformBatch(
+	TransformBatch& b,
+	const mat4& view,
+	const mat4& proj)
+{
+#if QMATH_SIMD
+	if (b.count < 2) {
+		transformBatch_scalar(b, view, proj);
+		return;
+	}
+
+	vec4 projViewTranslation = multiply_scalar(proj, view[3]);
+
+	simd4f v[4][4], p[4][4];
+	for (u32 c = 0; c < 4; ++c) {
+		for (u32 r = 0; r < 4; ++r) {
+			v[c][r] = simd4f_splat(view[c][r]);
+			p[c][r] = simd4f_splat(proj[c][r]);
+		}
+	}
+
+	u32 i = 0;
+	for (; i + 1 < b.count; i += TRANSFORM_BATCH_LANES) {
+		simd4f qw = simd4f_load(b.rotation[0] + i), qx = simd4f_load(b.rotation[1] + i);
+		simd4f qy = simd4f_load(b.rotation[2] + i), qz = simd4f_load(b.rotation[3] + i);
+		simd4f s = simd4f_load(b.scale + i);
+
+		simd4f qxx = simd4f_mul(qx, qx), qyy = simd4f_mul(qy, qy), qzz = simd4f_mul(qz, qz);
+		simd4f qxz = simd4f_mul(qx, qz), qxy = simd4f_mul(qx, qy), qyz = simd4f_mul(qy, qz);
+		simd4f qwx = simd4f_mul(qw, qx), qwy = simd4f_mul(qw, qy), qwz = simd4f_mul(qw, qz);
+		simd4f one = simd4f_splat(1.0f), two = simd4f_splat(2.0f);
+
+		simd4f model[3][3] = {
+			{ simd4f_mul(simd4f_sub(one, simd4f_mul(two, simd4f_add(qyy, qzz))), s),
+			  simd4f_mul(simd4f_mul(two, simd4f_add(qxy, qwz)), s),
+			  simd4f_mul(simd4f_mul(two, simd4f_sub(qxz, qwy)), s) },
+			{ simd4f_mul(simd4f_mul(two, simd4f_sub(qxy, qwz)), s),
+			  simd4f_mul(simd4f_sub(one, simd4f_mul(two, simd4f_add(qxx, qzz))), s),
+			  simd4f_mul(simd4f_mul(two, simd4f_add(qyz, qwx)), s) },
+			{ simd4f_mul(simd4f_mul(two, simd4f_add(qxz, qwy)), s),
+			  simd4f_mul(simd4f_mul(two, simd4f_sub(qyz, qwx)), s),
+			  simd4f_mul(simd4f_sub(one, simd4f_mul(two, simd4f_add(qxx, qyy))), s) }
+		};
+
+		simd4f mv[4][4];
+		for (u32 c = 0; c < 3; ++c) {
+			for (u32 r = 0; r < 4; ++r) {
+				simd4f t = simd4f_add(simd4f_mul(v[0][r], model[c][0]),
+									  simd4f_mul(v[1][r], model[c][1]));
+				mv[c][r] = simd4f_add(t, simd4f_mul(v[2][r], model[c][2]));
+			}
+		}
+		for (u32 r = 0; r < 4; ++r) {
+			mv[3][r] = v[3][r];
+		}
+
+		for (u32 c = 0; c < 4; ++c) {
+			for (u32 r = 0; r < 4; ++r) {
+				simd4f mvp = simd4f_splat(projViewTranslation[r]);
+				if (c < 3) {
+					mvp = simd4f_add(simd4f_mul(p[0][r], mv[c][0]), simd4f_mul(p[1][r], mv[c][1]));
+					mvp = simd4f_add(mvp, simd4f_mul(p[2][r], mv[c][2]));
+					mvp = simd4f_add(mvp, simd4f_mul(p[3][r], mv[c][3]));
+				}
+				simd4f_store(b.modelView[c * 4 + r] + i, mv[c][r]);
+				simd4f_store(b.modelViewProj[c * 4 + r] + i, mvp);
+			}
+		}
+
+		if (b.rigidView) {
+			simd4f invScaleSq = simd4f_div(simd4f_splat(1.0f), simd4f_mul(s, s));
+			for (u32 c = 0; c < 3; ++c) {
+				for (u32 r = 0; r < 3; ++r) {
+					simd4f_store(b.normal[c * 3 + r] + i, simd4f_mul(mv[c][r], invScaleSq));
+				}
+			}
+			continue;
+		}
+
+		simd4f n[3][3];
+		for (u32 c = 0; c < 3; ++c) {
+			u32 c1 = (c + 1) % 3, c2 = (c + 2) % 3;
+			for (u32 r = 0; r < 3; ++r) {
+				u32 r1 = (r + 1) % 3, r2 = (r + 2) % 3;
+				n[c][r] = simd4f_sub(simd4f_mul(mv[c1][r1], mv[c2][r2]),
+									 simd4f_mul(mv[c1][r2], mv[c2][r1]));
+			}
+		}
+		simd4f invDeterminant = simd4f_div(simd4f_splat(1.0f),
+			simd4f_add(simd4f_add(simd4f_mul(mv[0][0], n[0][0]), simd4f_mul(mv[0][1], n[0][1])),
+					   simd4f_mul(mv[0][2], n[0][2])));
+
+		for (u32 c = 0; c < 3; ++c) {
+			for (u32 r = 0; r < 3; ++r) {
+				simd4f_store(b.normal[c * 3 + r] + i, simd4f_mul(n[c][r], invDeterminant));
+			}
+		}
+	}
+
+	if (i < b.count) {
+		transformBatchRange_scalar(b, view, proj, i, b.count);
+	}
+#else
+	transformBatch_scalar(b, view, proj);
+#endif
+}
+
+
+/**
+ * Instrument i's matrices out of the batch, built with the element constructors, not filled into
+ * a default constructed (identity) matrix
+ */
+mat4 batchModelView(
+	const TransformBatch& b,
+	u32 i)
+{
+	r32* const* e = b.modelView;
+	return mat4(e[0][i],  e[1][i],  e[2][i],  e[3][i],
+				e[4][i],  e[5][i],  e[6][i],  e[7][i],
+				e[8][i],  e[9][i],  e[10][i], e[11][i],
+				e[12][i], e[13][i], e[14][i], e[15][i]);
+}
+
+
+mat4 batchModelViewProj(
+	const TransformBatch& b,
+	u32 i)
+{
+	r32* const* e = b.modelViewProj;
+	return mat4(e[0][i],  e[1][i],  e[2][i],  e[3][i],
+				e[4][i],  e[5][i],  e[6][i],  e[7][i],
+				e[8][i],  e[9][i],  e[10][i], e[11][i],
+				e[12][i], e[13][i], e[14][i], e[15][i]);
+}
+
+
+mat3 batchNormal(
+	const TransformBatch& b,
+	u32 i)
+{
+	r32* const* e = b.normal;
+	return mat3(e[0][i], e[1][i], e[2][i],
+				e[3][i], e[4][i], e[5][i],
+				e[6][i], e[7][i], e[8][i]);
+}
+
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef _CAMERA_H
+#define _CAMERA_H
+
+#include <cstring>
+#include "mat4.h"
+#include "mat4_transforms.h"
+
+/**
+ * Largest error in the length and dot products of the columns of a matrix isRigid accepts, well
+ * above the rounding lookAtRH leaves in its normalized axes
+ */
+#define RIGID_COMPARISON_DELTA		0.0001f
+
+/**
+ * View and projection matrices kept across frames and rebuilt only when the values they are
+ * built from change, compared exactly. When the view is built it is also checked for being rigid,
+ * a rotation and translation only, which lets transformBatch use the transpose shortcut for
+ * normal matrices instead of a general inverse.
+ */
+struct CameraCache
+{
+	// what view and proj were built from
+	r32		lookAt[9];			// eye, target, up
+	r32		ortho[6];			// left, right, bottom, top, near, far
+
+	mat4	view;
+	mat4	proj;
+	bool	viewValid;
+	bool	projValid;
+	bool	viewRigid;			// upper 3x3 of view is a rotation, last row is 0 0 0 1
+
+	// counters, never reset by the cache
+	u32		viewBuilds;
+	u32		projBuilds;
+};
+
+
+/**
+ * True when the upper 3x3 of m is orthonormal, to RIGID_COMPARISON_DELTA, and its last row is
+ * 0 0 0 1, so the inverse of the upper 3x3 is its transpose. Handedness is not checked, a
+ * reflection gives the same normal matrix shortcut.
+ */
+bool isRigid(
+	const mat4& m)
+{
+	if (m[0].w != 0.0f || m[1].w != 0.0f || m[2].w != 0.0f || m[3].w != 1.0f) {
+		return false;
+	}
+	for (u32 c = 0; c < 3; ++c) {
+		for (u32 d = c; d < 3; ++d) {
+			r32 dot = m[c].x * m[d].x + m[c].y * m[d].y + m[c].z * m[d].z;
+			if (fabs(dot - (c == d ? 1.0f : 0.0f)) > RIGID_COMPARISON_DELTA) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+
+const mat4& cameraLookAtRH(
+	CameraCache& c,
+	const vec3& eye,
+	const vec3& target,
+	const vec3& up)
+{
+	const r32 in[9] = { eye.x, eye.y, eye.z, target.x, target.y, target.z, up.x, up.y, up.z };
+
+	if (!c.viewValid || memcmp(c.lookAt, in, sizeof(in)) != 0) {
+		memcpy(c.lookAt, in, sizeof(in));
+		c.view = lookAtRH(eye, target, up);
+		c.viewRigid = isRigid(c.view);
+		c.viewValid = true;
+		++c.viewBuilds;
+	}
+	return c.view;
+}
+
+
+const mat4& cameraOrthoRH(
+	CameraCache& c,
+	r32 left, r32 right,
+	r32 bottom, r32 top,
+	r32 zNear, r32 zFar)
+{
+	const r32 in[6] = { left, right, bottom, top, zNear, zFar };
+
+	if (!c.projValid || memcmp(c.ortho, in, sizeof(in)) != 0) {
+		memcpy(c.ortho, in, sizeof(in));
+		c.proj = orthoRH(left, right, bottom, top, zNear, zFar);
+		c.projValid = true;
+		++c.projBuilds;
+	}
+	return c.proj;
+}
+
+
+#endif
\ No newline at end of file
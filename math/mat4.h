@@ -3,6 +3,7 @@
 
 #include "../utility/common.h"
 #include "vec4.h"
+#include "simd.h"
 
 
 struct mat4
@@ -112,12 +113,11 @@ mat4& operator*=(mat4& m, r32 s)
 	return m;
 }
 
+mat4 operator*(const mat4& m1, const mat4& m2);
+
 mat4& operator*=(mat4& m1, const mat4& m2)
 {
-	m1[0] * m2[0][0] + m1[1] * m2[0][1] + m1[2] * m2[0][2] + m1[3] * m2[0][3];
-	m1[0] * m2[1][0] + m1[1] * m2[1][1] + m1[2] * m2[1][2] + m1[3] * m2[1][3];
-	m1[0] * m2[2][0] + m1[1] * m2[2][1] + m1[2] * m2[2][2] + m1[3] * m2[2][3];
-	m1[0] * m2[3][0] + m1[1] * m2[3][1] + m1[2] * m2[3][2] + m1[3] * m2[3][3];
+	m1 = m1 * m2;
 	return m1;
 }
 
@@ -130,7 +130,10 @@ mat4& operator/=(mat4& m, r32 s)
 	return m;
 }
 
-mat4 operator*(const mat4& m1, const mat4& m2)
+// The *_scalar functions are the reference the SIMD kernels in the operators below match bit for
+// bit, and the code that runs when there is no SIMD backend, see simd.h
+
+mat4 multiply_scalar(const mat4& m1, const mat4& m2)
 {
 	return mat4(
 		m1[0] * m2[0][0] + m1[1] * m2[0][1] + m1[2] * m2[0][2] + m1[3] * m2[0][3],
@@ -139,10 +142,27 @@ mat4 operator*(const mat4& m1, const mat4& m2)
 		m1[0] * m2[3][0] + m1[1] * m2[3][1] + m1[2] * m2[3][2] + m1[3] * m2[3][3]);
 }
 
+mat4 operator*(const mat4& m1, const mat4& m2)
+{
+#if QMATH_SIMD
+	simd4f a[4] = {
+		simd4f_load(m1[0].E), simd4f_load(m1[1].E), simd4f_load(m1[2].E), simd4f_load(m1[3].E) };
+
+	vec4 c0, c1, c2, c3;
+	simd4f_store(c0.E, simd4f_combine4(a, m2[0].E));
+	simd4f_store(c1.E, simd4f_combine4(a, m2[1].E));
+	simd4f_store(c2.E, simd4f_combine4(a, m2[2].E));
+	simd4f_store(c3.E, simd4f_combine4(a, m2[3].E));
+	return mat4(c0, c1, c2, c3);
+#else
+	return multiply_scalar(m1, m2);
+#endif
+}
+
 /**
  * returns row vector
  */
-vec4 operator*(
+vec4 multiply_scalar(
 	const vec4& _col,
 	const mat4& m)
 {
@@ -154,9 +174,30 @@ vec4 operator*(
 }
 
 /**
- * returns col vector
+ * returns row vector
  */
 vec4 operator*(
+	const vec4& _col,
+	const mat4& m)
+{
+#if QMATH_SIMD
+	// rows of m are the columns of its transpose
+	simd4f t[4] = {
+		simd4f_load(m[0].E), simd4f_load(m[1].E), simd4f_load(m[2].E), simd4f_load(m[3].E) };
+	simd4f_transpose(t[0], t[1], t[2], t[3]);
+
+	vec4 result;
+	simd4f_store(result.E, simd4f_combine4(t, _col.E));
+	return result;
+#else
+	return multiply_scalar(_col, m);
+#endif
+}
+
+/**
+ * returns col vector
+ */
+vec4 multiply_scalar(
 	const mat4& m,
 	const vec4& _row)
 {
@@ -167,6 +208,25 @@ vec4 operator*(
 		m[0][3] * _row[0] + m[1][3] * _row[1] + m[2][3] * _row[2] + m[3][3] * _row[3]};
 }
 
+/**
+ * returns col vector
+ */
+vec4 operator*(
+	const mat4& m,
+	const vec4& _row)
+{
+#if QMATH_SIMD
+	simd4f a[4] = {
+		simd4f_load(m[0].E), simd4f_load(m[1].E), simd4f_load(m[2].E), simd4f_load(m[3].E) };
+
+	vec4 result;
+	simd4f_store(result.E, simd4f_combine4(a, _row.E));
+	return result;
+#else
+	return multiply_scalar(m, _row);
+#endif
+}
+
 mat4 operator/(const mat4& m, r32 s)
 {
 	return mat4(
@@ -185,7 +245,7 @@ mat4 operator/(r32 s, const mat4& m)
 		s / m[3]);
 }
 
-mat4 inverse(const mat4& m)
+mat4 inverse_scalar(const mat4& m)
 {
 	r32 coef00 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
 	r32 coef02 = m[1][2] * m[3][3] - m[3][2] * m[1][3];
@@ -239,7 +299,64 @@ mat4 inverse(const mat4& m)
 
 	r32 oneOverDeterminant = 1.0f / dot1;
 
-	return inv * oneOverDeterminant;
+	inv *= oneOverDeterminant;
+	return inv;
+}
+
+mat4 inverse(const mat4& m)
+{
+#if QMATH_SIMD
+	// the same cofactors as inverse_scalar, a lane per coefficient: with p = { m[2][r], m[2][r],
+	// m[1][r], m[1][r] } and q = { m[3][r], m[3][r], m[3][r], m[2][r] } for each row r, the factor
+	// of rows i and j is p[i] * q[j] - q[i] * p[j], so fac0 is rows 2 and 3, fac5 rows 0 and 1
+	simd4f row[4] = {
+		simd4f_load(m[0].E), simd4f_load(m[1].E), simd4f_load(m[2].E), simd4f_load(m[3].E) };
+	simd4f_transpose(row[0], row[1], row[2], row[3]);
+
+	simd4f p0 = SIMD4F_SWIZZLE(row[0], 2, 2, 1, 1), q0 = SIMD4F_SWIZZLE(row[0], 3, 3, 3, 2);
+	simd4f p1 = SIMD4F_SWIZZLE(row[1], 2, 2, 1, 1), q1 = SIMD4F_SWIZZLE(row[1], 3, 3, 3, 2);
+	simd4f p2 = SIMD4F_SWIZZLE(row[2], 2, 2, 1, 1), q2 = SIMD4F_SWIZZLE(row[2], 3, 3, 3, 2);
+	simd4f p3 = SIMD4F_SWIZZLE(row[3], 2, 2, 1, 1), q3 = SIMD4F_SWIZZLE(row[3], 3, 3, 3, 2);
+
+	simd4f fac0 = simd4f_sub(simd4f_mul(p2, q3), simd4f_mul(q2, p3));
+	simd4f fac1 = simd4f_sub(simd4f_mul(p1, q3), simd4f_mul(q1, p3));
+	simd4f fac2 = simd4f_sub(simd4f_mul(p1, q2), simd4f_mul(q1, p2));
+	simd4f fac3 = simd4f_sub(simd4f_mul(p0, q3), simd4f_mul(q0, p3));
+	simd4f fac4 = simd4f_sub(simd4f_mul(p0, q2), simd4f_mul(q0, p2));
+	simd4f fac5 = simd4f_sub(simd4f_mul(p0, q1), simd4f_mul(q0, p1));
+
+	simd4f vec0 = SIMD4F_SWIZZLE(row[0], 1, 0, 0, 0);
+	simd4f vec1 = SIMD4F_SWIZZLE(row[1], 1, 0, 0, 0);
+	simd4f vec2 = SIMD4F_SWIZZLE(row[2], 1, 0, 0, 0);
+	simd4f vec3 = SIMD4F_SWIZZLE(row[3], 1, 0, 0, 0);
+
+	simd4f signA = simd4f_set(+1.0f, -1.0f, +1.0f, -1.0f);
+	simd4f signB = simd4f_set(-1.0f, +1.0f, -1.0f, +1.0f);
+
+	simd4f inv0 = simd4f_mul(simd4f_add(simd4f_sub(simd4f_mul(vec1, fac0), simd4f_mul(vec2, fac1)),
+										simd4f_mul(vec3, fac2)), signA);
+	simd4f inv1 = simd4f_mul(simd4f_add(simd4f_sub(simd4f_mul(vec0, fac0), simd4f_mul(vec2, fac3)),
+										simd4f_mul(vec3, fac4)), signB);
+	simd4f inv2 = simd4f_mul(simd4f_add(simd4f_sub(simd4f_mul(vec0, fac1), simd4f_mul(vec1, fac3)),
+										simd4f_mul(vec3, fac5)), signA);
+	simd4f inv3 = simd4f_mul(simd4f_add(simd4f_sub(simd4f_mul(vec0, fac2), simd4f_mul(vec1, fac4)),
+										simd4f_mul(vec2, fac5)), signB);
+
+	vec4 dot0;
+	simd4f_store(dot0.E, simd4f_mul(simd4f_load(m[0].E), SIMD4F_LANE0S(inv0, inv1, inv2, inv3)));
+	r32 dot1 = (dot0.x + dot0.y) + (dot0.z + dot0.w);
+
+	simd4f oneOverDeterminant = simd4f_splat(1.0f / dot1);
+
+	vec4 c0, c1, c2, c3;
+	simd4f_store(c0.E, simd4f_mul(inv0, oneOverDeterminant));
+	simd4f_store(c1.E, simd4f_mul(inv1, oneOverDeterminant));
+	simd4f_store(c2.E, simd4f_mul(inv2, oneOverDeterminant));
+	simd4f_store(c3.E, simd4f_mul(inv3, oneOverDeterminant));
+	return mat4(c0, c1, c2, c3);
+#else
+	return inverse_scalar(m);
+#endif
 }
 
 mat4& operator/=(mat4& m1, const mat4& m2)
@@ -269,7 +386,7 @@ mat4 operator/(const mat4& m1, const mat4& m2)
 	return m1 * inverse(m2);
 }
 
-mat4 transpose(const mat4& m)
+mat4 transpose_scalar(const mat4& m)
 {
 	return mat4(
 		{ m[0][0], m[1][0], m[2][0], m[3][0] },
@@ -278,6 +395,24 @@ mat4 transpose(const mat4& m)
 		{ m[0][3], m[1][3], m[2][3], m[3][3] });
 }
 
+mat4 transpose(const mat4& m)
+{
+#if QMATH_SIMD
+	simd4f c0 = simd4f_load(m[0].E), c1 = simd4f_load(m[1].E);
+	simd4f c2 = simd4f_load(m[2].E), c3 = simd4f_load(m[3].E);
+	simd4f_transpose(c0, c1, c2, c3);
+
+	vec4 t0, t1, t2, t3;
+	simd4f_store(t0.E, c0);
+	simd4f_store(t1.E, c1);
+	simd4f_store(t2.E, c2);
+	simd4f_store(t3.E, c3);
+	return mat4(t0, t1, t2, t3);
+#else
+	return transpose_scalar(m);
+#endif
+}
+
 r32 determinant(const mat4& m)
 {
 	r32 subFactor00 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
@@ -298,75 +433,5 @@ r32 determinant(const mat4& m)
 		m[0][2] * detCof[2] + m[0][3] * detCof[3];
 }
 
-/*
-__m128 determinant_simd(__m128 m[4])
-{
-	// _mm_castsi128_ps(_mm_shuffle_epi32(_mm_castps_si128(add)
-
-	//T SubFactor00 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
-	//T SubFactor01 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
-	//T SubFactor02 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
-	//T SubFactor03 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
-	//T SubFactor04 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
-	//T SubFactor05 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
-
-	// First 2 columns
- 	__m128 Swp2A = _mm_shuffle_ps(m[2], m[2], _MM_SHUFFLE(0, 1, 1, 2));
- 	__m128 Swp3A = _mm_shuffle_ps(m[3], m[3], _MM_SHUFFLE(3, 2, 3, 3));
-	__m128 MulA = _mm_mul_ps(Swp2A, Swp3A);
-
-	// Second 2 columns
-	__m128 Swp2B = _mm_shuffle_ps(m[2], m[2], _MM_SHUFFLE(3, 2, 3, 3));
-	__m128 Swp3B = _mm_shuffle_ps(m[3], m[3], _MM_SHUFFLE(0, 1, 1, 2));
-	__m128 MulB = _mm_mul_ps(Swp2B, Swp3B);
-
-	// Columns subtraction
-	__m128 SubE = _mm_sub_ps(MulA, MulB);
-
-	// Last 2 rows
-	__m128 Swp2C = _mm_shuffle_ps(m[2], m[2], _MM_SHUFFLE(0, 0, 1, 2));
-	__m128 Swp3C = _mm_shuffle_ps(m[3], m[3], _MM_SHUFFLE(1, 2, 0, 0));
-	__m128 MulC = _mm_mul_ps(Swp2C, Swp3C);
-	__m128 SubF = _mm_sub_ps(_mm_movehl_ps(MulC, MulC), MulC);
-
-	//tvec4<T, P> DetCof(
-	//	+ (m[1][1] * SubFactor00 - m[1][2] * SubFactor01 + m[1][3] * SubFactor02),
-	//	- (m[1][0] * SubFactor00 - m[1][2] * SubFactor03 + m[1][3] * SubFactor04),
-	//	+ (m[1][0] * SubFactor01 - m[1][1] * SubFactor03 + m[1][3] * SubFactor05),
-	//	- (m[1][0] * SubFactor02 - m[1][1] * SubFactor04 + m[1][2] * SubFactor05));
-
-	__m128 SubFacA = _mm_shuffle_ps(SubE, SubE, _MM_SHUFFLE(2, 1, 0, 0));
-	__m128 SwpFacA = _mm_shuffle_ps(m[1], m[1], _MM_SHUFFLE(0, 0, 0, 1));
-	__m128 MulFacA = _mm_mul_ps(SwpFacA, SubFacA);
-
-	__m128 SubTmpB = _mm_shuffle_ps(SubE, SubF, _MM_SHUFFLE(0, 0, 3, 1));
-	__m128 SubFacB = _mm_shuffle_ps(SubTmpB, SubTmpB, _MM_SHUFFLE(3, 1, 1, 0));//SubF[0], SubE[3], SubE[3], SubE[1];
-	__m128 SwpFacB = _mm_shuffle_ps(m[1], m[1], _MM_SHUFFLE(1, 1, 2, 2));
-	__m128 MulFacB = _mm_mul_ps(SwpFacB, SubFacB);
-
-	__m128 SubRes = _mm_sub_ps(MulFacA, MulFacB);
-
-	__m128 SubTmpC = _mm_shuffle_ps(SubE, SubF, _MM_SHUFFLE(1, 0, 2, 2));
-	__m128 SubFacC = _mm_shuffle_ps(SubTmpC, SubTmpC, _MM_SHUFFLE(3, 3, 2, 0));
-	__m128 SwpFacC = _mm_shuffle_ps(m[1], m[1], _MM_SHUFFLE(2, 3, 3, 3));
-	__m128 MulFacC = _mm_mul_ps(SwpFacC, SubFacC);
-
-	__m128 AddRes = _mm_add_ps(SubRes, MulFacC);
-	__m128 DetCof = _mm_mul_ps(AddRes, _mm_setr_ps( 1.0f,-1.0f, 1.0f,-1.0f));
-
-	//return m[0][0] * DetCof[0]
-	//	 + m[0][1] * DetCof[1]
-	//	 + m[0][2] * DetCof[2]
-	//	 + m[0][3] * DetCof[3];
-
-	return dot_simd(m[0], DetCof);
-}
-
-r32 determinant_simd(const mat4& m)
-{
-	return _mm_cvtss_f32(determinant_simd((__m128 const(*)[4])m.E));
-}
-*/
-
 
 #endif
\ No newline at end of file
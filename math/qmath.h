@@ -6,5 +6,7 @@
 #include "quat.h"
 #include "conversions.h"
 #include "mat4_transforms.h"
+#include "batch.h"
+#include "camera.h"
 
 #endif
\ No newline at end of file
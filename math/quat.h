@@ -47,10 +47,10 @@ vec3 cross(const quat& q, const vec3& v);
 quat operator-(const quat& rhs)
 {
 	return quat{
-		-rhs.w
+		-rhs.w,
 		-rhs.x,
 		-rhs.y,
-		-rhs.z,
+		-rhs.z
 	};
 }
 
@@ -112,14 +112,40 @@ quat& operator-=(quat& lhs, const quat& rhs)
 	return lhs;
 }
 
-quat& operator*=(quat& lhs, const quat& rhs)
+/**
+ * Reference for the SIMD kernel in operator*=, see simd.h
+ */
+quat multiply_scalar(const quat& lhs, const quat& rhs)
 {
 	quat l(lhs);
-	lhs.w = l.w * rhs.w - l.x * rhs.x - l.y * rhs.y - l.z * rhs.z;
-	lhs.x = l.w * rhs.x + l.x * rhs.w + l.y * rhs.z - l.z * rhs.y;
-	lhs.y = l.w * rhs.y + l.y * rhs.w + l.z * rhs.x - l.x * rhs.z;
-	lhs.z = l.w * rhs.z + l.z * rhs.w + l.x * rhs.y - l.y * rhs.x;
+	quat r;
+	r.w = l.w * rhs.w - l.x * rhs.x - l.y * rhs.y - l.z * rhs.z;
+	r.x = l.w * rhs.x + l.x * rhs.w + l.y * rhs.z - l.z * rhs.y;
+	r.y = l.w * rhs.y + l.y * rhs.w + l.z * rhs.x - l.x * rhs.z;
+	r.z = l.w * rhs.z + l.z * rhs.w + l.x * rhs.y - l.y * rhs.x;
+	return r;
+}
+
+quat& operator*=(quat& lhs, const quat& rhs)
+{
+#if QMATH_SIMD
+	// a column per term of the scalar sums, lane 0 (w) subtracts the second and third terms where
+	// the other lanes add them, negating those lanes is exact so the bits match
+	simd4f l = simd4f_load(lhs.E);
+	simd4f r = simd4f_load(rhs.E);
+	simd4f negW = simd4f_set(-1.0f, 1.0f, 1.0f, 1.0f);
+
+	simd4f t0 = simd4f_mul(SIMD4F_SWIZZLE(l, 0, 0, 0, 0), r);
+	simd4f t1 = simd4f_mul(simd4f_mul(SIMD4F_SWIZZLE(l, 1, 1, 2, 3), SIMD4F_SWIZZLE(r, 1, 0, 0, 0)), negW);
+	simd4f t2 = simd4f_mul(simd4f_mul(SIMD4F_SWIZZLE(l, 2, 2, 3, 1), SIMD4F_SWIZZLE(r, 2, 3, 1, 2)), negW);
+	simd4f t3 = simd4f_mul(SIMD4F_SWIZZLE(l, 3, 3, 1, 2), SIMD4F_SWIZZLE(r, 3, 2, 3, 1));
+
+	simd4f_store(lhs.E, simd4f_sub(simd4f_add(simd4f_add(t0, t1), t2), t3));
+	return lhs;
+#else
+	lhs = multiply_scalar(lhs, rhs);
 	return lhs;
+#endif
 }
 
 // scalar assignment operators
@@ -320,16 +346,12 @@ quat conjugate(const quat& q)
 
 r32 dot(const quat& q1, const quat& q2)
 {
-	// TODO: test speed of these two alternative ways of writing dot
-	// the compiler might generate faster code or be more likely to use SIMD with the first method
-	alignas(16) quat mul(q1);
-	mul *= q2;
-	return (q2.w + q2.x + q2.y + q2.z);
-	/*return (
+	// componentwise, not the quaternion product, slerp and inverse depend on it
+	return (
 		q1.x * q2.x +
 		q1.y * q2.y +
 		q1.z * q2.z +
-		q1.w * q2.w);*/
+		q1.w * q2.w);
 }
 
 quat inverse(const quat& q)
@@ -395,6 +417,22 @@ quat slerp(const quat& q1, const quat& q2, r32 a)
 	}
 }
 
+/**
+ * Eases q toward target by easingFactor of the remaining angle per step, along the shortest arc.
+ * steps may be fractional and the result does not depend on how they are split up, one call of 2
+ * steps lands where two calls of 1 do, so easing by elapsed frames is frame rate independent.
+ * Returns target itself once the two are within slerp's nlerp threshold, about 0.06 degrees, so
+ * convergence can be tested exactly.
+ */
+quat slerpEase(const quat& q, const quat& target, r32 easingFactor, r32 steps)
+{
+	if (fabs(dot(q, target)) > 1.0f - FLT_EPSILON) {
+		return target;
+	}
+	r32 t = 1.0f - powf(1.0f - easingFactor, steps);
+	return normalize(slerp(q, target, t));
+}
+
 quat cross(const quat& q1, const quat& q2)
 {
 	return quat{
@@ -0,0 +1,172 @@
+#ifndef _SIMD_H
+#define _SIMD_H
+
+#include "../utility/types.h"
+
+/**
+ * Four lane r32 vectors for the mat4, quat and batch kernels, the backend chosen at compile time:
+ * NEON on ARM (aarch64, or a Pi 2/3 built with -mfpu=neon-vfpv4), SSE2 on x86, and none otherwise
+ * or when QMATH_SIMD_SCALAR is defined, in which case the math library uses its scalar code.
+ * QMATH_REQUIRE_NEON turns a build that would fall back to scalar into an error, the Makefile sets
+ * it with the NEON flags so a wrong -march or -mfpu can't go unnoticed.
+ *
+ * The kernels only use IEEE add, sub, mul, div and negation, and sum terms in the same order as
+ * the scalar code, so every backend gives the same bits as the scalar functions (the *_scalar
+ * references kept next to each kernel). That holds as long as the compiler does not fuse a
+ * multiply and an add in one path and not the other, so build with -ffp-contract=off, see the
+ * Makefile. tools/math_bench.cpp checks it.
+ */
+#if defined(QMATH_SIMD_SCALAR)
+#define QMATH_SIMD				0
+#define QMATH_SIMD_NAME			"scalar"
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define QMATH_SIMD				1
+#define QMATH_SIMD_NEON
+#define QMATH_SIMD_NAME			"neon"
+
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define QMATH_SIMD				1
+#define QMATH_SIMD_SSE2
+#define QMATH_SIMD_NAME			"sse2"
+
+#else
+#define QMATH_SIMD				0
+#define QMATH_SIMD_NAME			"scalar"
+#endif
+
+#if defined(QMATH_REQUIRE_NEON) && !defined(QMATH_SIMD_NEON)
+#error "QMATH_REQUIRE_NEON is set but NEON is not enabled, check -march and -mfpu or build with QMATH_NEON=0"
+#endif
+
+
+#ifdef QMATH_SIMD_NEON
+
+typedef float32x4_t simd4f;
+
+inline simd4f simd4f_load(const r32* p)			{ return vld1q_f32(p); }
+inline void simd4f_store(r32* p, simd4f v)		{ vst1q_f32(p, v); }
+inline simd4f simd4f_splat(r32 s)				{ return vdupq_n_f32(s); }
+inline simd4f simd4f_add(simd4f a, simd4f b)	{ return vaddq_f32(a, b); }
+inline simd4f simd4f_sub(simd4f a, simd4f b)	{ return vsubq_f32(a, b); }
+inline simd4f simd4f_mul(simd4f a, simd4f b)	{ return vmulq_f32(a, b); }
+inline simd4f simd4f_neg(simd4f a)				{ return vnegq_f32(a); }
+
+/**
+ * IEEE division, not the vrecpeq estimate, armv7 NEON has no vector divide
+ */
+inline simd4f simd4f_div(simd4f a, simd4f b)
+{
+#if defined(__aarch64__)
+	return vdivq_f32(a, b);
+#else
+	r32 x[4], y[4];
+	vst1q_f32(x, a);
+	vst1q_f32(y, b);
+	x[0] /= y[0];
+	x[1] /= y[1];
+	x[2] /= y[2];
+	x[3] /= y[3];
+	return vld1q_f32(x);
+#endif
+}
+
+inline simd4f simd4f_set(r32 x, r32 y, r32 z, r32 w)
+{
+	const r32 v[4] = { x, y, z, w };
+	return vld1q_f32(v);
+}
+
+/**
+ * { a[x], a[y], b[z], b[w] }, the _mm_shuffle_ps selection, lane indexes must be constants
+ */
+#if defined(__clang__)
+#define SIMD4F_SHUFFLE(a, b, x, y, z, w)	__builtin_shufflevector((a), (b), x, y, (z) + 4, (w) + 4)
+#else
+#define SIMD4F_SHUFFLE(a, b, x, y, z, w)	__builtin_shuffle((a), (b), (uint32x4_t){ x, y, (z) + 4, (w) + 4 })
+#endif
+
+inline void simd4f_transpose(
+	simd4f& r0, simd4f& r1, simd4f& r2, simd4f& r3)
+{
+	float32x4x2_t a = vzipq_f32(r0, r2);
+	float32x4x2_t b = vzipq_f32(r1, r3);
+	float32x4x2_t lo = vzipq_f32(a.val[0], b.val[0]);
+	float32x4x2_t hi = vzipq_f32(a.val[1], b.val[1]);
+	r0 = lo.val[0];
+	r1 = lo.val[1];
+	r2 = hi.val[0];
+	r3 = hi.val[1];
+}
+
+#endif
+
+
+#ifdef QMATH_SIMD_SSE2
+
+typedef __m128 simd4f;
+
+inline simd4f simd4f_load(const r32* p)			{ return _mm_loadu_ps(p); }
+inline void simd4f_store(r32* p, simd4f v)		{ _mm_storeu_ps(p, v); }
+inline simd4f simd4f_splat(r32 s)				{ return _mm_set1_ps(s); }
+inline simd4f simd4f_add(simd4f a, simd4f b)	{ return _mm_add_ps(a, b); }
+inline simd4f simd4f_sub(simd4f a, simd4f b)	{ return _mm_sub_ps(a, b); }
+inline simd4f simd4f_mul(simd4f a, simd4f b)	{ return _mm_mul_ps(a, b); }
+inline simd4f simd4f_div(simd4f a, simd4f b)	{ return _mm_div_ps(a, b); }
+inline simd4f simd4f_neg(simd4f a)				{ return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+
+inline simd4f simd4f_set(r32 x, r32 y, r32 z, r32 w)
+{
+	return _mm_setr_ps(x, y, z, w);
+}
+
+/**
+ * { a[x], a[y], b[z], b[w] }, lane indexes must be constants
+ */
+#define SIMD4F_SHUFFLE(a, b, x, y, z, w)	_mm_shuffle_ps((a), (b), _MM_SHUFFLE(w, z, y, x))
+
+inline void simd4f_transpose(
+	simd4f& r0, simd4f& r1, simd4f& r2, simd4f& r3)
+{
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+}
+
+#endif
+
+
+#if QMATH_SIMD
+
+#define SIMD4F_SWIZZLE(a, x, y, z, w)		SIMD4F_SHUFFLE(a, a, x, y, z, w)
+
+/**
+ * { a[0], b[0], c[0], d[0] }
+ */
+#define SIMD4F_LANE0S(a, b, c, d) \
+	SIMD4F_SHUFFLE(SIMD4F_SHUFFLE(a, b, 0, 0, 0, 0), SIMD4F_SHUFFLE(c, d, 0, 0, 0, 0), 0, 2, 0, 2)
+
+/**
+ * v[0]*s[0] + v[1]*s[1] + v[2]*s[2] + v[3]*s[3], added left to right like the vec4 expression it
+ * replaces
+ */
+inline simd4f simd4f_combine4(
+	const simd4f v[4],
+	const r32* s)
+{
+	simd4f r = simd4f_add(simd4f_mul(v[0], simd4f_splat(s[0])), simd4f_mul(v[1], simd4f_splat(s[1])));
+	r = simd4f_add(r, simd4f_mul(v[2], simd4f_splat(s[2])));
+	return simd4f_add(r, simd4f_mul(v[3], simd4f_splat(s[3])));
+}
+
+inline simd4f simd4f_combine3(
+	const simd4f v[3],
+	const r32* s)
+{
+	simd4f r = simd4f_add(simd4f_mul(v[0], simd4f_splat(s[0])), simd4f_mul(v[1], simd4f_splat(s[1])));
+	return simd4f_add(r, simd4f_mul(v[2], simd4f_splat(s[2])));
+}
+
+#endif
+
+#endif
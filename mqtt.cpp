@@ -1,41 +1,91 @@
 #include "mosquitto.h"
 #include "mqtt.h"
+#include "recorder.h"
+#include "utility/hash.h"
+#include "utility/clock.h"
+#include "utility/log.h"
 
 
 mosquitto* mosq = nullptr;
 
+
+/**
+ * Parse an unsigned decimal integer from exactly len bytes of data. The payload does not need to
+ * be NUL terminated. Returns false for empty input, any non-digit byte, or a value over UINT32_MAX.
+ */
+bool parseU32(
+	const void* data,
+	int len,
+	u32& outVal)
+{
+	if (data == nullptr || len <= 0 || len > 10) {
+		return false;
+	}
+
+	const u8* c = (const u8*)data;
+	u64 val = 0;
+	for (int i = 0; i < len; ++i) {
+		u32 digit = (u32)c[i] - '0';
+		if (digit > 9) {
+			return false;
+		}
+		val = val * 10 + digit;
+	}
+	if (val > UINT32_MAX) {
+		return false;
+	}
+
+	outVal = (u32)val;
+	return true;
+}
+
 void handlePitchMsg(
 	MQTTState* mqttState,
 	const mosquitto_message* msg)
 {
-	if (msg->payloadlen) {
-		u32 val = strtoul((char*)msg->payload, nullptr, 10);
-		mqttState->rawPitch = val;
-		u64 since = timer.now_nsec - mqttState->pitch_nsec;
-		mqttState->pitch_nsec = timer.now_nsec; // need sync? assignment of u64 is not atomic
-		printf("handlePitchMsg mid=%d, val=%u, at %llu, %llu since last\n", msg->mid, mqttState->rawPitch, mqttState->pitch_nsec, since);
+	u32 val;
+	if (!parseU32(msg->payload, msg->payloadlen, val)) {
+		logWarn("handlePitchMsg mid={}, invalid payload of length {}", msg->mid, msg->payloadlen);
+		return;
 	}
+
+	ADIValues& v = mqttState->values;
+	u64 now_nsec = monotonicNsec();
+	// 0 since last for the first value, or the first after a goodbye cleared the timestamps
+	logDebug("handlePitchMsg mid={}, val={}, at {}, {} since last", msg->mid, val, now_nsec,
+			 v.pitch_nsec != 0 ? now_nsec - v.pitch_nsec : 0);
+	v.rawPitch = val;
+	v.pitch_nsec = now_nsec;
+	seqlockWrite(mqttState->snapshot, v);
 }
 
 void handleBankMsg(
 	MQTTState* mqttState,
 	const mosquitto_message* msg)
 {
-	if (msg->payloadlen) {
-		u32 val = strtoul((char*)msg->payload, nullptr, 10);
-		mqttState->rawBank = val;
-		u64 since = timer.now_nsec - mqttState->bank_nsec;
-		mqttState->bank_nsec = timer.now_nsec;
-		printf("handleBankMsg mid=%d, val=%u, at %llu, %llu since last\n", msg->mid, mqttState->rawBank, mqttState->bank_nsec, since);
+	u32 val;
+	if (!parseU32(msg->payload, msg->payloadlen, val)) {
+		logWarn("handleBankMsg mid={}, invalid payload of length {}", msg->mid, msg->payloadlen);
+		return;
 	}
+
+	ADIValues& v = mqttState->values;
+	u64 now_nsec = monotonicNsec();
+	// 0 since last for the first value, or the first after a goodbye cleared the timestamps
+	logDebug("handleBankMsg mid={}, val={}, at {}, {} since last", msg->mid, val, now_nsec,
+			 v.bank_nsec != 0 ? now_nsec - v.bank_nsec : 0);
+	v.rawBank = val;
+	v.bank_nsec = now_nsec;
+	seqlockWrite(mqttState->snapshot, v);
 }
 
 void handleGoodbyeMsg(
 	MQTTState* mqttState,
 	const mosquitto_message* msg)
 {
-	MQTTState& st = *mqttState;
-	st.pitch_nsec = st.bank_nsec = st.turn_nsec = 0;
+	ADIValues& v = mqttState->values;
+	v.pitch_nsec = v.bank_nsec = v.turn_nsec = 0;
+	seqlockWrite(mqttState->snapshot, v);
 }
 
 
@@ -46,29 +96,266 @@ typedef void MsgCallback(
 // subscriptions
 struct MQTTSubscription {
 	const char*		topic;
+	u32				topicHash;	// CRC32 of topic, computed at compile time
 	int				qos;
 	MsgCallback*	callback;
 	int				mid;
 };
 
+#define MQTT_SUB(topic, qos, callback)	{ topic, CRC32(topic), qos, callback, 0 }
+
 MQTTSubscription subs[] = {
-	{ "dcs-bios/output/adi/adi_pitch",        0, handlePitchMsg },
-	{ "dcs-bios/output/adi/adi_bank",         0, handleBankMsg },
-	{ "dcs-bios/output/adi/adi_turn",         0, nullptr },
-	{ "dcs-bios/output/adi/adi_slip",         0, nullptr },
-	{ "dcs-bios/output/adi/adi_gs",           0, nullptr },
-	{ "dcs-bios/output/adi/adi_steer_bank",   0, nullptr },
-	{ "dcs-bios/output/adi/adi_steer_pitch",  0, nullptr },
-	{ "dcs-bios/output/adi/adi_pitch_trim",   1, nullptr },
-	{ "dcs-bios/output/adi/adi_attwarn_flag", 1, nullptr },
-	{ "dcs-bios/output/adi/adi_crswarn_flag", 1, nullptr },
-	{ "dcs-bios/output/adi/adi_gswarn_flag",  1, nullptr },
-	{ "dcs-bios/output/light_system_control_panel/lcp_flight_inst", 0, nullptr },
-	{ "dcs-bios/output/metadata/_acft_name",  1, nullptr },
-	{ "dcs-bios/goodbye",                     1, handleGoodbyeMsg }
+	MQTT_SUB("dcs-bios/output/adi/adi_pitch",        0, handlePitchMsg),
+	MQTT_SUB("dcs-bios/output/adi/adi_bank",         0, handleBankMsg),
+	MQTT_SUB("dcs-bios/output/adi/adi_turn",         0, nullptr),
+	MQTT_SUB("dcs-bios/output/adi/adi_slip",         0, nullptr),
+	MQTT_SUB("dcs-bios/output/adi/adi_gs",           0, nullptr),
+	MQTT_SUB("dcs-bios/output/adi/adi_steer_bank",   0, nullptr),
+	MQTT_SUB("dcs-bios/output/adi/adi_steer_pitch",  0, nullptr),
+	MQTT_SUB("dcs-bios/output/adi/adi_pitch_trim",   1, nullptr),
+	MQTT_SUB("dcs-bios/output/adi/adi_attwarn_flag", 1, nullptr),
+	MQTT_SUB("dcs-bios/output/adi/adi_crswarn_flag", 1, nullptr),
+	MQTT_SUB("dcs-bios/output/adi/adi_gswarn_flag",  1, nullptr),
+	MQTT_SUB("dcs-bios/output/light_system_control_panel/lcp_flight_inst", 0, nullptr),
+	MQTT_SUB("dcs-bios/output/metadata/_acft_name",  1, nullptr),
+	MQTT_SUB("dcs-bios/goodbye",                     1, handleGoodbyeMsg)
 };
 
 
+// topic dispatch index
+
+/**
+ * Exact topics are found with a single probe (usually) into an open-addressed table keyed on the
+ * topic CRC32. Subscriptions containing + or # wildcards are placed in a trie of topic levels,
+ * which is only walked when the exact lookup misses.
+ */
+#define MQTT_DISPATCH_TABLE_SIZE	256		// power of 2, keep at least 2x the number of exact subs
+#define MQTT_TRIE_MAX_NODES			128
+#define MQTT_NO_SUB					0xFFFF
+
+static_assert(Q_countof(subs) < MQTT_NO_SUB, "subscription index must fit in u16");
+static_assert((MQTT_DISPATCH_TABLE_SIZE & (MQTT_DISPATCH_TABLE_SIZE - 1)) == 0,
+			  "MQTT_DISPATCH_TABLE_SIZE must be a power of 2");
+static_assert(Q_countof(subs) * 2 <= MQTT_DISPATCH_TABLE_SIZE,
+			  "MQTT_DISPATCH_TABLE_SIZE is too small for the subscription count");
+
+struct TopicDispatchEntry {
+	u32		topicHash;
+	u16		subIndex;	// MQTT_NO_SUB when the slot is empty
+};
+
+/**
+ * Node of the wildcard trie, one node per topic level. Node 0 is the root and has no level.
+ */
+struct TopicTrieNode {
+	const char*	level;		// points into the subscription topic, not NUL terminated
+	u16			levelLen;
+	u16			firstChild;
+	u16			nextSibling;
+	u16			subIndex;	// subscription ending at this node, or MQTT_NO_SUB
+};
+
+struct TopicDispatchIndex {
+	TopicDispatchEntry	table[MQTT_DISPATCH_TABLE_SIZE];
+	TopicTrieNode		trie[MQTT_TRIE_MAX_NODES];
+	u32					numTrieNodes;
+};
+
+TopicDispatchIndex dispatchIndex;
+
+
+bool isWildcardTopic(
+	const char* topic)
+{
+	return (strpbrk(topic, "+#") != nullptr);
+}
+
+
+/**
+ * Returns the length of the topic level starting at level, up to the next '/' or end of string.
+ */
+u32 topicLevelLength(
+	const char* level)
+{
+	const char* end = level;
+	while (*end && *end != '/') {
+		++end;
+	}
+	return (u32)(end - level);
+}
+
+
+void insertWildcardSub(
+	TopicDispatchIndex& index,
+	u16 subIndex)
+{
+	u16 node = 0;
+	const char* level = subs[subIndex].topic;
+
+	for (;;) {
+		u32 levelLen = topicLevelLength(level);
+
+		// find a matching child, or append a new one
+		u16 child = index.trie[node].firstChild;
+		u16 lastChild = 0;
+		while (child != 0
+			   && !(index.trie[child].levelLen == levelLen
+					&& strncmp(index.trie[child].level, level, levelLen) == 0))
+		{
+			lastChild = child;
+			child = index.trie[child].nextSibling;
+		}
+
+		if (child == 0) {
+			assert(index.numTrieNodes < MQTT_TRIE_MAX_NODES && "increase MQTT_TRIE_MAX_NODES");
+			child = (u16)index.numTrieNodes++;
+
+			TopicTrieNode& n = index.trie[child];
+			n.level = level;
+			n.levelLen = (u16)levelLen;
+			n.firstChild = 0;
+			n.nextSibling = 0;
+			n.subIndex = MQTT_NO_SUB;
+
+			if (lastChild != 0) {
+				index.trie[lastChild].nextSibling = child;
+			}
+			else {
+				index.trie[node].firstChild = child;
+			}
+		}
+
+		node = child;
+		if (level[levelLen] == '\0') {
+			break;
+		}
+		level += levelLen + 1;
+	}
+
+	index.trie[node].subIndex = subIndex;
+}
+
+
+void buildDispatchIndex(
+	TopicDispatchIndex& index)
+{
+	for (u32 e = 0; e < MQTT_DISPATCH_TABLE_SIZE; ++e) {
+		index.table[e].topicHash = 0;
+		index.table[e].subIndex = MQTT_NO_SUB;
+	}
+
+	TopicTrieNode& root = index.trie[0];
+	root = TopicTrieNode{ "", 0, 0, 0, MQTT_NO_SUB };
+	index.numTrieNodes = 1;
+
+	for(u16 s = 0;
+		s < Q_countof(subs);
+		++s)
+	{
+		if (isWildcardTopic(subs[s].topic)) {
+			insertWildcardSub(index, s);
+			continue;
+		}
+
+		assert(subs[s].topicHash == crc32(subs[s].topic) && "compile-time topic hash mismatch");
+
+		u32 mask = MQTT_DISPATCH_TABLE_SIZE - 1;
+		u32 e = subs[s].topicHash & mask;
+		while (index.table[e].subIndex != MQTT_NO_SUB) {
+			e = (e + 1) & mask;
+		}
+		index.table[e].topicHash = subs[s].topicHash;
+		index.table[e].subIndex = s;
+	}
+}
+
+
+u16 matchWildcardSub(
+	const TopicDispatchIndex& index,
+	u16 node,
+	const char* level)
+{
+	u32 levelLen = topicLevelLength(level);
+	const char* nextLevel = (level[levelLen] == '/' ? level + levelLen + 1 : nullptr);
+
+	// topics beginning with $ are not matched by wildcards at the first level
+	bool allowWildcard = !(node == 0 && level[0] == '$');
+
+	for(u16 child = index.trie[node].firstChild;
+		child != 0;
+		child = index.trie[child].nextSibling)
+	{
+		const TopicTrieNode& n = index.trie[child];
+
+		if (n.levelLen == 1 && n.level[0] == '#') {
+			if (allowWildcard) {
+				return n.subIndex;
+			}
+			continue;
+		}
+
+		bool levelMatch = (n.levelLen == 1 && n.level[0] == '+')
+			? allowWildcard
+			: (n.levelLen == levelLen && strncmp(n.level, level, levelLen) == 0);
+
+		if (levelMatch) {
+			u16 sub = MQTT_NO_SUB;
+			if (nextLevel) {
+				sub = matchWildcardSub(index, child, nextLevel);
+			}
+			else {
+				sub = n.subIndex;
+				// "a/#" also matches "a"
+				for(u16 c = n.firstChild;
+					sub == MQTT_NO_SUB && c != 0;
+					c = index.trie[c].nextSibling)
+				{
+					if (index.trie[c].levelLen == 1 && index.trie[c].level[0] == '#') {
+						sub = index.trie[c].subIndex;
+					}
+				}
+			}
+			if (sub != MQTT_NO_SUB) {
+				return sub;
+			}
+		}
+	}
+
+	return MQTT_NO_SUB;
+}
+
+
+/**
+ * Returns the index into subs[] of the subscription matching topic, or MQTT_NO_SUB.
+ */
+u16 findSubscription(
+	const TopicDispatchIndex& index,
+	const char* topic)
+{
+	size_t topicLen = strlen(topic);
+	u32 topicHash = crc32(topic, topicLen);
+
+	u32 mask = MQTT_DISPATCH_TABLE_SIZE - 1;
+	for(u32 e = topicHash & mask;
+		index.table[e].subIndex != MQTT_NO_SUB;
+		e = (e + 1) & mask)
+	{
+		const TopicDispatchEntry& entry = index.table[e];
+		if (entry.topicHash == topicHash
+			&& strcmp(subs[entry.subIndex].topic, topic) == 0)
+		{
+			return entry.subIndex;
+		}
+	}
+
+	if (index.trie[0].firstChild != 0) {
+		return matchWildcardSub(index, 0, topic);
+	}
+
+	return MQTT_NO_SUB;
+}
+
+
 void onConnect(
 	mosquitto* mosq,
 	void* userdata,
@@ -93,7 +380,7 @@ void onSubscribe(
 {
 	const char* topic = nullptr;
 	for(uint32_t s = 0;
-		s < countof(subs);
+		s < Q_countof(subs);
 		++s)
 	{
 		if (subs[s].mid == mid) {
@@ -121,33 +408,29 @@ void onMessage(
 	void* userdata,
 	const mosquitto_message* message)
 {
-	for(u32 s = 0;
-		s < countof(subs);
-		++s)
-	{
-		bool match = false;
-		int result = mosquitto_topic_matches_sub(subs[s].topic, message->topic, &match);
-		if (result == MOSQ_ERR_SUCCESS && match) {
-			if (subs[s].callback) {
-				subs[s].callback((MQTTState*)userdata, message);
-			}
-			break;
+	u16 s = findSubscription(dispatchIndex, message->topic);
+	if (s != MQTT_NO_SUB) {
+		recordMessage(s, subs[s].topicHash, message->payload, message->payloadlen, monotonicNsec());
+
+		if (subs[s].callback) {
+			subs[s].callback((MQTTState*)userdata, message);
 		}
 	}
 
-	if (message->payloadlen) {
-		printf("%s %s\n", message->topic, (char*)message->payload);
+	if (message->payloadlen > 0) {
+		logDebug("{} {}", message->topic, logStr(message->payload, (u32)message->payloadlen));
 	}
 	else {
-		printf("%s (null)\n", message->topic);
+		logDebug("{} (null)", message->topic);
 	}
-	fflush(stdout);
 }
 
 
 bool initMQTT(
 	MQTTState* mqttState)
 {
+	buildDispatchIndex(dispatchIndex);
+
 	mosquitto_lib_init();
 
 	mosq = mosquitto_new(
@@ -175,7 +458,7 @@ bool initMQTT(
 		return false;
 	}
 
-	for(u32 s = 0; s < countof(subs); ++s) {
+	for(u32 s = 0; s < Q_countof(subs); ++s) {
 		rc = mosquitto_subscribe(
 			mosq,
 			&subs[s].mid,
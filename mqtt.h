@@ -2,22 +2,35 @@
 #define _MQTT_H
 
 #include "utility/types.h"
+#include "utility/seqlock.h"
 
 #define MQTT_HOST      "192.168.0.174"
 #define MQTT_PORT      1883
 #define MQTT_CLIENT_ID "ADI"
 
-struct MQTTState {
+/**
+ * Raw ADI values as received from DCS-BIOS
+ */
+struct ADIValues {
 	u32		rawPitch;
 	u32		rawBank;
 	u32		rawTurn;
 
-	// last update timestamps
+	// last update timestamps (CLOCK_MONOTONIC), 0 until a value is received
 	u64		pitch_nsec;
 	u64		bank_nsec;
 	u64		turn_nsec;
 };
 
+/**
+ * values is the working copy, only touched by the mosquitto loop thread. Every handler publishes
+ * it to snapshot, which the render loop reads without locking.
+ */
+struct MQTTState {
+	ADIValues			values;
+	SeqLock<ADIValues>	snapshot;
+};
+
 bool initMQTT(
 	MQTTState* mqttState);
 
@@ -24,6 +24,9 @@
 enum FONSflags {
 	FONS_ZERO_TOPLEFT = 1,
 	FONS_ZERO_BOTTOMLEFT = 2,
+	// The atlas holds one signed distance field per glyph instead of a bitmap per size and blur,
+	// see fonsDistanceScale.
+	FONS_SDF = 4,
 };
 
 enum FONSalign {
@@ -127,6 +130,11 @@ float fonsTextBounds(FONScontext* s, float x, float y, const char* string, const
 void fonsLineBounds(FONScontext* s, float y, float* miny, float* maxy);
 void fonsVertMetrics(FONScontext* s, float* ascender, float* descender, float* lineh);
 
+// For FONS_SDF atlases, pixels per unit of the normalized atlas value at the current size and blur,
+// the glyph edge is at 0.5 and coverage is clamp((value-0.5)*scale + 0.5, 0, 1). Returns 0 for
+// bitmap atlases.
+float fonsDistanceScale(FONScontext* s);
+
 // Text iterator
 int fonsTextIterInit(FONScontext* stash, FONStextIter* iter, float x, float y, const char* str, const char* end, int bitmapOption);
 int fonsTextIterNext(FONScontext* stash, FONStextIter* iter, struct FONSquad* quad);
@@ -143,6 +151,8 @@ void fonsDrawDebug(FONScontext* s, float x, float y);
 
 #ifdef FONTSTASH_IMPLEMENTATION
 
+#include <math.h>
+
 #define FONS_NOTUSED(v)  (void)sizeof(v)
 
 #ifdef FONS_USE_FREETYPE
@@ -349,6 +359,16 @@ int fons__tt_getGlyphKernAdvance(FONSttFontImpl *font, int glyph1, int glyph2)
 #ifndef FONS_MAX_FALLBACKS
 #	define FONS_MAX_FALLBACKS 20
 #endif
+// Pixel size distance field glyphs are rasterized at, and how many texels of distance they hold
+// around the edge, which bounds the blur and the smallest scale they can be drawn at.
+#ifndef FONS_SDF_SIZE
+#	define FONS_SDF_SIZE 32
+#endif
+#ifndef FONS_SDF_PAD
+#	define FONS_SDF_PAD 6
+#endif
+#define FONS_SDF_SLOPE (127.5f / FONS_SDF_PAD)	// atlas value units per texel of distance
+#define FONS_SDF_INF 1e20f
 
 static unsigned int fons__hashint(unsigned int a)
 {
@@ -1049,6 +1069,92 @@ static void fons__blur(FONScontext* stash, unsigned char* dst, int w, int h, int
 //	fons__blurcols(dst, w, h, dstStride, alpha);
 }
 
+// Squared distance transform of one row or column, Felzenszwalb and Huttenlocher's lower envelope
+// of parabolas. f holds n values spaced stride apart and is overwritten, v and z are scratch.
+static void fons__edt1d(float* f, int n, int stride, float* d, int* v, float* z)
+{
+	int q, k = 0;
+	float s;
+
+	v[0] = 0;
+	z[0] = -FONS_SDF_INF;
+	z[1] = FONS_SDF_INF;
+	for (q = 0; q < n; q++) d[q] = f[q*stride];
+	for (q = 1; q < n; q++) {
+		do {
+			int r = v[k];
+			s = (d[q] + q*q - d[r] - r*r) / (2*q - 2*r);
+		} while (s <= z[k] && --k > -1);
+		k++;
+		v[k] = q;
+		z[k] = s;
+		z[k+1] = FONS_SDF_INF;
+	}
+	for (q = 0, k = 0; q < n; q++) {
+		while (z[k+1] < q) k++;
+		f[q*stride] = (q - v[k]) * (q - v[k]) + d[v[k]];
+	}
+}
+
+static void fons__edt(float* grid, int w, int h, float* d, int* v, float* z)
+{
+	int x, y;
+	for (x = 0; x < w; x++) fons__edt1d(&grid[x], h, w, d, v, z);
+	for (y = 0; y < h; y++) fons__edt1d(&grid[y*w], w, 1, d, v, z);
+}
+
+// Replaces a rasterized glyph with its signed distance field, 127.5 on the edge and rising by
+// FONS_SDF_SLOPE per texel inside. Antialiased edge texels place the edge within the texel,
+// as in Mapbox's TinySDF, so the field is accurate to a fraction of a texel from one rasterization.
+static void fons__distanceField(unsigned char* dst, int w, int h, int dstStride)
+{
+	int x, y, n = fons__maxi(w, h);
+	float* outer = (float*)malloc(sizeof(float) * (w*h*2 + n*2 + 1));
+	float* inner;
+	float* d;
+	float* z;
+	int* v = (int*)malloc(sizeof(int) * n);
+
+	if (outer == NULL || v == NULL) {
+		free(outer);
+		free(v);
+		return;
+	}
+	inner = outer + w*h;
+	d = inner + w*h;
+	z = d + n;
+
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			float a = dst[x + y*dstStride] / 255.0f;
+			float e = 0.5f - a;
+			if (a >= 1.0f) {
+				outer[x + y*w] = 0.0f;
+				inner[x + y*w] = FONS_SDF_INF;
+			} else if (a <= 0.0f) {
+				outer[x + y*w] = FONS_SDF_INF;
+				inner[x + y*w] = 0.0f;
+			} else {
+				outer[x + y*w] = e > 0.0f ? e*e : 0.0f;
+				inner[x + y*w] = e < 0.0f ? e*e : 0.0f;
+			}
+		}
+	}
+	fons__edt(outer, w, h, d, v, z);
+	fons__edt(inner, w, h, d, v, z);
+
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			float dist = sqrtf(inner[x + y*w]) - sqrtf(outer[x + y*w]);
+			float val = 127.5f + dist * FONS_SDF_SLOPE + 0.5f;
+			dst[x + y*dstStride] = (unsigned char)(val < 0.0f ? 0.0f : (val > 255.0f ? 255.0f : val));
+		}
+	}
+
+	free(outer);
+	free(v);
+}
+
 static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned int codepoint,
 								 short isize, short iblur, int bitmapOption)
 {
@@ -1056,15 +1162,23 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 	float scale;
 	FONSglyph* glyph = NULL;
 	unsigned int h;
-	float size = isize/10.0f;
+	float size;
 	int pad, added;
 	unsigned char* bdst;
 	unsigned char* dst;
 	FONSfont* renderFont = font;
 
 	if (isize < 2) return NULL;
-	if (iblur > 20) iblur = 20;
-	pad = iblur+2;
+	if (stash->params.flags & FONS_SDF) {
+		// One field serves every size, the blur is applied where the glyph is drawn
+		isize = FONS_SDF_SIZE*10;
+		iblur = 0;
+		pad = FONS_SDF_PAD;
+	} else {
+		if (iblur > 20) iblur = 20;
+		pad = iblur+2;
+	}
+	size = isize/10.0f;
 
 	// Reset allocator.
 	stash->nscratch = 0;
@@ -1161,6 +1275,9 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 		dst[x + (gh-1)*stash->params.width] = 0;
 	}
 
+	if (stash->params.flags & FONS_SDF)
+		fons__distanceField(dst, gw, gh, stash->params.width);
+
 	// Debug code to color the glyph background
 /*	unsigned char* fdst = &stash->texData[glyph->x0 + glyph->y0 * stash->params.width];
 	for (y = 0; y < gh; y++) {
@@ -1187,10 +1304,11 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 }
 
 static void fons__getQuad(FONScontext* stash, FONSfont* font,
-						   int prevGlyphIndex, FONSglyph* glyph,
+						   int prevGlyphIndex, FONSglyph* glyph, short isize,
 						   float scale, float spacing, float* x, float* y, FONSquad* q)
 {
 	float rx,ry,xoff,yoff,x0,y0,x1,y1;
+	float gs = (float)isize / (float)glyph->size;	// 1 unless a distance field glyph is drawn at another size
 
 	if (prevGlyphIndex != -1) {
 		float adv = fons__tt_getGlyphKernAdvance(&font->font, prevGlyphIndex, glyph->index) * scale;
@@ -1200,8 +1318,8 @@ static void fons__getQuad(FONScontext* stash, FONSfont* font,
 	// Each glyph has 2px border to allow good interpolation,
 	// one pixel to prevent leaking, and one to allow good interpolation for rendering.
 	// Inset the texture region by one pixel for correct interpolation.
-	xoff = (short)(glyph->xoff+1);
-	yoff = (short)(glyph->yoff+1);
+	xoff = (short)(glyph->xoff+1) * gs;
+	yoff = (short)(glyph->yoff+1) * gs;
 	x0 = (float)(glyph->x0+1);
 	y0 = (float)(glyph->y0+1);
 	x1 = (float)(glyph->x1-1);
@@ -1213,8 +1331,8 @@ static void fons__getQuad(FONScontext* stash, FONSfont* font,
 
 		q->x0 = rx;
 		q->y0 = ry;
-		q->x1 = rx + x1 - x0;
-		q->y1 = ry + y1 - y0;
+		q->x1 = rx + (x1 - x0) * gs;
+		q->y1 = ry + (y1 - y0) * gs;
 
 		q->s0 = x0 * stash->itw;
 		q->t0 = y0 * stash->ith;
@@ -1226,8 +1344,8 @@ static void fons__getQuad(FONScontext* stash, FONSfont* font,
 
 		q->x0 = rx;
 		q->y0 = ry;
-		q->x1 = rx + x1 - x0;
-		q->y1 = ry - y1 + y0;
+		q->x1 = rx + (x1 - x0) * gs;
+		q->y1 = ry - (y1 - y0) * gs;
 
 		q->s0 = x0 * stash->itw;
 		q->t0 = y0 * stash->ith;
@@ -1235,7 +1353,7 @@ static void fons__getQuad(FONScontext* stash, FONSfont* font,
 		q->t1 = y1 * stash->ith;
 	}
 
-	*x += (int)(glyph->xadv / 10.0f + 0.5f);
+	*x += (int)(glyph->xadv * gs / 10.0f + 0.5f);
 }
 
 static void fons__flush(FONScontext* stash)
@@ -1339,7 +1457,7 @@ float fonsDrawText(FONScontext* stash,
 			continue;
 		glyph = fons__getGlyph(stash, font, codepoint, isize, iblur, FONS_GLYPH_BITMAP_REQUIRED);
 		if (glyph != NULL) {
-			fons__getQuad(stash, font, prevGlyphIndex, glyph, scale, state->spacing, &x, &y, &q);
+			fons__getQuad(stash, font, prevGlyphIndex, glyph, isize, scale, state->spacing, &x, &y, &q);
 
 			if (stash->nverts+6 > FONS_VERTEX_COUNT)
 				fons__flush(stash);
@@ -1424,7 +1542,7 @@ int fonsTextIterNext(FONScontext* stash, FONStextIter* iter, FONSquad* quad)
 		glyph = fons__getGlyph(stash, iter->font, iter->codepoint, iter->isize, iter->iblur, iter->bitmapOption);
 		// If the iterator was initialized with FONS_GLYPH_BITMAP_OPTIONAL, then the UV coordinates of the quad will be invalid.
 		if (glyph != NULL)
-			fons__getQuad(stash, iter->font, iter->prevGlyphIndex, glyph, iter->scale, iter->spacing, &iter->nextx, &iter->nexty, quad);
+			fons__getQuad(stash, iter->font, iter->prevGlyphIndex, glyph, iter->isize, iter->scale, iter->spacing, &iter->nextx, &iter->nexty, quad);
 		iter->prevGlyphIndex = glyph != NULL ? glyph->index : -1;
 		break;
 	}
@@ -1521,7 +1639,7 @@ float fonsTextBounds(FONScontext* stash,
 			continue;
 		glyph = fons__getGlyph(stash, font, codepoint, isize, iblur, FONS_GLYPH_BITMAP_OPTIONAL);
 		if (glyph != NULL) {
-			fons__getQuad(stash, font, prevGlyphIndex, glyph, scale, state->spacing, &x, &y, &q);
+			fons__getQuad(stash, font, prevGlyphIndex, glyph, isize, scale, state->spacing, &x, &y, &q);
 			if (q.x0 < minx) minx = q.x0;
 			if (q.x1 > maxx) maxx = q.x1;
 			if (stash->params.flags & FONS_ZERO_TOPLEFT) {
@@ -1579,6 +1697,15 @@ void fonsVertMetrics(FONScontext* stash,
 		*lineh = font->lineh*isize/10.0f;
 }
 
+float fonsDistanceScale(FONScontext* stash)
+{
+	FONSstate* state;
+	if (stash == NULL || (stash->params.flags & FONS_SDF) == 0) return 0.0f;
+	state = fons__getState(stash);
+	// value units to field texels, texels to pixels at this size, then the blur widens the edge ramp
+	return 255.0f / FONS_SDF_SLOPE * (state->size / FONS_SDF_SIZE) / (1.0f + 2.0f*state->blur);
+}
+
 void fonsLineBounds(FONScontext* stash, float y, float* miny, float* maxy)
 {
 	FONSfont* font;
@@ -44,6 +44,9 @@
 #define NVG_INIT_VERTS_SIZE 256
 #define NVG_MAX_STATES 32
 
+#define NVG_TESS_CACHE_SIZE 64			// Entries, two way set associative by the hash of the path commands.
+#define NVG_TESS_CACHE_SCALE_TOL 0.01f	// Relative scale change that tessellates a cached path again.
+
 #define NVG_KAPPA90 0.5522847493f	// Length proportional to radius of a cubic bezier handle for 90deg arcs.
 
 #define NVG_COUNTOF(arr) (sizeof(arr) / sizeof(0[arr]))
@@ -109,22 +112,64 @@ struct NVGpathCache {
 };
 typedef struct NVGpathCache NVGpathCache;
 
+enum NVGtessType {
+	NVG_TESS_NONE = 0,
+	NVG_TESS_FILL,
+	NVG_TESS_STROKE,
+};
+
+// A path tessellated in local space, see nvgTessellationCache().
+struct NVGtessEntry {
+	int type;
+	unsigned int hash;
+	unsigned int lastUse;
+	float* commands;
+	int ncommands;
+	int ccommands;
+	NVGpath* paths;
+	int npaths;
+	int cpaths;
+	NVGvertex* verts;
+	int cverts;
+	float bounds[4];
+	// What the vertices were built with.
+	float scale;
+	float fringeWidth;
+	float strokeWidth;	// In local space.
+	int lineCap;
+	int lineJoin;
+	float miterLimit;
+	int antiAlias;
+};
+typedef struct NVGtessEntry NVGtessEntry;
+
 struct NVGcontext {
 	NVGparams params;
 	float* commands;
 	int ccommands;
 	int ncommands;
 	float commandx, commandy;
+	float* localCommands;		// Commands before the transform, kept for the tessellation cache.
+	float commandXform[6];		// Transform of the first command of the path.
+	int commandXformMixed;		// The transform changed part way through the path.
+	NVGtessEntry* tessCache;	// NVG_TESS_CACHE_SIZE entries, NULL when the cache is disabled.
+	unsigned int tessCacheClock;
+	int tessCacheHits;
+	int tessCacheMisses;
+	int tessCacheBypassed;
 	NVGstate states[NVG_MAX_STATES];
 	int nstates;
 	NVGpathCache* cache;
 	float tessTol;
+	float tessScale;	// Scale of a path tessellated in local space, the bezier test is quadratic in it.
 	float distTol;
 	float fringeWidth;
 	float devicePxRatio;
 	struct FONScontext* fs;
 	int fontImages[NVG_MAX_FONTIMAGES];
 	int fontImageIdx;
+	int fontUploads;
+	int fontUploadTexels;
 	int drawCallCount;
 	int fillTriCount;
 	int strokeTriCount;
@@ -200,6 +245,7 @@ error:
 static void nvg__setDevicePixelRatio(NVGcontext* ctx, float ratio)
 {
 	ctx->tessTol = 0.25f / ratio;
+	ctx->tessScale = 1.0f;
 	ctx->distTol = 0.01f / ratio;
 	ctx->fringeWidth = 1.0f / ratio;
 	ctx->devicePxRatio = ratio;
@@ -315,6 +361,8 @@ NVGcontext* nvgCreateInternal(NVGparams* params)
 	fontParams.width = NVG_INIT_FONTIMAGE_SIZE;
 	fontParams.height = NVG_INIT_FONTIMAGE_SIZE;
 	fontParams.flags = FONS_ZERO_TOPLEFT;
+	if (ctx->params.sdfText)
+		fontParams.flags |= FONS_SDF;
 	fontParams.renderCreate = NULL;
 	fontParams.renderUpdate = NULL;
 	fontParams.renderDraw = NULL;
@@ -346,6 +394,8 @@ void nvgDeleteInternal(NVGcontext* ctx)
 	if (ctx == NULL) return;
 	if (ctx->commands != NULL) free(ctx->commands);
 	if (ctx->cache != NULL) nvg__deletePathCache(ctx->cache);
+	nvgTessellationCache(ctx, 0);
+	if (ctx->localCommands != NULL) free(ctx->localCommands);
 
 	if (ctx->fs)
 		fonsDeleteInternal(ctx->fs);
@@ -1080,9 +1130,25 @@ static void nvg__appendCommands(NVGcontext* ctx, float* vals, int nvals)
 		commands = (float*)realloc(ctx->commands, sizeof(float)*ccommands);
 		if (commands == NULL) return;
 		ctx->commands = commands;
+		if (ctx->tessCache != NULL) {
+			commands = (float*)realloc(ctx->localCommands, sizeof(float)*ccommands);
+			if (commands == NULL) return;
+			ctx->localCommands = commands;
+		}
 		ctx->ccommands = ccommands;
 	}
 
+	// Keep the untransformed commands, and whether the whole path shares one transform.
+	if (ctx->tessCache != NULL) {
+		memcpy(&ctx->localCommands[ctx->ncommands], vals, nvals*sizeof(float));
+		if (ctx->ncommands == 0) {
+			memcpy(ctx->commandXform, state->xform, sizeof(float)*6);
+			ctx->commandXformMixed = 0;
+		} else if (memcmp(ctx->commandXform, state->xform, sizeof(float)*6) != 0) {
+			ctx->commandXformMixed = 1;
+		}
+	}
+
 	if ((int)vals[0] != NVG_CLOSE && (int)vals[0] != NVG_WINDING) {
 		ctx->commandx = vals[nvals-2];
 		ctx->commandy = vals[nvals-1];
@@ -1299,7 +1365,7 @@ static void nvg__tesselateBezier(NVGcontext* ctx,
 	d2 = nvg__absf(((x2 - x4) * dy - (y2 - y4) * dx));
 	d3 = nvg__absf(((x3 - x4) * dy - (y3 - y4) * dx));
 
-	if ((d2 + d3)*(d2 + d3) < ctx->tessTol * (dx*dx + dy*dy)) {
+	if ((d2 + d3)*(d2 + d3) < ctx->tessTol / ctx->tessScale * (dx*dx + dy*dy)) {
 		nvg__addPoint(ctx, x4, y4, type);
 		return;
 	}
@@ -1961,6 +2027,197 @@ static int nvg__expandFill(NVGcontext* ctx, float w, int lineJoin, float miterLi
 	return 1;
 }
 
+static void nvg__deleteTessEntry(NVGtessEntry* e)
+{
+	if (e->commands != NULL) free(e->commands);
+	if (e->paths != NULL) free(e->paths);
+	if (e->verts != NULL) free(e->verts);
+	memset(e, 0, sizeof(NVGtessEntry));
+}
+
+static int nvg__tessReserve(void** p, int* cap, int n, int size)
+{
+	void* q;
+	if (n <= *cap) return 1;
+	q = realloc(*p, (size_t)n * size);
+	if (q == NULL) return 0;
+	*p = q;
+	*cap = n;
+	return 1;
+}
+
+// Returns 1 and the scale of the transform when the current path can use the tessellation cache:
+// every command was added under the same transform, and it is a translation, rotation and uniform
+// scale, which tessellation commutes with once the tolerances are divided by the scale.
+static int nvg__tessCacheable(NVGcontext* ctx, float* scale)
+{
+	const float* t = ctx->commandXform;
+	float s;
+
+	if (ctx->tessCache == NULL || ctx->ncommands == 0) return 0;
+
+	s = nvg__sqrtf(t[0]*t[0] + t[1]*t[1]);
+	if (ctx->commandXformMixed || s < 1e-6f
+		|| nvg__absf(t[0] - t[3]) > s*1e-5f || nvg__absf(t[1] + t[2]) > s*1e-5f) {
+		ctx->tessCacheBypassed++;
+		return 0;
+	}
+	*scale = s;
+	return 1;
+}
+
+// MurmurHash3 (x86, 32 bit) of the path commands, which are whole 32 bit words.
+static unsigned int nvg__hashCommands(const float* commands, int ncommands, unsigned int seed)
+{
+	unsigned int h = seed, k;
+	int i;
+	for (i = 0; i < ncommands; i++) {
+		memcpy(&k, &commands[i], sizeof(k));
+		k *= 0xcc9e2d51;
+		k = (k << 15) | (k >> 17);
+		k *= 0x1b873593;
+		h ^= k;
+		h = (h << 13) | (h >> 19);
+		h = h * 5 + 0xe6546b64;
+	}
+	h ^= (unsigned int)(ncommands * sizeof(float));
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+	return h;
+}
+
+static int nvg__tessEntryMatches(NVGcontext* ctx, const NVGtessEntry* e, int type, unsigned int hash, float scale,
+								 float strokeWidth, int lineCap, int lineJoin, float miterLimit, int antiAlias)
+{
+	return e->type == type && e->hash == hash && e->ncommands == ctx->ncommands
+		&& e->fringeWidth == ctx->fringeWidth && e->antiAlias == antiAlias
+		&& nvg__absf(scale / e->scale - 1.0f) <= NVG_TESS_CACHE_SCALE_TOL
+		&& (type == NVG_TESS_FILL
+			|| (nvg__absf(strokeWidth / e->strokeWidth - 1.0f) <= NVG_TESS_CACHE_SCALE_TOL
+				&& e->lineCap == lineCap && e->lineJoin == lineJoin && e->miterLimit == miterLimit))
+		&& memcmp(e->commands, ctx->localCommands, sizeof(float)*ctx->ncommands) == 0;
+}
+
+// Finds the current path in the tessellation cache, or tessellates it in local space into the least
+// recently used entry of its set. strokeWidth is in local space. Returns NULL if memory runs out,
+// draw the path uncached then.
+static NVGtessEntry* nvg__tessCacheGet(NVGcontext* ctx, int type, float scale, float strokeWidth,
+									   int lineCap, int lineJoin, float miterLimit, int antiAlias)
+{
+	NVGpathCache* cache = ctx->cache;
+	unsigned int hash = nvg__hashCommands(ctx->localCommands, ctx->ncommands, 0x89ABCDEF + type);
+	NVGtessEntry* set = &ctx->tessCache[(hash & (NVG_TESS_CACHE_SIZE/2 - 1)) * 2];
+	NVGtessEntry* e;
+	float* commands = ctx->commands;
+	float tessTol = ctx->tessTol;
+	float distTol = ctx->distTol;
+	float fringeWidth = ctx->fringeWidth;
+	int i, nverts;
+
+	for (i = 0; i < 2; i++) {
+		if (nvg__tessEntryMatches(ctx, &set[i], type, hash, scale, strokeWidth, lineCap, lineJoin, miterLimit, antiAlias)) {
+			set[i].lastUse = ++ctx->tessCacheClock;
+			ctx->tessCacheHits++;
+			return &set[i];
+		}
+	}
+	e = set[0].lastUse <= set[1].lastUse ? &set[0] : &set[1];
+
+	// Tessellate in local space, with the screen space tolerances divided by the scale.
+	nvg__clearPathCache(ctx);
+	ctx->commands = ctx->localCommands;
+	ctx->tessTol = tessTol / scale;
+	ctx->tessScale = scale;
+	ctx->distTol = distTol / scale;
+	ctx->fringeWidth = fringeWidth / scale;
+
+	nvg__flattenPaths(ctx);
+	if (type == NVG_TESS_FILL)
+		nvg__expandFill(ctx, antiAlias ? ctx->fringeWidth : 0.0f, NVG_MITER, 2.4f);
+	else
+		nvg__expandStroke(ctx, strokeWidth*0.5f, antiAlias ? ctx->fringeWidth : 0.0f, lineCap, lineJoin, miterLimit);
+
+	ctx->commands = commands;
+	ctx->tessTol = tessTol;
+	ctx->tessScale = 1.0f;
+	ctx->distTol = distTol;
+	ctx->fringeWidth = fringeWidth;
+
+	nverts = 0;
+	for (i = 0; i < cache->npaths; i++) {
+		const NVGpath* path = &cache->paths[i];
+		if (path->nfill > 0) nverts = nvg__maxi(nverts, (int)(path->fill - cache->verts) + path->nfill);
+		if (path->nstroke > 0) nverts = nvg__maxi(nverts, (int)(path->stroke - cache->verts) + path->nstroke);
+	}
+
+	e->type = NVG_TESS_NONE;
+	if (!nvg__tessReserve((void**)&e->commands, &e->ccommands, ctx->ncommands, sizeof(float))
+		|| !nvg__tessReserve((void**)&e->paths, &e->cpaths, cache->npaths, sizeof(NVGpath))
+		|| !nvg__tessReserve((void**)&e->verts, &e->cverts, nverts, sizeof(NVGvertex))) {
+		nvg__clearPathCache(ctx);
+		ctx->tessCacheBypassed++;
+		return NULL;
+	}
+
+	memcpy(e->commands, ctx->localCommands, sizeof(float)*ctx->ncommands);
+	e->ncommands = ctx->ncommands;
+	memcpy(e->verts, cache->verts, sizeof(NVGvertex)*nverts);
+	for (i = 0; i < cache->npaths; i++) {
+		const NVGpath* path = &cache->paths[i];
+		NVGpath* copy = &e->paths[i];
+		*copy = *path;
+		copy->fill = path->nfill > 0 ? e->verts + (path->fill - cache->verts) : NULL;
+		copy->stroke = path->nstroke > 0 ? e->verts + (path->stroke - cache->verts) : NULL;
+	}
+	e->npaths = cache->npaths;
+	memcpy(e->bounds, cache->bounds, sizeof(e->bounds));
+	e->type = type;
+	e->hash = hash;
+	e->lastUse = ++ctx->tessCacheClock;
+	e->scale = scale;
+	e->fringeWidth = fringeWidth;
+	e->strokeWidth = strokeWidth;
+	e->lineCap = lineCap;
+	e->lineJoin = lineJoin;
+	e->miterLimit = miterLimit;
+	e->antiAlias = antiAlias;
+
+	// The path cache holds local space points now, flatten again if the path is drawn uncached.
+	nvg__clearPathCache(ctx);
+	ctx->tessCacheMisses++;
+	return e;
+}
+
+void nvgTessellationCache(NVGcontext* ctx, int enabled)
+{
+	int i;
+	if (enabled && ctx->tessCache == NULL) {
+		float* localCommands = (float*)realloc(ctx->localCommands, sizeof(float)*ctx->ccommands);
+		if (localCommands == NULL) return;
+		ctx->localCommands = localCommands;
+		ctx->tessCache = (NVGtessEntry*)malloc(sizeof(NVGtessEntry)*NVG_TESS_CACHE_SIZE);
+		if (ctx->tessCache == NULL) return;
+		memset(ctx->tessCache, 0, sizeof(NVGtessEntry)*NVG_TESS_CACHE_SIZE);
+		// The current path was started without its local commands.
+		ctx->commandXformMixed = 1;
+	} else if (!enabled && ctx->tessCache != NULL) {
+		for (i = 0; i < NVG_TESS_CACHE_SIZE; i++)
+			nvg__deleteTessEntry(&ctx->tessCache[i]);
+		free(ctx->tessCache);
+		ctx->tessCache = NULL;
+	}
+}
+
+void nvgTessellationCacheStats(NVGcontext* ctx, int* hits, int* misses, int* bypassed)
+{
+	if (hits) *hits = ctx->tessCacheHits;
+	if (misses) *misses = ctx->tessCacheMisses;
+	if (bypassed) *bypassed = ctx->tessCacheBypassed;
+}
+
 
 // Draw
 void nvgBeginPath(NVGcontext* ctx)
@@ -2220,25 +2477,44 @@ void nvgFill(NVGcontext* ctx)
 {
 	NVGstate* state = nvg__getState(ctx);
 	const NVGpath* path;
+	const NVGpath* paths;
+	const float* bounds;
+	const float* xform = NULL;
+	NVGtessEntry* entry = NULL;
 	NVGpaint fillPaint = state->fill;
-	int i;
-
-	nvg__flattenPaths(ctx);
-	if (ctx->params.edgeAntiAlias && state->shapeAntiAlias)
-		nvg__expandFill(ctx, ctx->fringeWidth, NVG_MITER, 2.4f);
-	else
-		nvg__expandFill(ctx, 0.0f, NVG_MITER, 2.4f);
+	int antiAlias = ctx->params.edgeAntiAlias && state->shapeAntiAlias;
+	float scale;
+	int i, npaths;
+
+	if (nvg__tessCacheable(ctx, &scale))
+		entry = nvg__tessCacheGet(ctx, NVG_TESS_FILL, scale, 0.0f, 0, 0, 0.0f, antiAlias);
+
+	if (entry != NULL) {
+		paths = entry->paths;
+		npaths = entry->npaths;
+		bounds = entry->bounds;
+		xform = ctx->commandXform;
+	} else {
+		nvg__flattenPaths(ctx);
+		if (antiAlias)
+			nvg__expandFill(ctx, ctx->fringeWidth, NVG_MITER, 2.4f);
+		else
+			nvg__expandFill(ctx, 0.0f, NVG_MITER, 2.4f);
+		paths = ctx->cache->paths;
+		npaths = ctx->cache->npaths;
+		bounds = ctx->cache->bounds;
+	}
 
 	// Apply global alpha
 	fillPaint.innerColor.a *= state->alpha;
 	fillPaint.outerColor.a *= state->alpha;
 
 	ctx->params.renderFill(ctx->params.userPtr, &fillPaint, state->compositeOperation, &state->scissor, ctx->fringeWidth,
-						   ctx->cache->bounds, ctx->cache->paths, ctx->cache->npaths);
+						   bounds, paths, npaths, xform);
 
 	// Count triangles
-	for (i = 0; i < ctx->cache->npaths; i++) {
-		path = &ctx->cache->paths[i];
+	for (i = 0; i < npaths; i++) {
+		path = &paths[i];
 		ctx->fillTriCount += path->nfill-2;
 		ctx->fillTriCount += path->nstroke-2;
 		ctx->drawCallCount += 2;
@@ -2252,7 +2528,12 @@ void nvgStroke(NVGcontext* ctx)
 	float strokeWidth = nvg__clampf(state->strokeWidth * scale, 0.0f, 200.0f);
 	NVGpaint strokePaint = state->stroke;
 	const NVGpath* path;
-	int i;
+	const NVGpath* paths;
+	const float* xform = NULL;
+	NVGtessEntry* entry = NULL;
+	int antiAlias = ctx->params.edgeAntiAlias && state->shapeAntiAlias;
+	float cmdScale;
+	int i, npaths;
 
 
 	if (strokeWidth < ctx->fringeWidth) {
@@ -2268,19 +2549,31 @@ void nvgStroke(NVGcontext* ctx)
 	strokePaint.innerColor.a *= state->alpha;
 	strokePaint.outerColor.a *= state->alpha;
 
-	nvg__flattenPaths(ctx);
+	if (nvg__tessCacheable(ctx, &cmdScale))
+		entry = nvg__tessCacheGet(ctx, NVG_TESS_STROKE, cmdScale, strokeWidth / cmdScale,
+								  state->lineCap, state->lineJoin, state->miterLimit, antiAlias);
 
-	if (ctx->params.edgeAntiAlias && state->shapeAntiAlias)
-		nvg__expandStroke(ctx, strokeWidth*0.5f, ctx->fringeWidth, state->lineCap, state->lineJoin, state->miterLimit);
-	else
-		nvg__expandStroke(ctx, strokeWidth*0.5f, 0.0f, state->lineCap, state->lineJoin, state->miterLimit);
+	if (entry != NULL) {
+		paths = entry->paths;
+		npaths = entry->npaths;
+		xform = ctx->commandXform;
+	} else {
+		nvg__flattenPaths(ctx);
+
+		if (antiAlias)
+			nvg__expandStroke(ctx, strokeWidth*0.5f, ctx->fringeWidth, state->lineCap, state->lineJoin, state->miterLimit);
+		else
+			nvg__expandStroke(ctx, strokeWidth*0.5f, 0.0f, state->lineCap, state->lineJoin, state->miterLimit);
+		paths = ctx->cache->paths;
+		npaths = ctx->cache->npaths;
+	}
 
 	ctx->params.renderStroke(ctx->params.userPtr, &strokePaint, state->compositeOperation, &state->scissor, ctx->fringeWidth,
-							 strokeWidth, ctx->cache->paths, ctx->cache->npaths);
+							 strokeWidth, paths, npaths, xform);
 
 	// Count triangles
-	for (i = 0; i < ctx->cache->npaths; i++) {
-		path = &ctx->cache->paths[i];
+	for (i = 0; i < npaths; i++) {
+		path = &paths[i];
 		ctx->strokeTriCount += path->nstroke-2;
 		ctx->drawCallCount++;
 	}
@@ -2383,6 +2676,8 @@ static void nvg__flushTextTexture(NVGcontext* ctx)
 			int w = dirty[2] - dirty[0];
 			int h = dirty[3] - dirty[1];
 			ctx->params.renderUpdateTexture(ctx->params.userPtr, fontImage, x,y, w,h, data);
+			ctx->fontUploads++;
+			ctx->fontUploadTexels += w*h;
 		}
 	}
 }
@@ -2423,7 +2718,8 @@ static void nvg__renderText(NVGcontext* ctx, NVGvertex* verts, int nverts)
 	paint.innerColor.a *= state->alpha;
 	paint.outerColor.a *= state->alpha;
 
-	ctx->params.renderTriangles(ctx->params.userPtr, &paint, state->compositeOperation, &state->scissor, verts, nverts);
+	ctx->params.renderTriangles(ctx->params.userPtr, &paint, state->compositeOperation, &state->scissor, verts, nverts,
+								fonsDistanceScale(ctx->fs));
 
 	ctx->drawCallCount++;
 	ctx->textTriCount += nverts/3;
@@ -2496,6 +2792,12 @@ float nvgText(NVGcontext* ctx, float x, float y, const char* string, const char*
 	return iter.nextx / scale;
 }
 
+void nvgTextAtlasStats(NVGcontext* ctx, int* uploads, int* texels)
+{
+	if (uploads) *uploads = ctx->fontUploads;
+	if (texels) *texels = ctx->fontUploadTexels;
+}
+
 void nvgTextBox(NVGcontext* ctx, float x, float y, float breakRowWidth, const char* string, const char* end)
 {
 	NVGstate* state = nvg__getState(ctx);
@@ -508,6 +508,18 @@ void nvgFill(NVGcontext* ctx);
 // Fills the current path with current stroke style.
 void nvgStroke(NVGcontext* ctx);
 
+// Sets whether nvgFill() and nvgStroke() keep tessellated paths between frames. It's disabled by default.
+// A path built under one transform that is a translation, rotation and uniform scale is tessellated
+// in local space and kept, keyed by a hash of its commands, and the transform is applied by the render
+// back-end. Drawing the same commands again, under any such transform of about the same scale, reuses
+// the vertices. Paths built under other transforms, or with the transform changed part way through,
+// are tessellated every time as usual.
+void nvgTessellationCache(NVGcontext* ctx, int enabled);
+
+// Returns the number of fills and strokes that reused cached vertices, that were tessellated into the
+// cache, and that could not use it, since the context was created.
+void nvgTessellationCacheStats(NVGcontext* ctx, int* hits, int* misses, int* bypassed);
+
 
 //
 // Text
@@ -612,6 +624,9 @@ void nvgTextMetrics(NVGcontext* ctx, float* ascender, float* descender, float* l
 // Words longer than the max width are slit at nearest character (i.e. no hyphenation).
 int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, float breakRowWidth, NVGtextRow* rows, int maxRows);
 
+// Returns how many times the font atlas texture was updated and how many texels were uploaded, since the context was created.
+void nvgTextAtlasStats(NVGcontext* ctx, int* uploads, int* texels);
+
 //
 // Internal Render API
 //
@@ -648,6 +663,7 @@ typedef struct NVGpath NVGpath;
 struct NVGparams {
 	void* userPtr;
 	int edgeAntiAlias;
+	int sdfText;	// the font atlas holds signed distance fields, one per glyph for all sizes
 	int (*renderCreate)(void* uptr);
 	int (*renderCreateTexture)(void* uptr, int type, int w, int h, int imageFlags, const unsigned char* data);
 	int (*renderDeleteTexture)(void* uptr, int image);
@@ -656,9 +672,11 @@ struct NVGparams {
 	void (*renderViewport)(void* uptr, float width, float height, float devicePixelRatio);
 	void (*renderCancel)(void* uptr);
 	void (*renderFlush)(void* uptr);
-	void (*renderFill)(void* uptr, NVGpaint* paint, NVGcompositeOperationState compositeOperation, NVGscissor* scissor, float fringe, const float* bounds, const NVGpath* paths, int npaths);
-	void (*renderStroke)(void* uptr, NVGpaint* paint, NVGcompositeOperationState compositeOperation, NVGscissor* scissor, float fringe, float strokeWidth, const NVGpath* paths, int npaths);
-	void (*renderTriangles)(void* uptr, NVGpaint* paint, NVGcompositeOperationState compositeOperation, NVGscissor* scissor, const NVGvertex* verts, int nverts);
+	// xform maps the path vertices to screen space, NULL when they are already in screen space
+	void (*renderFill)(void* uptr, NVGpaint* paint, NVGcompositeOperationState compositeOperation, NVGscissor* scissor, float fringe, const float* bounds, const NVGpath* paths, int npaths, const float* xform);
+	void (*renderStroke)(void* uptr, NVGpaint* paint, NVGcompositeOperationState compositeOperation, NVGscissor* scissor, float fringe, float strokeWidth, const NVGpath* paths, int npaths, const float* xform);
+	// sdf is 0 for coverage textures, for distance field text the pixels per unit of texture value, see fonsDistanceScale
+	void (*renderTriangles)(void* uptr, NVGpaint* paint, NVGcompositeOperationState compositeOperation, NVGscissor* scissor, const NVGvertex* verts, int nverts, float sdf);
 	void (*renderDelete)(void* uptr);
 };
 typedef struct NVGparams NVGparams;
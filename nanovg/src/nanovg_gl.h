@@ -32,6 +32,12 @@ enum NVGcreateFlags {
 	NVG_STENCIL_STROKES	= 1<<1,
 	// Flag indicating that additional debug checks are done.
 	NVG_DEBUG 			= 1<<2,
+	// Flag indicating that the flush merges calls with the same paint, texture, blend and transform
+	// into single indexed draws, moving a call ahead of others only when their bounds don't overlap.
+	NVG_BATCH_CALLS		= 1<<3,
+	// Flag indicating that text is drawn from signed distance field glyphs, rasterized once and
+	// scaled and rotated freely, instead of a bitmap per font size and blur.
+	NVG_SDF_TEXT		= 1<<4,
 };
 
 #if defined NANOVG_GL2_IMPLEMENTATION
@@ -51,6 +57,51 @@ enum NVGcreateFlags {
 
 #define NANOVG_GL_USE_STATE_FILTER (1)
 
+// Vertex buffers the flushes cycle through. A buffer is written again only after the GPU has had
+// NANOVG_GL_VERTBUF_RING-1 more frames to finish reading it, so the upload does not wait for it.
+// Three covers a tiled GPU like the VideoCore binning one frame while it renders the one before.
+#ifndef NANOVG_GL_VERTBUF_RING
+#define NANOVG_GL_VERTBUF_RING 3
+#endif
+
+// Vertex uploads that take longer than this are counted as slow. Only a CPU side hint, the driver
+// may also block in the draw or the swap, stalls proper are counted from the ring's fences.
+#ifndef NANOVG_GL_SLOW_UPLOAD_NSEC
+#define NANOVG_GL_SLOW_UPLOAD_NSEC 500000
+#endif
+
+// How many calls ahead the batching pass looks for one with the same state.
+#ifndef NANOVG_GL_BATCH_WINDOW
+#define NANOVG_GL_BATCH_WINDOW 32
+#endif
+
+// Draw counters since the context was created.
+struct NVGLdrawStats {
+	int flushes;
+	int calls;						// fills, strokes and triangle sets recorded
+	int batches;					// groups of calls drawn with one state setup, calls without NVG_BATCH_CALLS
+	int draws;						// glDrawArrays and glDrawElements
+	int uniformUploads;
+	int uniformsSkipped;			// uniform uploads skipped, the same values were already set
+	int unbatchedFlushes;			// flushes with too many vertices for 16 bit indices, drawn call by call
+};
+typedef struct NVGLdrawStats NVGLdrawStats;
+
+// Vertex streaming counters since the context was created.
+struct NVGLstreamStats {
+	int flushes;					// flushes that uploaded vertices
+	unsigned long long bytes;		// vertex and index bytes uploaded
+	int lastBytes;					// by the most recent flush
+	int maxBytes;					// by the largest flush
+	int reallocs;					// ring buffers (re)allocated to fit a larger flush
+	int fenced;						// 1 if the ring slots are fenced, stalls are only counted then
+	int stalls;						// ring slots reused before the fence of their last flush signalled
+	int slowUploads;				// uploads slower than NANOVG_GL_SLOW_UPLOAD_NSEC
+	unsigned long long uploadNsec;	// CPU time spent uploading
+	unsigned long long maxUploadNsec;
+};
+typedef struct NVGLstreamStats NVGLstreamStats;
+
 // Creates NanoVG contexts for different OpenGL (ES) versions.
 // Flags should be combination of the create flags above.
 
@@ -61,6 +112,8 @@ void nvgDeleteGL2(NVGcontext* ctx);
 
 int nvglCreateImageFromHandleGL2(NVGcontext* ctx, GLuint textureId, int w, int h, int flags);
 GLuint nvglImageHandleGL2(NVGcontext* ctx, int image);
+void nvglStreamStatsGL2(NVGcontext* ctx, NVGLstreamStats* stats);
+void nvglDrawStatsGL2(NVGcontext* ctx, NVGLdrawStats* stats);
 
 #endif
 
@@ -71,6 +124,8 @@ void nvgDeleteGL3(NVGcontext* ctx);
 
 int nvglCreateImageFromHandleGL3(NVGcontext* ctx, GLuint textureId, int w, int h, int flags);
 GLuint nvglImageHandleGL3(NVGcontext* ctx, int image);
+void nvglStreamStatsGL3(NVGcontext* ctx, NVGLstreamStats* stats);
+void nvglDrawStatsGL3(NVGcontext* ctx, NVGLdrawStats* stats);
 
 #endif
 
@@ -81,6 +136,8 @@ void nvgDeleteGLES2(NVGcontext* ctx);
 
 int nvglCreateImageFromHandleGLES2(NVGcontext* ctx, GLuint textureId, int w, int h, int flags);
 GLuint nvglImageHandleGLES2(NVGcontext* ctx, int image);
+void nvglStreamStatsGLES2(NVGcontext* ctx, NVGLstreamStats* stats);
+void nvglDrawStatsGLES2(NVGcontext* ctx, NVGLdrawStats* stats);
 
 #endif
 
@@ -91,6 +148,8 @@ void nvgDeleteGLES3(NVGcontext* ctx);
 
 int nvglCreateImageFromHandleGLES3(NVGcontext* ctx, GLuint textureId, int w, int h, int flags);
 GLuint nvglImageHandleGLES3(NVGcontext* ctx, int image);
+void nvglStreamStatsGLES3(NVGcontext* ctx, NVGLstreamStats* stats);
+void nvglDrawStatsGLES3(NVGcontext* ctx, NVGLdrawStats* stats);
 
 #endif
 
@@ -111,10 +170,12 @@ enum NVGimageFlagsGL {
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <time.h>
 #include "nanovg.h"
 
 enum GLNVGuniformLoc {
 	GLNVG_LOC_VIEWSIZE,
+	GLNVG_LOC_XFORM,
 	GLNVG_LOC_TEX,
 	GLNVG_LOC_FRAG,
 	GLNVG_MAX_LOCS
@@ -124,7 +185,8 @@ enum GLNVGshaderType {
 	NSVG_SHADER_FILLGRAD,
 	NSVG_SHADER_FILLIMG,
 	NSVG_SHADER_SIMPLE,
-	NSVG_SHADER_IMG
+	NSVG_SHADER_IMG,
+	NSVG_SHADER_SDF
 };
 
 #if NANOVG_GL_USE_UNIFORMBUFFER
@@ -176,9 +238,23 @@ struct GLNVGcall {
 	int triangleCount;
 	int uniformOffset;
 	GLNVGblend blendFunc;
+	float xform[6];		// path vertices to screen space, identity unless they come from the tessellation cache
+	float bounds[4];	// screen space bounds of the vertices, with NVG_BATCH_CALLS
+	int batched;		// drawn by a batch already, during the batching pass
 };
 typedef struct GLNVGcall GLNVGcall;
 
+// Calls drawn with the state of the first, all their triangles in one index range. A fill draws its
+// stencil fans from the index range and its fringes from the second range.
+struct GLNVGbatch {
+	int call;
+	int indexOffset;
+	int indexCount;
+	int fringeOffset;
+	int fringeCount;
+};
+typedef struct GLNVGbatch GLNVGbatch;
+
 struct GLNVGpath {
 	int fillOffset;
 	int fillCount;
@@ -228,6 +304,18 @@ struct GLNVGfragUniforms {
 };
 typedef struct GLNVGfragUniforms GLNVGfragUniforms;
 
+// Fences on the vertex ring: GL sync objects where the API has them, EGL_KHR_fence_sync for GLES2
+// and GL2 when EGL is included before this file, otherwise none and stalls are not counted.
+#if defined NANOVG_GL3 || defined NANOVG_GLES3
+#  define NANOVG_GL_SYNC 1
+typedef GLsync GLNVGfence;
+#elif defined EGL_KHR_fence_sync
+#  define NANOVG_EGL_SYNC 1
+typedef EGLSyncKHR GLNVGfence;
+#else
+typedef void* GLNVGfence;
+#endif
+
 struct GLNVGcontext {
 	GLNVGshader shader;
 	GLNVGtexture* textures;
@@ -235,7 +323,20 @@ struct GLNVGcontext {
 	int ntextures;
 	int ctextures;
 	int textureId;
-	GLuint vertBuf;
+	GLuint vertBuf[NANOVG_GL_VERTBUF_RING];
+	int vertBufSize[NANOVG_GL_VERTBUF_RING];	// bytes allocated
+	int vertBufIndex;							// buffer used by the last flush
+	GLuint indexBuf[NANOVG_GL_VERTBUF_RING];	// batch indices, same ring slot as the vertices
+	int indexBufSize[NANOVG_GL_VERTBUF_RING];
+	GLNVGfence vertBufFence[NANOVG_GL_VERTBUF_RING];	// set after the last flush that drew from the slot
+#if NANOVG_EGL_SYNC
+	EGLDisplay eglDisplay;
+	PFNEGLCREATESYNCKHRPROC createSync;
+	PFNEGLCLIENTWAITSYNCKHRPROC clientWaitSync;
+	PFNEGLDESTROYSYNCKHRPROC destroySync;
+#endif
+	NVGLstreamStats stream;
+	NVGLdrawStats draw;
 #if defined NANOVG_GL3
 	GLuint vertArr;
 #endif
@@ -258,6 +359,12 @@ struct GLNVGcontext {
 	unsigned char* uniforms;
 	int cuniforms;
 	int nuniforms;
+	GLNVGbatch* batches;
+	int cbatches;
+	int nbatches;
+	GLushort* indices;
+	int cindices;
+	int nindices;
 
 	// cached state
 	#if NANOVG_GL_USE_STATE_FILTER
@@ -267,11 +374,17 @@ struct GLNVGcontext {
 	GLint stencilFuncRef;
 	GLuint stencilFuncMask;
 	GLNVGblend blendFunc;
+	int boundFragValid;
+	GLNVGfragUniforms boundFrag;
 	#endif
+	float xform[6];		// xform uniform last set by the flush
 };
 typedef struct GLNVGcontext GLNVGcontext;
 
 static int glnvg__maxi(int a, int b) { return a > b ? a : b; }
+static int glnvg__mini(int a, int b) { return a < b ? a : b; }
+static float glnvg__maxf(float a, float b) { return a > b ? a : b; }
+static float glnvg__minf(float a, float b) { return a < b ? a : b; }
 
 #ifdef NANOVG_GLES2
 static unsigned int glnvg__nearestPow2(unsigned int num)
@@ -491,6 +604,7 @@ static void glnvg__deleteShader(GLNVGshader* shader)
 static void glnvg__getUniforms(GLNVGshader* shader)
 {
 	shader->loc[GLNVG_LOC_VIEWSIZE] = glGetUniformLocation(shader->prog, "viewSize");
+	shader->loc[GLNVG_LOC_XFORM] = glGetUniformLocation(shader->prog, "xform");
 	shader->loc[GLNVG_LOC_TEX] = glGetUniformLocation(shader->prog, "tex");
 
 #if NANOVG_GL_USE_UNIFORMBUFFER
@@ -500,6 +614,65 @@ static void glnvg__getUniforms(GLNVGshader* shader)
 #endif
 }
 
+// Looks up EGL_KHR_fence_sync on the current display, GL3 and GLES3 have sync objects built in.
+static void glnvg__initFences(GLNVGcontext* gl)
+{
+#if NANOVG_GL_SYNC
+	gl->stream.fenced = 1;
+#elif NANOVG_EGL_SYNC
+	const char* extensions;
+	gl->eglDisplay = eglGetCurrentDisplay();
+	if (gl->eglDisplay == EGL_NO_DISPLAY) return;
+	extensions = eglQueryString(gl->eglDisplay, EGL_EXTENSIONS);
+	if (extensions == NULL || strstr(extensions, "EGL_KHR_fence_sync") == NULL) return;
+	gl->createSync = (PFNEGLCREATESYNCKHRPROC)eglGetProcAddress("eglCreateSyncKHR");
+	gl->clientWaitSync = (PFNEGLCLIENTWAITSYNCKHRPROC)eglGetProcAddress("eglClientWaitSyncKHR");
+	gl->destroySync = (PFNEGLDESTROYSYNCKHRPROC)eglGetProcAddress("eglDestroySyncKHR");
+	gl->stream.fenced = gl->createSync != NULL && gl->clientWaitSync != NULL && gl->destroySync != NULL;
+#endif
+}
+
+// Fences a ring slot after the draws of the flush that used it.
+static void glnvg__fenceSlot(GLNVGcontext* gl, int i)
+{
+	if (!gl->stream.fenced) return;
+#if NANOVG_GL_SYNC
+	gl->vertBufFence[i] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#elif NANOVG_EGL_SYNC
+	gl->vertBufFence[i] = gl->createSync(gl->eglDisplay, EGL_SYNC_FENCE_KHR, NULL);
+	if (gl->vertBufFence[i] == EGL_NO_SYNC_KHR) gl->vertBufFence[i] = NULL;
+#endif
+}
+
+// Tests the fence of a ring slot about to be reused without waiting on it, counts a stall if the
+// GPU has not signalled it yet, and releases it. The upload that follows is left to the driver.
+static void glnvg__checkFence(GLNVGcontext* gl, int i)
+{
+	GLNVGfence fence = gl->vertBufFence[i];
+	if (fence == NULL) return;
+#if NANOVG_GL_SYNC
+	if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) gl->stream.stalls++;
+	glDeleteSync(fence);
+#elif NANOVG_EGL_SYNC
+	if (gl->clientWaitSync(gl->eglDisplay, fence, 0, 0) == EGL_TIMEOUT_EXPIRED_KHR) gl->stream.stalls++;
+	gl->destroySync(gl->eglDisplay, fence);
+#endif
+	gl->vertBufFence[i] = NULL;
+}
+
+static void glnvg__deleteFences(GLNVGcontext* gl)
+{
+	int i;
+	for (i = 0; i < NANOVG_GL_VERTBUF_RING; i++) {
+#if NANOVG_GL_SYNC
+		if (gl->vertBufFence[i] != NULL) glDeleteSync(gl->vertBufFence[i]);
+#elif NANOVG_EGL_SYNC
+		if (gl->vertBufFence[i] != NULL) gl->destroySync(gl->eglDisplay, gl->vertBufFence[i]);
+#endif
+		gl->vertBufFence[i] = NULL;
+	}
+}
+
 static int glnvg__renderCreate(void* uptr)
 {
 	GLNVGcontext* gl = (GLNVGcontext*)uptr;
@@ -529,6 +702,7 @@ static int glnvg__renderCreate(void* uptr)
 	"\n";
 
 	static const char* fillVertShader =
+		"	uniform vec2 xform[3];\n"
 		"#ifdef NANOVG_GL3\n"
 		"	uniform vec2 viewSize;\n"
 		"	in vec2 vertex;\n"
@@ -543,9 +717,10 @@ static int glnvg__renderCreate(void* uptr)
 		"	varying vec2 fpos;\n"
 		"#endif\n"
 		"void main(void) {\n"
+		"	vec2 pos = xform[0]*vertex.x + xform[1]*vertex.y + xform[2];\n"
 		"	ftcoord = tcoord;\n"
-		"	fpos = vertex;\n"
-		"	gl_Position = vec4(2.0*vertex.x/viewSize.x - 1.0, 1.0 - 2.0*vertex.y/viewSize.y, 0, 1);\n"
+		"	fpos = pos;\n"
+		"	gl_Position = vec4(2.0*pos.x/viewSize.x - 1.0, 1.0 - 2.0*pos.y/viewSize.y, 0, 1);\n"
 		"}\n";
 
 	static const char* fillFragShader =
@@ -601,6 +776,8 @@ static int glnvg__renderCreate(void* uptr)
 		"	#define texType int(frag[10].z)\n"
 		"	#define type int(frag[10].w)\n"
 		"#endif\n"
+		"	#define sdfEdge radius\n"		// distance field text, gradients are the only other users
+		"	#define sdfScale feather\n"
 		"\n"
 		"float sdroundrect(vec2 pt, vec2 ext, float rad) {\n"
 		"	vec2 ext2 = ext - vec2(rad,rad);\n"
@@ -665,6 +842,14 @@ static int glnvg__renderCreate(void* uptr)
 		"		if (texType == 2) color = vec4(color.x);"
 		"		color *= scissor;\n"
 		"		result = color * innerCol;\n"
+		"	} else if (type == 4) {		// Distance field text\n"
+		"#ifdef NANOVG_GL3\n"
+		"		float d = texture(tex, ftcoord).x;\n"
+		"#else\n"
+		"		float d = texture2D(tex, ftcoord).x;\n"
+		"#endif\n"
+		"		float a = clamp((d - sdfEdge) * sdfScale + 0.5, 0.0, 1.0);\n"
+		"		result = innerCol * (a * scissor);\n"
 		"	}\n"
 		"#ifdef NANOVG_GL3\n"
 		"	outColor = result;\n"
@@ -690,7 +875,9 @@ static int glnvg__renderCreate(void* uptr)
 #if defined NANOVG_GL3
 	glGenVertexArrays(1, &gl->vertArr);
 #endif
-	glGenBuffers(1, &gl->vertBuf);
+	glGenBuffers(NANOVG_GL_VERTBUF_RING, gl->vertBuf);
+	glGenBuffers(NANOVG_GL_VERTBUF_RING, gl->indexBuf);
+	glnvg__initFences(gl);
 
 #if NANOVG_GL_USE_UNIFORMBUFFER
 	// Create UBOs
@@ -977,7 +1164,19 @@ static void glnvg__setUniforms(GLNVGcontext* gl, int uniformOffset, int image)
 	glBindBufferRange(GL_UNIFORM_BUFFER, GLNVG_FRAG_BINDING, gl->fragBuf, uniformOffset, sizeof(GLNVGfragUniforms));
 #else
 	GLNVGfragUniforms* frag = nvg__fragUniformPtr(gl, uniformOffset);
+	#if NANOVG_GL_USE_STATE_FILTER
+	if (gl->boundFragValid && memcmp(&gl->boundFrag, frag, sizeof(GLNVGfragUniforms)) == 0) {
+		gl->draw.uniformsSkipped++;
+	} else {
+		glUniform4fv(gl->shader.loc[GLNVG_LOC_FRAG], NANOVG_GL_UNIFORMARRAY_SIZE, &(frag->uniformArray[0][0]));
+		memcpy(&gl->boundFrag, frag, sizeof(GLNVGfragUniforms));
+		gl->boundFragValid = 1;
+		gl->draw.uniformUploads++;
+	}
+	#else
 	glUniform4fv(gl->shader.loc[GLNVG_LOC_FRAG], NANOVG_GL_UNIFORMARRAY_SIZE, &(frag->uniformArray[0][0]));
+	gl->draw.uniformUploads++;
+	#endif
 #endif
 
 	if (image != 0) {
@@ -989,6 +1188,14 @@ static void glnvg__setUniforms(GLNVGcontext* gl, int uniformOffset, int image)
 	}
 }
 
+static void glnvg__setXform(GLNVGcontext* gl, const float* xform)
+{
+	if (memcmp(gl->xform, xform, sizeof(gl->xform)) != 0) {
+		memcpy(gl->xform, xform, sizeof(gl->xform));
+		glUniform2fv(gl->shader.loc[GLNVG_LOC_XFORM], 3, gl->xform);
+	}
+}
+
 static void glnvg__renderViewport(void* uptr, float width, float height, float devicePixelRatio)
 {
 	NVG_NOTUSED(devicePixelRatio);
@@ -997,7 +1204,20 @@ static void glnvg__renderViewport(void* uptr, float width, float height, float d
 	gl->view[1] = height;
 }
 
-static void glnvg__fill(GLNVGcontext* gl, GLNVGcall* call)
+static void glnvg__drawArrays(GLNVGcontext* gl, GLenum mode, int first, int count)
+{
+	glDrawArrays(mode, first, count);
+	gl->draw.draws++;
+}
+
+static void glnvg__drawIndexed(GLNVGcontext* gl, int offset, int count)
+{
+	if (count <= 0) return;
+	glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_SHORT, (const GLvoid*)(size_t)(offset * sizeof(GLushort)));
+	gl->draw.draws++;
+}
+
+static void glnvg__fill(GLNVGcontext* gl, GLNVGcall* call, const GLNVGbatch* batch)
 {
 	GLNVGpath* paths = &gl->paths[call->pathOffset];
 	int i, npaths = call->pathCount;
@@ -1015,8 +1235,11 @@ static void glnvg__fill(GLNVGcontext* gl, GLNVGcall* call)
 	glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_KEEP, GL_INCR_WRAP);
 	glStencilOpSeparate(GL_BACK, GL_KEEP, GL_KEEP, GL_DECR_WRAP);
 	glDisable(GL_CULL_FACE);
-	for (i = 0; i < npaths; i++)
-		glDrawArrays(GL_TRIANGLE_FAN, paths[i].fillOffset, paths[i].fillCount);
+	if (batch != NULL)
+		glnvg__drawIndexed(gl, batch->indexOffset, batch->indexCount);
+	else
+		for (i = 0; i < npaths; i++)
+			glnvg__drawArrays(gl, GL_TRIANGLE_FAN, paths[i].fillOffset, paths[i].fillCount);
 	glEnable(GL_CULL_FACE);
 
 	// Draw anti-aliased pixels
@@ -1029,19 +1252,22 @@ static void glnvg__fill(GLNVGcontext* gl, GLNVGcall* call)
 		glnvg__stencilFunc(gl, GL_EQUAL, 0x00, 0xff);
 		glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
 		// Draw fringes
-		for (i = 0; i < npaths; i++)
-			glDrawArrays(GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
+		if (batch != NULL)
+			glnvg__drawIndexed(gl, batch->fringeOffset, batch->fringeCount);
+		else
+			for (i = 0; i < npaths; i++)
+				glnvg__drawArrays(gl, GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
 	}
 
 	// Draw fill
 	glnvg__stencilFunc(gl, GL_NOTEQUAL, 0x0, 0xff);
 	glStencilOp(GL_ZERO, GL_ZERO, GL_ZERO);
-	glDrawArrays(GL_TRIANGLE_STRIP, call->triangleOffset, call->triangleCount);
+	glnvg__drawArrays(gl, GL_TRIANGLE_STRIP, call->triangleOffset, call->triangleCount);
 
 	glDisable(GL_STENCIL_TEST);
 }
 
-static void glnvg__convexFill(GLNVGcontext* gl, GLNVGcall* call)
+static void glnvg__convexFill(GLNVGcontext* gl, GLNVGcall* call, const GLNVGbatch* batch)
 {
 	GLNVGpath* paths = &gl->paths[call->pathOffset];
 	int i, npaths = call->pathCount;
@@ -1049,20 +1275,33 @@ static void glnvg__convexFill(GLNVGcontext* gl, GLNVGcall* call)
 	glnvg__setUniforms(gl, call->uniformOffset, call->image);
 	glnvg__checkError(gl, "convex fill");
 
+	if (batch != NULL) {
+		glnvg__drawIndexed(gl, batch->indexOffset, batch->indexCount);
+		return;
+	}
 	for (i = 0; i < npaths; i++) {
-		glDrawArrays(GL_TRIANGLE_FAN, paths[i].fillOffset, paths[i].fillCount);
+		glnvg__drawArrays(gl, GL_TRIANGLE_FAN, paths[i].fillOffset, paths[i].fillCount);
 		// Draw fringes
 		if (paths[i].strokeCount > 0) {
-			glDrawArrays(GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
+			glnvg__drawArrays(gl, GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
 		}
 	}
 }
 
-static void glnvg__stroke(GLNVGcontext* gl, GLNVGcall* call)
+static void glnvg__drawStrokes(GLNVGcontext* gl, GLNVGcall* call, const GLNVGbatch* batch)
 {
 	GLNVGpath* paths = &gl->paths[call->pathOffset];
-	int npaths = call->pathCount, i;
+	int i;
 
+	if (batch != NULL)
+		glnvg__drawIndexed(gl, batch->indexOffset, batch->indexCount);
+	else
+		for (i = 0; i < call->pathCount; i++)
+			glnvg__drawArrays(gl, GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
+}
+
+static void glnvg__stroke(GLNVGcontext* gl, GLNVGcall* call, const GLNVGbatch* batch)
+{
 	if (gl->flags & NVG_STENCIL_STROKES) {
 
 		glEnable(GL_STENCIL_TEST);
@@ -1073,23 +1312,20 @@ static void glnvg__stroke(GLNVGcontext* gl, GLNVGcall* call)
 		glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
 		glnvg__setUniforms(gl, call->uniformOffset + gl->fragSize, call->image);
 		glnvg__checkError(gl, "stroke fill 0");
-		for (i = 0; i < npaths; i++)
-			glDrawArrays(GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
+		glnvg__drawStrokes(gl, call, batch);
 
 		// Draw anti-aliased pixels.
 		glnvg__setUniforms(gl, call->uniformOffset, call->image);
 		glnvg__stencilFunc(gl, GL_EQUAL, 0x00, 0xff);
 		glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
-		for (i = 0; i < npaths; i++)
-			glDrawArrays(GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
+		glnvg__drawStrokes(gl, call, batch);
 
 		// Clear stencil buffer.
 		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
 		glnvg__stencilFunc(gl, GL_ALWAYS, 0x0, 0xff);
 		glStencilOp(GL_ZERO, GL_ZERO, GL_ZERO);
 		glnvg__checkError(gl, "stroke fill 1");
-		for (i = 0; i < npaths; i++)
-			glDrawArrays(GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
+		glnvg__drawStrokes(gl, call, batch);
 		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 
 		glDisable(GL_STENCIL_TEST);
@@ -1100,17 +1336,19 @@ static void glnvg__stroke(GLNVGcontext* gl, GLNVGcall* call)
 		glnvg__setUniforms(gl, call->uniformOffset, call->image);
 		glnvg__checkError(gl, "stroke fill");
 		// Draw Strokes
-		for (i = 0; i < npaths; i++)
-			glDrawArrays(GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
+		glnvg__drawStrokes(gl, call, batch);
 	}
 }
 
-static void glnvg__triangles(GLNVGcontext* gl, GLNVGcall* call)
+static void glnvg__triangles(GLNVGcontext* gl, GLNVGcall* call, const GLNVGbatch* batch)
 {
 	glnvg__setUniforms(gl, call->uniformOffset, call->image);
 	glnvg__checkError(gl, "triangles fill");
 
-	glDrawArrays(GL_TRIANGLES, call->triangleOffset, call->triangleCount);
+	if (batch != NULL)
+		glnvg__drawIndexed(gl, batch->indexOffset, batch->indexCount);
+	else
+		glnvg__drawArrays(gl, GL_TRIANGLES, call->triangleOffset, call->triangleCount);
 }
 
 static void glnvg__renderCancel(void* uptr) {
@@ -1119,6 +1357,8 @@ static void glnvg__renderCancel(void* uptr) {
 	gl->npaths = 0;
 	gl->ncalls = 0;
 	gl->nuniforms = 0;
+	gl->nbatches = 0;
+	gl->nindices = 0;
 }
 
 static GLenum glnvg_convertBlendFuncFactor(int factor)
@@ -1165,13 +1405,250 @@ static GLNVGblend glnvg__blendCompositeOperation(NVGcompositeOperationState op)
 	return blend;
 }
 
+static unsigned long long glnvg__nsec(void)
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+#else
+	return 0;
+#endif
+}
+
+// Copies data into a buffer of the ring and leaves it bound. glBufferData allocates without data
+// only when the flush outgrows the buffer, every other frame is a glBufferSubData into storage the
+// GPU is done with, no fresh allocation and no implicit sync.
+static void glnvg__streamBuffer(GLNVGcontext* gl, GLenum target, GLuint buf, int* size, int bytes, int minBytes, const void* data)
+{
+	glBindBuffer(target, buf);
+	if (bytes > *size) {
+		*size = glnvg__maxi(bytes + bytes/2, minBytes);
+		glBufferData(target, *size, NULL, GL_STREAM_DRAW);
+		gl->stream.reallocs++;
+	}
+	glBufferSubData(target, 0, bytes, data);
+}
+
+// Uploads the frame's vertices, and the batch indices if there are any, to the next buffers of
+// the ring.
+static void glnvg__uploadVerts(GLNVGcontext* gl)
+{
+	int i, bytes = gl->nverts * (int)sizeof(NVGvertex);
+	unsigned long long start, elapsed;
+
+	i = gl->vertBufIndex = (gl->vertBufIndex + 1) % NANOVG_GL_VERTBUF_RING;
+	glnvg__checkFence(gl, i);
+	start = glnvg__nsec();
+	glnvg__streamBuffer(gl, GL_ARRAY_BUFFER, gl->vertBuf[i], &gl->vertBufSize[i],
+						bytes, 4096 * (int)sizeof(NVGvertex), gl->verts);
+	if (gl->nindices > 0) {
+		int indexBytes = gl->nindices * (int)sizeof(GLushort);
+		glnvg__streamBuffer(gl, GL_ELEMENT_ARRAY_BUFFER, gl->indexBuf[i], &gl->indexBufSize[i],
+							indexBytes, 8192 * (int)sizeof(GLushort), gl->indices);
+		bytes += indexBytes;
+	}
+	elapsed = glnvg__nsec() - start;
+
+	gl->stream.flushes++;
+	gl->stream.bytes += bytes;
+	gl->stream.lastBytes = bytes;
+	gl->stream.maxBytes = glnvg__maxi(gl->stream.maxBytes, bytes);
+	gl->stream.uploadNsec += elapsed;
+	if (elapsed > gl->stream.maxUploadNsec) gl->stream.maxUploadNsec = elapsed;
+	if (elapsed > NANOVG_GL_SLOW_UPLOAD_NSEC) gl->stream.slowUploads++;
+}
+
+static int glnvg__allocIndices(GLNVGcontext* gl, int n)
+{
+	int ret = 0;
+	if (gl->nindices+n > gl->cindices) {
+		GLushort* indices;
+		int cindices = glnvg__maxi(gl->nindices + n, 8192) + gl->cindices/2; // 1.5x Overallocate
+		indices = (GLushort*)realloc(gl->indices, sizeof(GLushort) * cindices);
+		if (indices == NULL) return -1;
+		gl->indices = indices;
+		gl->cindices = cindices;
+	}
+	ret = gl->nindices;
+	gl->nindices += n;
+	return ret;
+}
+
+// Triangle list indices for a fan, and for a strip with every other triangle flipped back to the
+// winding the strip gives it, so face culling sees the same triangles.
+static int glnvg__fanIndices(GLNVGcontext* gl, int first, int count)
+{
+	int i, offset;
+	GLushort* idx;
+	if (count < 3) return 1;
+	offset = glnvg__allocIndices(gl, (count - 2) * 3);
+	if (offset == -1) return 0;
+	idx = &gl->indices[offset];
+	for (i = 1; i < count - 1; i++) {
+		*idx++ = (GLushort)first;
+		*idx++ = (GLushort)(first + i);
+		*idx++ = (GLushort)(first + i + 1);
+	}
+	return 1;
+}
+
+static int glnvg__stripIndices(GLNVGcontext* gl, int first, int count)
+{
+	int i, offset;
+	GLushort* idx;
+	if (count < 3) return 1;
+	offset = glnvg__allocIndices(gl, (count - 2) * 3);
+	if (offset == -1) return 0;
+	idx = &gl->indices[offset];
+	for (i = 0; i < count - 2; i++) {
+		*idx++ = (GLushort)(first + i + (i & 1));
+		*idx++ = (GLushort)(first + i + 1 - (i & 1));
+		*idx++ = (GLushort)(first + i + 2);
+	}
+	return 1;
+}
+
+// Appends the call's triangles, in the order the unbatched draws would have drawn them. For a
+// fill, fringes selects the antialiasing strips instead of the stencil fans.
+static int glnvg__callIndices(GLNVGcontext* gl, GLNVGcall* call, int fringes)
+{
+	GLNVGpath* paths = &gl->paths[call->pathOffset];
+	int i, offset;
+
+	switch (call->type) {
+	case GLNVG_FILL:
+		for (i = 0; i < call->pathCount; i++) {
+			if (!(fringes ? glnvg__stripIndices(gl, paths[i].strokeOffset, paths[i].strokeCount)
+						  : glnvg__fanIndices(gl, paths[i].fillOffset, paths[i].fillCount)))
+				return 0;
+		}
+		break;
+	case GLNVG_CONVEXFILL:
+		for (i = 0; i < call->pathCount; i++) {
+			if (!glnvg__fanIndices(gl, paths[i].fillOffset, paths[i].fillCount) ||
+				!glnvg__stripIndices(gl, paths[i].strokeOffset, paths[i].strokeCount))
+				return 0;
+		}
+		break;
+	case GLNVG_STROKE:
+		for (i = 0; i < call->pathCount; i++) {
+			if (!glnvg__stripIndices(gl, paths[i].strokeOffset, paths[i].strokeCount))
+				return 0;
+		}
+		break;
+	case GLNVG_TRIANGLES:
+		offset = glnvg__allocIndices(gl, call->triangleCount);
+		if (offset == -1) return 0;
+		for (i = 0; i < call->triangleCount; i++)
+			gl->indices[offset + i] = (GLushort)(call->triangleOffset + i);
+		break;
+	}
+	return 1;
+}
+
+// Calls that can share a draw with others: a fill needs its own stencil clear and a stencil stroke
+// must not let another stroke's pixels into its overlap test.
+static int glnvg__canBatch(GLNVGcontext* gl, const GLNVGcall* call)
+{
+	if (call->type == GLNVG_CONVEXFILL || call->type == GLNVG_TRIANGLES) return 1;
+	if (call->type == GLNVG_STROKE) return (gl->flags & NVG_STENCIL_STROKES) == 0;
+	return 0;
+}
+
+static int glnvg__sameState(GLNVGcontext* gl, const GLNVGcall* a, const GLNVGcall* b)
+{
+	return a->type == b->type && a->image == b->image &&
+		memcmp(&a->blendFunc, &b->blendFunc, sizeof(a->blendFunc)) == 0 &&
+		memcmp(a->xform, b->xform, sizeof(a->xform)) == 0 &&
+		memcmp(nvg__fragUniformPtr(gl, a->uniformOffset), nvg__fragUniformPtr(gl, b->uniformOffset), sizeof(GLNVGfragUniforms)) == 0;
+}
+
+static int glnvg__overlap(const GLNVGcall* a, const GLNVGcall* b)
+{
+	// a pixel of margin for the antialiasing fringe and rounding
+	return a->bounds[0] - 1.0f < b->bounds[2] && b->bounds[0] - 1.0f < a->bounds[2] &&
+		   a->bounds[1] - 1.0f < b->bounds[3] && b->bounds[1] - 1.0f < a->bounds[3];
+}
+
+// Groups the calls into batches and builds their indices. A later call with the same state joins
+// a batch when nothing still to be drawn between them overlaps it, so moving it forward can't
+// change the blending order of any pixel. Returns 0 when the calls are to be drawn one by one.
+static int glnvg__buildBatches(GLNVGcontext* gl)
+{
+	int i, j, k, end;
+
+	gl->nbatches = 0;
+	gl->nindices = 0;
+	if (gl->nverts > 65536) return 0;	// GL_UNSIGNED_SHORT indices, the only kind GLES2 guarantees
+
+	if (gl->ncalls > gl->cbatches) {
+		GLNVGbatch* batches;
+		int cbatches = glnvg__maxi(gl->ncalls, 128) + gl->cbatches/2; // 1.5x Overallocate
+		batches = (GLNVGbatch*)realloc(gl->batches, sizeof(GLNVGbatch) * cbatches);
+		if (batches == NULL) return 0;
+		gl->batches = batches;
+		gl->cbatches = cbatches;
+	}
+	for (i = 0; i < gl->ncalls; i++)
+		gl->calls[i].batched = 0;
+
+	for (i = 0; i < gl->ncalls; i++) {
+		GLNVGcall* call = &gl->calls[i];
+		GLNVGbatch* batch;
+		if (call->batched) continue;
+
+		batch = &gl->batches[gl->nbatches++];
+		memset(batch, 0, sizeof(GLNVGbatch));
+		batch->call = i;
+		batch->indexOffset = gl->nindices;
+		if (!glnvg__callIndices(gl, call, 0)) goto error;
+
+		if (call->type == GLNVG_FILL) {
+			batch->indexCount = gl->nindices - batch->indexOffset;
+			batch->fringeOffset = gl->nindices;
+			if (!glnvg__callIndices(gl, call, 1)) goto error;
+			batch->fringeCount = gl->nindices - batch->fringeOffset;
+			continue;
+		}
+		if (glnvg__canBatch(gl, call)) {
+			end = glnvg__mini(gl->ncalls, i + 1 + NANOVG_GL_BATCH_WINDOW);
+			for (j = i + 1; j < end; j++) {
+				GLNVGcall* next = &gl->calls[j];
+				if (next->batched || !glnvg__sameState(gl, call, next)) continue;
+				for (k = i + 1; k < j; k++) {
+					if (!gl->calls[k].batched && glnvg__overlap(&gl->calls[k], next)) break;
+				}
+				if (k < j) continue;
+				if (!glnvg__callIndices(gl, next, 0)) goto error;
+				next->batched = 1;
+			}
+		}
+		batch->indexCount = gl->nindices - batch->indexOffset;
+	}
+	return 1;
+
+error:
+	gl->nbatches = 0;
+	gl->nindices = 0;
+	return 0;
+}
+
 static void glnvg__renderFlush(void* uptr)
 {
 	GLNVGcontext* gl = (GLNVGcontext*)uptr;
-	int i;
+	int i, batched = 0;
 
 	if (gl->ncalls > 0) {
 
+		if (gl->flags & NVG_BATCH_CALLS) {
+			batched = glnvg__buildBatches(gl);
+			if (!batched) gl->draw.unbatchedFlushes++;
+		}
+		gl->draw.flushes++;
+		gl->draw.calls += gl->ncalls;
+		gl->draw.batches += batched ? gl->nbatches : gl->ncalls;
+
 		// Setup require GL state.
 		glUseProgram(gl->shader.prog);
 
@@ -1197,6 +1674,7 @@ static void glnvg__renderFlush(void* uptr)
 		gl->blendFunc.srcAlpha = GL_INVALID_ENUM;
 		gl->blendFunc.dstRGB = GL_INVALID_ENUM;
 		gl->blendFunc.dstAlpha = GL_INVALID_ENUM;
+		gl->boundFragValid = 0;
 		#endif
 
 #if NANOVG_GL_USE_UNIFORMBUFFER
@@ -1209,8 +1687,7 @@ static void glnvg__renderFlush(void* uptr)
 #if defined NANOVG_GL3
 		glBindVertexArray(gl->vertArr);
 #endif
-		glBindBuffer(GL_ARRAY_BUFFER, gl->vertBuf);
-		glBufferData(GL_ARRAY_BUFFER, gl->nverts * sizeof(NVGvertex), gl->verts, GL_STREAM_DRAW);
+		glnvg__uploadVerts(gl);
 		glEnableVertexAttribArray(0);
 		glEnableVertexAttribArray(1);
 		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(NVGvertex), (const GLvoid*)(size_t)0);
@@ -1219,22 +1696,26 @@ static void glnvg__renderFlush(void* uptr)
 		// Set view and texture just once per frame.
 		glUniform1i(gl->shader.loc[GLNVG_LOC_TEX], 0);
 		glUniform2fv(gl->shader.loc[GLNVG_LOC_VIEWSIZE], 1, gl->view);
+		nvgTransformIdentity(gl->xform);
+		glUniform2fv(gl->shader.loc[GLNVG_LOC_XFORM], 3, gl->xform);
 
 #if NANOVG_GL_USE_UNIFORMBUFFER
 		glBindBuffer(GL_UNIFORM_BUFFER, gl->fragBuf);
 #endif
 
-		for (i = 0; i < gl->ncalls; i++) {
-			GLNVGcall* call = &gl->calls[i];
+		for (i = 0; i < (batched ? gl->nbatches : gl->ncalls); i++) {
+			const GLNVGbatch* batch = batched ? &gl->batches[i] : NULL;
+			GLNVGcall* call = &gl->calls[batched ? batch->call : i];
 			glnvg__blendFuncSeparate(gl,&call->blendFunc);
+			glnvg__setXform(gl, call->xform);
 			if (call->type == GLNVG_FILL)
-				glnvg__fill(gl, call);
+				glnvg__fill(gl, call, batch);
 			else if (call->type == GLNVG_CONVEXFILL)
-				glnvg__convexFill(gl, call);
+				glnvg__convexFill(gl, call, batch);
 			else if (call->type == GLNVG_STROKE)
-				glnvg__stroke(gl, call);
+				glnvg__stroke(gl, call, batch);
 			else if (call->type == GLNVG_TRIANGLES)
-				glnvg__triangles(gl, call);
+				glnvg__triangles(gl, call, batch);
 		}
 
 		glDisableVertexAttribArray(0);
@@ -1244,8 +1725,11 @@ static void glnvg__renderFlush(void* uptr)
 #endif
 		glDisable(GL_CULL_FACE);
 			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 		glUseProgram(0);
 		glnvg__bindTexture(gl, 0);
+
+		glnvg__fenceSlot(gl, gl->vertBufIndex);
 	}
 
 	// Reset calls
@@ -1253,6 +1737,8 @@ static void glnvg__renderFlush(void* uptr)
 	gl->npaths = 0;
 	gl->ncalls = 0;
 	gl->nuniforms = 0;
+	gl->nbatches = 0;
+	gl->nindices = 0;
 }
 
 static int glnvg__maxVertCount(const NVGpath* paths, int npaths)
@@ -1278,6 +1764,7 @@ static GLNVGcall* glnvg__allocCall(GLNVGcontext* gl)
 	}
 	ret = &gl->calls[gl->ncalls++];
 	memset(ret, 0, sizeof(GLNVGcall));
+	nvgTransformIdentity(ret->xform);
 	return ret;
 }
 
@@ -1342,8 +1829,38 @@ static void glnvg__vset(NVGvertex* vtx, float x, float y, float u, float v)
 	vtx->v = v;
 }
 
+// Screen space bounds of the vertices a call added, for the batching pass to tell whether moving
+// a call ahead of others changes what ends up on screen.
+static void glnvg__callBounds(GLNVGcontext* gl, GLNVGcall* call, int first, int count)
+{
+	float minx = 1e6f, miny = 1e6f, maxx = -1e6f, maxy = -1e6f;
+	float cx[4], cy[4];
+	int i;
+
+	for (i = first; i < first + count; i++) {
+		minx = glnvg__minf(minx, gl->verts[i].x);
+		miny = glnvg__minf(miny, gl->verts[i].y);
+		maxx = glnvg__maxf(maxx, gl->verts[i].x);
+		maxy = glnvg__maxf(maxy, gl->verts[i].y);
+	}
+	cx[0] = minx; cy[0] = miny;
+	cx[1] = maxx; cy[1] = miny;
+	cx[2] = maxx; cy[2] = maxy;
+	cx[3] = minx; cy[3] = maxy;
+	call->bounds[0] = call->bounds[1] = 1e6f;
+	call->bounds[2] = call->bounds[3] = -1e6f;
+	for (i = 0; i < 4; i++) {
+		float x = cx[i]*call->xform[0] + cy[i]*call->xform[2] + call->xform[4];
+		float y = cx[i]*call->xform[1] + cy[i]*call->xform[3] + call->xform[5];
+		call->bounds[0] = glnvg__minf(call->bounds[0], x);
+		call->bounds[1] = glnvg__minf(call->bounds[1], y);
+		call->bounds[2] = glnvg__maxf(call->bounds[2], x);
+		call->bounds[3] = glnvg__maxf(call->bounds[3], y);
+	}
+}
+
 static void glnvg__renderFill(void* uptr, NVGpaint* paint, NVGcompositeOperationState compositeOperation, NVGscissor* scissor, float fringe,
-							  const float* bounds, const NVGpath* paths, int npaths)
+							  const float* bounds, const NVGpath* paths, int npaths, const float* xform)
 {
 	GLNVGcontext* gl = (GLNVGcontext*)uptr;
 	GLNVGcall* call = glnvg__allocCall(gl);
@@ -1355,6 +1872,7 @@ static void glnvg__renderFill(void* uptr, NVGpaint* paint, NVGcompositeOperation
 
 	call->type = GLNVG_FILL;
 	call->triangleCount = 4;
+	if (xform != NULL) memcpy(call->xform, xform, sizeof(call->xform));
 	call->pathOffset = glnvg__allocPaths(gl, npaths);
 	if (call->pathOffset == -1) goto error;
 	call->pathCount = npaths;
@@ -1415,6 +1933,7 @@ static void glnvg__renderFill(void* uptr, NVGpaint* paint, NVGcompositeOperation
 		// Fill shader
 		glnvg__convertPaint(gl, nvg__fragUniformPtr(gl, call->uniformOffset), paint, scissor, fringe, fringe, -1.0f);
 	}
+	if (gl->flags & NVG_BATCH_CALLS) glnvg__callBounds(gl, call, gl->nverts - maxverts, maxverts);
 
 	return;
 
@@ -1425,7 +1944,7 @@ error:
 }
 
 static void glnvg__renderStroke(void* uptr, NVGpaint* paint, NVGcompositeOperationState compositeOperation, NVGscissor* scissor, float fringe,
-								float strokeWidth, const NVGpath* paths, int npaths)
+								float strokeWidth, const NVGpath* paths, int npaths, const float* xform)
 {
 	GLNVGcontext* gl = (GLNVGcontext*)uptr;
 	GLNVGcall* call = glnvg__allocCall(gl);
@@ -1434,6 +1953,7 @@ static void glnvg__renderStroke(void* uptr, NVGpaint* paint, NVGcompositeOperati
 	if (call == NULL) return;
 
 	call->type = GLNVG_STROKE;
+	if (xform != NULL) memcpy(call->xform, xform, sizeof(call->xform));
 	call->pathOffset = glnvg__allocPaths(gl, npaths);
 	if (call->pathOffset == -1) goto error;
 	call->pathCount = npaths;
@@ -1471,6 +1991,7 @@ static void glnvg__renderStroke(void* uptr, NVGpaint* paint, NVGcompositeOperati
 		if (call->uniformOffset == -1) goto error;
 		glnvg__convertPaint(gl, nvg__fragUniformPtr(gl, call->uniformOffset), paint, scissor, strokeWidth, fringe, -1.0f);
 	}
+	if (gl->flags & NVG_BATCH_CALLS) glnvg__callBounds(gl, call, gl->nverts - maxverts, maxverts);
 
 	return;
 
@@ -1481,7 +2002,7 @@ error:
 }
 
 static void glnvg__renderTriangles(void* uptr, NVGpaint* paint, NVGcompositeOperationState compositeOperation, NVGscissor* scissor,
-								   const NVGvertex* verts, int nverts)
+								   const NVGvertex* verts, int nverts, float sdf)
 {
 	GLNVGcontext* gl = (GLNVGcontext*)uptr;
 	GLNVGcall* call = glnvg__allocCall(gl);
@@ -1506,6 +2027,12 @@ static void glnvg__renderTriangles(void* uptr, NVGpaint* paint, NVGcompositeOper
 	frag = nvg__fragUniformPtr(gl, call->uniformOffset);
 	glnvg__convertPaint(gl, frag, paint, scissor, 1.0f, 1.0f, -1.0f);
 	frag->type = NSVG_SHADER_IMG;
+	if (sdf > 0.0f) {
+		frag->type = NSVG_SHADER_SDF;
+		frag->radius = 0.5f;	// sdfEdge
+		frag->feather = sdf;	// sdfScale
+	}
+	if (gl->flags & NVG_BATCH_CALLS) glnvg__callBounds(gl, call, call->triangleOffset, nverts);
 
 	return;
 
@@ -1531,8 +2058,11 @@ static void glnvg__renderDelete(void* uptr)
 	if (gl->vertArr != 0)
 		glDeleteVertexArrays(1, &gl->vertArr);
 #endif
-	if (gl->vertBuf != 0)
-		glDeleteBuffers(1, &gl->vertBuf);
+	if (gl->vertBuf[0] != 0)
+		glDeleteBuffers(NANOVG_GL_VERTBUF_RING, gl->vertBuf);
+	if (gl->indexBuf[0] != 0)
+		glDeleteBuffers(NANOVG_GL_VERTBUF_RING, gl->indexBuf);
+	glnvg__deleteFences(gl);
 
 	for (i = 0; i < gl->ntextures; i++) {
 		if (gl->textures[i].tex != 0 && (gl->textures[i].flags & NVG_IMAGE_NODELETE) == 0)
@@ -1544,6 +2074,8 @@ static void glnvg__renderDelete(void* uptr)
 	free(gl->verts);
 	free(gl->uniforms);
 	free(gl->calls);
+	free(gl->batches);
+	free(gl->indices);
 
 	free(gl);
 }
@@ -1580,6 +2112,7 @@ NVGcontext* nvgCreateGLES3(int flags)
 	params.renderDelete = glnvg__renderDelete;
 	params.userPtr = gl;
 	params.edgeAntiAlias = flags & NVG_ANTIALIAS ? 1 : 0;
+	params.sdfText = flags & NVG_SDF_TEXT ? 1 : 0;
 
 	gl->flags = flags;
 
@@ -1646,4 +2179,32 @@ GLuint nvglImageHandleGLES3(NVGcontext* ctx, int image)
 	return tex->tex;
 }
 
+#if defined NANOVG_GL2
+void nvglStreamStatsGL2(NVGcontext* ctx, NVGLstreamStats* stats)
+#elif defined NANOVG_GL3
+void nvglStreamStatsGL3(NVGcontext* ctx, NVGLstreamStats* stats)
+#elif defined NANOVG_GLES2
+void nvglStreamStatsGLES2(NVGcontext* ctx, NVGLstreamStats* stats)
+#elif defined NANOVG_GLES3
+void nvglStreamStatsGLES3(NVGcontext* ctx, NVGLstreamStats* stats)
+#endif
+{
+	GLNVGcontext* gl = (GLNVGcontext*)nvgInternalParams(ctx)->userPtr;
+	*stats = gl->stream;
+}
+
+#if defined NANOVG_GL2
+void nvglDrawStatsGL2(NVGcontext* ctx, NVGLdrawStats* stats)
+#elif defined NANOVG_GL3
+void nvglDrawStatsGL3(NVGcontext* ctx, NVGLdrawStats* stats)
+#elif defined NANOVG_GLES2
+void nvglDrawStatsGLES2(NVGcontext* ctx, NVGLdrawStats* stats)
+#elif defined NANOVG_GLES3
+void nvglDrawStatsGLES3(NVGcontext* ctx, NVGLdrawStats* stats)
+#endif
+{
+	GLNVGcontext* gl = (GLNVGcontext*)nvgInternalParams(ctx)->userPtr;
+	*stats = gl->draw;
+}
+
 #endif /* NANOVG_GL_IMPLEMENTATION */
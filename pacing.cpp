@@ -0,0 +1,129 @@
+#include "pacing.h"
+#include "utility/clock.h"
+
+
+bool initFramePacer(
+	FramePacer& fp,
+	PacingMode mode,
+	u32 swapInterval,
+	r32 fixedHz,
+	r32 sampleDelay_ms)
+{
+	fp = FramePacer{};
+	fp.mode = mode;
+	fp.swapInterval = (mode == Pacing_VSync ? max(swapInterval, (u32)1) : 0);
+	fp.period_nsec = (fixedHz > 0 ? (u64)(1000000000.0 / fixedHz) : 0);
+	fp.sampleDelay_nsec = (sampleDelay_ms > 0 ? (u64)(sampleDelay_ms * 1000000.0f) : 0);
+	// the refresh rate is not queried, assume the usual 60Hz panel
+	fp.idlePoll_nsec = (u64)max(fp.swapInterval, (u32)1) * (1000000000ULL / 60);
+
+	if (mode == Pacing_Fixed && fp.period_nsec == 0) {
+		fprintf(stderr, "Fixed frame pacing needs a rate above 0\n");
+		return false;
+	}
+
+	// the config allows 0 (EGL_MIN_SWAP_INTERVAL), values above the driver max are clamped by EGL
+	if (eglSwapInterval(state.display, (EGLint)fp.swapInterval) == EGL_FALSE) {
+		fprintf(stderr, "eglSwapInterval(%u) failed\n", fp.swapInterval);
+	}
+
+	fp.start_nsec = monotonicNsec();
+	return true;
+}
+
+
+void pacingSleepUntil(
+	FramePacer& fp,
+	u64 deadline_nsec)
+{
+	u64 now_nsec = monotonicNsec();
+	if (deadline_nsec > now_nsec) {
+		sleepUntilNsec(deadline_nsec);
+		fp.sleep_nsec += monotonicNsec() - now_nsec;
+	}
+}
+
+
+void pacingWait(
+	FramePacer& fp)
+{
+	switch (fp.mode) {
+		case Pacing_VSync:
+			if (fp.idleUntil_nsec != 0) {
+				pacingSleepUntil(fp, fp.idleUntil_nsec);
+				fp.idleUntil_nsec = 0;
+				break;
+			}
+			// the swap already blocked until the display took the previous frame, optionally slide
+			// input sampling toward the next vblank
+			if (fp.sampleDelay_nsec > 0 && fp.lastPresent_nsec != 0) {
+				pacingSleepUntil(fp, fp.lastPresent_nsec + fp.sampleDelay_nsec);
+			}
+			break;
+
+		case Pacing_Fixed: {
+			u64 now_nsec = monotonicNsec();
+			if (fp.nextFrame_nsec == 0) {
+				fp.nextFrame_nsec = now_nsec;
+			}
+			else if (now_nsec > fp.nextFrame_nsec + fp.period_nsec) {
+				// more than a frame behind, drop the missed slots instead of rushing to catch up
+				++fp.late;
+				fp.nextFrame_nsec = now_nsec;
+			}
+			else {
+				pacingSleepUntil(fp, fp.nextFrame_nsec);
+			}
+			fp.nextFrame_nsec += fp.period_nsec;
+			break;
+		}
+
+		case Pacing_Uncapped:
+			if (fp.idleUntil_nsec != 0) {
+				pacingSleepUntil(fp, fp.idleUntil_nsec);
+				fp.idleUntil_nsec = 0;
+			}
+			break;
+	}
+}
+
+
+void pacingOnPresent(
+	FramePacer& fp,
+	u64 now_nsec)
+{
+	fp.lastPresent_nsec = now_nsec;
+	++fp.frames;
+}
+
+
+void pacingOnSkip(
+	FramePacer& fp)
+{
+	++fp.skipped;
+	if (fp.mode != Pacing_Fixed) {
+		fp.idleUntil_nsec = monotonicNsec() + fp.idlePoll_nsec;
+	}
+}
+
+
+void printPacingSummary(
+	const FramePacer& fp)
+{
+	static const char* modeNames[] = { "vsync", "fixed", "uncapped" };
+
+	u64 elapsed_nsec = monotonicNsec() - fp.start_nsec;
+	if (fp.frames + fp.skipped == 0 || elapsed_nsec == 0) {
+		return;
+	}
+
+	printf("Pacing: %s, swap interval %u, %llu frames at %.2f fps, %llu skipped unchanged (%.1f%%), "
+		   "%.1f%% of the loop asleep, %llu late frames\n",
+		   modeNames[fp.mode], fp.swapInterval,
+		   (unsigned long long)fp.frames,
+		   (r64)fp.frames / ((r64)elapsed_nsec * 1e-9),
+		   (unsigned long long)fp.skipped,
+		   100.0 * (r64)fp.skipped / (r64)(fp.frames + fp.skipped),
+		   100.0 * (r64)fp.sleep_nsec / (r64)elapsed_nsec,
+		   (unsigned long long)fp.late);
+}
@@ -0,0 +1,67 @@
+#ifndef _PACING_H
+#define _PACING_H
+
+#include "utility/types.h"
+
+enum PacingMode : u8
+{
+	Pacing_VSync = 0,	// eglSwapBuffers blocks on the display refresh, swapInterval vblanks per frame
+	Pacing_Fixed,		// sleep to a fixed frame rate, swaps do not wait for vblank
+	Pacing_Uncapped		// no waiting at all, for benchmarks
+};
+
+/**
+ * Frame pacing for the render loop. pacingWait is called at the top of each frame, before input
+ * is sampled, and is the only place the loop sleeps, so input is always read as late as possible
+ * and immediately rendered. The GPU is never waited on explicitly; eglSwapBuffers throttles the
+ * CPU to at most one queued frame in vsync mode, letting CPU work on frame n+1 overlap GPU work
+ * on frame n.
+ */
+struct FramePacer {
+	PacingMode	mode;
+	u32			swapInterval;
+	u64			period_nsec;		// fixed mode frame period
+	u64			sampleDelay_nsec;	// vsync mode, sleep after the swap returns before sampling
+	u64			nextFrame_nsec;		// fixed mode deadline for the next frame start
+	u64			idlePoll_nsec;		// vsync and uncapped modes, input poll period while skipping
+	u64			idleUntil_nsec;		// set when the last frame was skipped, 0 otherwise
+	u64			lastPresent_nsec;
+
+	u64			frames;
+	u64			late;				// fixed mode frames that started after their deadline
+	u64			skipped;			// frames not drawn because nothing on screen changed
+	u64			sleep_nsec;			// total time spent sleeping in pacingWait
+	u64			start_nsec;
+};
+
+bool initFramePacer(
+	FramePacer& fp,
+	PacingMode mode,
+	u32 swapInterval,
+	r32 fixedHz,
+	r32 sampleDelay_ms);
+
+/**
+ * Sleep until the next frame should start sampling input.
+ */
+void pacingWait(
+	FramePacer& fp);
+
+/**
+ * Call when the swap for the frame returns.
+ */
+void pacingOnPresent(
+	FramePacer& fp,
+	u64 now_nsec);
+
+/**
+ * Call instead of pacingOnPresent when the frame was not drawn. There is no swap to block on, so
+ * the next pacingWait sleeps for a nominal refresh period instead of spinning.
+ */
+void pacingOnSkip(
+	FramePacer& fp);
+
+void printPacingSummary(
+	const FramePacer& fp);
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef _PLATFORM_H
+#define _PLATFORM_H
+
+/**
+ * Display platform layer, implemented by platform_rpi.cpp (dispmanx window on the Pi LCD) or by
+ * platform_headless.cpp (EGL pbuffer on any Linux box with a GLES2 driver, including Mesa's
+ * software rasterizer) when built with ADI_HEADLESS.
+ *
+ * initDisplay creates the EGL display, surface and GLES2 context, makes them current and sets
+ * state.screenWidth/screenHeight. presentFrame finishes the frame started by drawScene and must
+ * throttle the CPU to at most one frame ahead of the GPU; drawScene does not call glFinish.
+ */
+bool initDisplay();
+
+void presentFrame();
+
+void cleanupDisplay();
+
+#endif
@@ -0,0 +1,248 @@
+#include <algorithm>
+#include "platform.h"
+#include "utility/clock.h"
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA	0x31DD
+#endif
+
+#define HEADLESS_MAX_FRAME_SAMPLES		65536	// most recent frame times kept for the summary
+
+
+struct HeadlessState
+{
+	u64		prevPresent_nsec;
+	u32		numPresented;
+	u32		numTimed;		// frame time samples taken, one less than numPresented
+	u32		numDumps;
+	r32		frameTimes_ms[HEADLESS_MAX_FRAME_SAMPLES];
+
+	// pbuffer swaps never block, a fence on the previous frame stands in for swap chain throttling
+	EGLSyncKHR						prevFrameFence;
+	PFNEGLCREATESYNCKHRPROC			createSync;
+	PFNEGLCLIENTWAITSYNCKHRPROC		clientWaitSync;
+	PFNEGLDESTROYSYNCKHRPROC		destroySync;
+};
+
+HeadlessState headless;
+
+
+/**
+ * Prefer a surfaceless Mesa display so no X11 or Wayland server is needed, fall back to the
+ * default display for other EGL implementations.
+ */
+EGLDisplay getHeadlessDisplay()
+{
+	typedef EGLDisplay (EGLAPIENTRYP GetPlatformDisplayEXT)(EGLenum, void*, const EGLint*);
+
+	const char* clientExts = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	GetPlatformDisplayEXT getPlatformDisplay =
+		(GetPlatformDisplayEXT)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+	if (clientExts && strstr(clientExts, "EGL_MESA_platform_surfaceless") && getPlatformDisplay) {
+		EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		if (display != EGL_NO_DISPLAY) {
+			return display;
+		}
+	}
+
+	return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+
+bool initDisplay()
+{
+	// the same framebuffer as platform_rpi.cpp, so frame dumps and timings stand for the Pi
+	static const EGLint attributeList[] =
+	{
+		EGL_RED_SIZE,			8,
+		EGL_GREEN_SIZE,			8,
+		EGL_BLUE_SIZE,			8,
+		EGL_ALPHA_SIZE,			8,
+		EGL_DEPTH_SIZE,			0,
+		EGL_STENCIL_SIZE,		8,
+		EGL_SURFACE_TYPE,		EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE,	EGL_OPENGL_ES2_BIT,
+		EGL_SAMPLE_BUFFERS,		1,
+		EGL_SAMPLES,			4,
+		EGL_NONE
+	};
+
+	static const EGLint contextAttributes[] =
+	{
+		EGL_CONTEXT_CLIENT_VERSION, 2,
+		EGL_NONE
+	};
+
+	state.screenWidth = options.headlessWidth;
+	state.screenHeight = options.headlessHeight;
+
+	state.display = getHeadlessDisplay();
+	if (state.display == EGL_NO_DISPLAY
+		|| eglInitialize(state.display, nullptr, nullptr) == EGL_FALSE)
+	{
+		fprintf(stderr, "Headless: could not initialize an EGL display\n");
+		return false;
+	}
+
+	EGLConfig config;
+	EGLint numConfig = 0;
+	if (eglChooseConfig(state.display, attributeList, &config, 1, &numConfig) == EGL_FALSE
+		|| numConfig == 0)
+	{
+		fprintf(stderr, "Headless: no GLES2 pbuffer config\n");
+		return false;
+	}
+
+	eglBindAPI(EGL_OPENGL_ES_API);
+
+	state.context = eglCreateContext(
+		state.display,
+		config,
+		EGL_NO_CONTEXT,
+		contextAttributes);
+	if (state.context == EGL_NO_CONTEXT) {
+		fprintf(stderr, "Headless: could not create a GLES2 context\n");
+		return false;
+	}
+
+	const EGLint pbufferAttributes[] =
+	{
+		EGL_WIDTH,	(EGLint)state.screenWidth,
+		EGL_HEIGHT,	(EGLint)state.screenHeight,
+		EGL_NONE
+	};
+
+	state.surface = eglCreatePbufferSurface(state.display, config, pbufferAttributes);
+	if (state.surface == EGL_NO_SURFACE) {
+		fprintf(stderr, "Headless: could not create a %ux%u pbuffer\n", state.screenWidth, state.screenHeight);
+		return false;
+	}
+
+	if (eglMakeCurrent(state.display, state.surface, state.surface, state.context) == EGL_FALSE) {
+		fprintf(stderr, "Headless: eglMakeCurrent failed\n");
+		return false;
+	}
+
+	const char* displayExts = eglQueryString(state.display, EGL_EXTENSIONS);
+	if (displayExts && strstr(displayExts, "EGL_KHR_fence_sync")) {
+		headless.createSync = (PFNEGLCREATESYNCKHRPROC)eglGetProcAddress("eglCreateSyncKHR");
+		headless.clientWaitSync = (PFNEGLCLIENTWAITSYNCKHRPROC)eglGetProcAddress("eglClientWaitSyncKHR");
+		headless.destroySync = (PFNEGLDESTROYSYNCKHRPROC)eglGetProcAddress("eglDestroySyncKHR");
+	}
+	headless.prevFrameFence = EGL_NO_SYNC_KHR;
+
+	printf("Headless: %ux%u pbuffer, %s, %s\n",
+		   state.screenWidth, state.screenHeight,
+		   (const char*)glGetString(GL_RENDERER),
+		   (const char*)glGetString(GL_VERSION));
+
+	return true;
+}
+
+
+/**
+ * Write the current color buffer as a binary PPM, flipped to top-down row order.
+ */
+void dumpFrame(
+	u32 frame)
+{
+	u32 w = state.screenWidth;
+	u32 h = state.screenHeight;
+
+	u8* pixels = (u8*)malloc(w * h * 4);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+	char filename[512];
+	snprintf(filename, sizeof(filename), "%s/frame_%06u.ppm", options.dumpDir, frame);
+
+	FILE* f = fopen(filename, "wb");
+	if (f) {
+		fprintf(f, "P6\n%u %u\n255\n", w, h);
+		for (u32 y = h; y-- > 0;) {
+			const u8* row = pixels + y * w * 4;
+			for (u32 x = 0; x < w; ++x) {
+				fwrite(row + x * 4, 1, 3, f);
+			}
+		}
+		fclose(f);
+		++headless.numDumps;
+	}
+	else {
+		fprintf(stderr, "Headless: could not write %s\n", filename);
+	}
+
+	free(pixels);
+}
+
+
+void presentFrame()
+{
+	HeadlessState& hs = headless;
+
+	if (options.dumpEvery > 0 && (hs.numPresented % options.dumpEvery) == 0) {
+		dumpFrame(hs.numPresented);
+	}
+
+	eglSwapBuffers(state.display, state.surface);
+	++hs.numPresented;
+
+	// keep one frame in flight like a double buffered display would, without the fence the driver
+	// queues frames until it stalls for hundreds of ms
+	if (hs.createSync && hs.clientWaitSync && hs.destroySync) {
+		EGLSyncKHR fence = hs.createSync(state.display, EGL_SYNC_FENCE_KHR, nullptr);
+		if (hs.prevFrameFence != EGL_NO_SYNC_KHR) {
+			hs.clientWaitSync(state.display, hs.prevFrameFence, EGL_SYNC_FLUSH_COMMANDS_BIT_KHR, EGL_FOREVER_KHR);
+			hs.destroySync(state.display, hs.prevFrameFence);
+		}
+		hs.prevFrameFence = fence;
+	}
+	else {
+		glFinish();
+	}
+
+	u64 now_nsec = monotonicNsec();
+	if (hs.prevPresent_nsec != 0) {
+		hs.frameTimes_ms[hs.numTimed % HEADLESS_MAX_FRAME_SAMPLES] =
+			(r32)(now_nsec - hs.prevPresent_nsec) * 0.000001f;
+		++hs.numTimed;
+	}
+	hs.prevPresent_nsec = now_nsec;
+}
+
+
+void printFrameTimeSummary()
+{
+	HeadlessState& hs = headless;
+	u32 n = min(hs.numTimed, (u32)HEADLESS_MAX_FRAME_SAMPLES);
+	if (n == 0) {
+		return;
+	}
+
+	r32* t = hs.frameTimes_ms;
+	std::sort(t, t + n);
+
+	r64 sum = 0;
+	for (u32 i = 0; i < n; ++i) {
+		sum += t[i];
+	}
+
+	printf("Headless: %u frames, frame time ms: mean %.3f, min %.3f, p50 %.3f, p99 %.3f, max %.3f, %u frames dumped\n",
+		   hs.numPresented, sum / n, t[0], t[n / 2], t[(u32)(n * 0.99)], t[n - 1], hs.numDumps);
+}
+
+
+void cleanupDisplay()
+{
+	printFrameTimeSummary();
+
+	if (headless.prevFrameFence != EGL_NO_SYNC_KHR) {
+		headless.destroySync(state.display, headless.prevFrameFence);
+	}
+
+	eglMakeCurrent(state.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglDestroySurface(state.display, state.surface);
+	eglDestroyContext(state.display, state.context);
+	eglTerminate(state.display);
+}
@@ -0,0 +1,152 @@
+#include "bcm_host.h"
+#include "platform.h"
+
+extern "C" {
+#include "revision.h"
+}
+
+
+bool initDisplay()
+{
+	bcm_host_init();
+
+	if (get_processor_id() == PROCESSOR_BCM2838)
+	{
+		fprintf(stderr, "This application is not available on the Pi4\n");
+		exit(0);
+	}
+
+	static EGL_DISPMANX_WINDOW_T nativeWindow;
+
+	static const EGLint attributeList[] =
+	{
+		EGL_RED_SIZE,		8,
+		EGL_GREEN_SIZE,		8,
+		EGL_BLUE_SIZE,		8,
+		EGL_ALPHA_SIZE,		8,
+		EGL_DEPTH_SIZE,		0,
+		EGL_STENCIL_SIZE,	8,	// NanoVG fills and NVG_STENCIL_STROKES, keep platform_headless.cpp in step
+		EGL_SURFACE_TYPE,	EGL_WINDOW_BIT,
+		EGL_SAMPLE_BUFFERS,	1,
+		EGL_SAMPLES,		4, // 4x MSAA
+		EGL_MIN_SWAP_INTERVAL, 0,
+		EGL_NONE
+	};
+
+	static const EGLint contextAttributes[] = 
+	{
+		EGL_CONTEXT_CLIENT_VERSION, 2,
+		EGL_NONE
+	};
+
+	// get an EGL display connection
+	state.display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	assert(state.display != EGL_NO_DISPLAY);
+
+	// initialize the EGL display connection
+	EGLBoolean result = eglInitialize(state.display, nullptr, nullptr);
+	assert(result != EGL_FALSE);
+
+	// get an appropriate EGL frame buffer configuration
+	EGLConfig config;
+	EGLint numConfig;
+	result = eglChooseConfig(
+		state.display,
+		attributeList,
+		&config,
+		1,
+		&numConfig);
+	assert(result != EGL_FALSE);
+
+	// get an appropriate EGL frame buffer configuration
+	result = eglBindAPI(EGL_OPENGL_ES_API);
+	assert(result != EGL_FALSE);
+
+	// create an EGL rendering context
+	state.context = eglCreateContext(
+		state.display,
+		config,
+		EGL_NO_CONTEXT,
+		contextAttributes);
+	assert(state.context != EGL_NO_CONTEXT);
+
+	// create an EGL window surface
+	i32 success = graphics_get_display_size(
+		0, // LCD
+		&state.screenWidth,
+		&state.screenHeight);
+	assert(success >= 0);
+
+	VC_RECT_T dstRect{};
+	dstRect.x = 0;
+	dstRect.y = 0;
+	dstRect.width = state.screenWidth;
+	dstRect.height = state.screenHeight;
+	
+	VC_RECT_T srcRect{};
+	srcRect.x = 0;
+	srcRect.y = 0;
+	srcRect.width = state.screenWidth << 16;
+	srcRect.height = state.screenHeight << 16;        
+
+	state.dispmanDisplay = vc_dispmanx_display_open(0); // LCD
+	DISPMANX_UPDATE_HANDLE_T dispmanUpdate = vc_dispmanx_update_start(0);
+			
+	state.dispmanElement = vc_dispmanx_element_add(
+		dispmanUpdate,
+		state.dispmanDisplay,
+		0, // layer
+		&dstRect,
+		0, // src
+		&srcRect,
+		DISPMANX_PROTECTION_NONE,
+		nullptr, // alpha
+		nullptr, // clamp
+		(DISPMANX_TRANSFORM_T)0); // transform
+		
+	nativeWindow.element = state.dispmanElement;
+	nativeWindow.width = state.screenWidth;
+	nativeWindow.height = state.screenHeight;
+	vc_dispmanx_update_submit_sync(dispmanUpdate);
+	
+	state.surface = eglCreateWindowSurface(
+		state.display,
+		config,
+		&nativeWindow,
+		nullptr);
+	assert(state.surface != EGL_NO_SURFACE);
+
+	// connect the context to the surface
+	result = eglMakeCurrent(state.display, state.surface, state.surface, state.context);
+	assert(result != EGL_FALSE);
+
+	return true;
+}
+
+
+void presentFrame()
+{
+	eglSwapBuffers(state.display, state.surface);
+}
+
+
+void cleanupDisplay()
+{
+	// leave the LCD blank
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+	eglSwapBuffers(state.display, state.surface);
+
+	eglDestroySurface(state.display, state.surface);
+
+	DISPMANX_UPDATE_HANDLE_T dispmanUpdate = vc_dispmanx_update_start(0);
+	int s = vc_dispmanx_element_remove(dispmanUpdate, state.dispmanElement);
+	assert(s == 0);
+	vc_dispmanx_update_submit_sync(dispmanUpdate);
+	s = vc_dispmanx_display_close(state.dispmanDisplay);
+	assert(s == 0);
+
+	// Release OpenGL resources
+	eglMakeCurrent(state.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglDestroyContext(state.display, state.context);
+	eglTerminate(state.display);
+}
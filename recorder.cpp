@@ -0,0 +1,300 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <atomic>
+#include <thread>
+#include "recorder.h"
+#include "utility/clock.h"
+#include "utility/log.h"
+
+
+struct Recorder {
+	int					fd = -1;
+	u8*					map;
+	size_t				mapSize;
+	u64					capacity;	// records that fit in the current mapping
+	RecordHeader*		header;
+	RecordedMessage*	records;
+};
+
+struct Replay {
+	int					fd = -1;
+	u8*					map;
+	size_t				mapSize;
+	const RecordHeader*	header;
+	const RecordedMessage* records;
+	MQTTState*			mqttState;
+	r32					speed;
+	std::atomic<bool>	running;
+	std::atomic<bool>	finished;
+	std::thread			thread;
+};
+
+Recorder recorder;
+Replay replay;
+
+
+size_t recordFileSize(
+	u64 numRecords)
+{
+	return sizeof(RecordHeader) + (size_t)numRecords * sizeof(RecordedMessage);
+}
+
+
+bool mapRecording(
+	Recorder& rec,
+	u64 capacity)
+{
+	size_t size = recordFileSize(capacity);
+	if (ftruncate(rec.fd, (off_t)size) != 0) {
+		logError("Recorder could not grow capture file, errno={}", errno);
+		return false;
+	}
+
+	void* map = (rec.map
+		? mremap(rec.map, rec.mapSize, size, MREMAP_MAYMOVE)
+		: mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, rec.fd, 0));
+	if (map == MAP_FAILED) {
+		logError("Recorder could not map capture file, errno={}", errno);
+		return false;
+	}
+
+	rec.map = (u8*)map;
+	rec.mapSize = size;
+	rec.capacity = capacity;
+	rec.header = (RecordHeader*)rec.map;
+	rec.records = (RecordedMessage*)(rec.map + sizeof(RecordHeader));
+	return true;
+}
+
+
+bool initRecorder(
+	const char* filename)
+{
+	Recorder& rec = recorder;
+
+	rec.fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (rec.fd < 0) {
+		fprintf(stderr, "Could not create capture file %s: %s\n", filename, strerror(errno));
+		return false;
+	}
+
+	if (!mapRecording(rec, RECORDER_INITIAL_RECORDS)) {
+		close(rec.fd);
+		rec.fd = -1;
+		return false;
+	}
+
+	RecordHeader& h = *rec.header;
+	memcpy(h.magic, RECORDER_MAGIC, sizeof(h.magic));
+	h.version = RECORDER_VERSION;
+	h.recordSize = sizeof(RecordedMessage);
+	h.numRecords = 0;
+	h.numTruncated = 0;
+
+	printf("Recording to %s\n", filename);
+
+	return true;
+}
+
+
+void recordMessage(
+	u16 subIndex,
+	u32 topicHash,
+	const void* payload,
+	int payloadLen,
+	u64 nsec)
+{
+	Recorder& rec = recorder;
+	if (!rec.map) {
+		return;
+	}
+
+	u64 n = rec.header->numRecords;
+	if (n == rec.capacity && !mapRecording(rec, rec.capacity * 2)) {
+		return;
+	}
+
+	RecordedMessage& r = rec.records[n];
+	u32 len = (payloadLen > 0 ? min((u32)payloadLen, (u32)RECORDER_PAYLOAD_SIZE) : 0);
+	if (payloadLen > RECORDER_PAYLOAD_SIZE) {
+		if (rec.header->numTruncated++ == 0) {
+			logWarn("Recorder truncated a {} byte payload to {} bytes, replay will differ",
+					payloadLen, RECORDER_PAYLOAD_SIZE);
+		}
+	}
+	r.nsec = nsec;
+	r.topicHash = topicHash;
+	r.subIndex = subIndex;
+	r.payloadLen = (u16)len;
+	memcpy(r.payload, payload, len);
+	memset(r.payload + len, 0, RECORDER_PAYLOAD_SIZE - len);
+
+	rec.header->numRecords = n + 1;
+}
+
+
+void cleanupRecorder()
+{
+	Recorder& rec = recorder;
+	if (rec.fd < 0) {
+		return;
+	}
+
+	u64 numRecords = rec.header->numRecords;
+	u64 numTruncated = rec.header->numTruncated;
+	munmap(rec.map, rec.mapSize);
+	rec.map = nullptr;
+
+	// drop the unused preallocated tail
+	if (ftruncate(rec.fd, (off_t)recordFileSize(numRecords)) != 0) {
+		fprintf(stderr, "Could not trim capture file: %s\n", strerror(errno));
+	}
+	close(rec.fd);
+	rec.fd = -1;
+
+	printf("Recorder done, %llu messages captured, %llu truncated to %d bytes\n",
+		   (unsigned long long)numRecords, (unsigned long long)numTruncated, RECORDER_PAYLOAD_SIZE);
+}
+
+
+void replayLoop()
+{
+	Replay& rp = replay;
+	u64 numRecords = rp.header->numRecords;
+	u64 start_nsec = monotonicNsec();
+	u64 firstRecord_nsec = (numRecords ? rp.records[0].nsec : 0);
+	u64 dispatched = 0;
+
+	for(u64 n = 0;
+		n < numRecords && rp.running.load(std::memory_order_relaxed);
+		++n)
+	{
+		const RecordedMessage& r = rp.records[n];
+
+		if (r.subIndex >= Q_countof(subs) || subs[r.subIndex].topicHash != r.topicHash) {
+			logWarn("Replay record {} does not match the subscription table, skipped", n);
+			continue;
+		}
+		if (r.payloadLen > RECORDER_PAYLOAD_SIZE) {
+			logWarn("Replay record {} has a {} byte payload, over {}, skipped", n, r.payloadLen, RECORDER_PAYLOAD_SIZE);
+			continue;
+		}
+
+		if (rp.speed > 0) {
+			u64 due_nsec = start_nsec + (u64)((r64)(r.nsec - firstRecord_nsec) / rp.speed);
+			sleepUntilNsec(due_nsec);
+		}
+
+		// copy out of the mapping, handlers may expect a writable, terminated payload
+		char payload[RECORDER_PAYLOAD_SIZE + 1] = {};
+		memcpy(payload, r.payload, r.payloadLen);
+
+		mosquitto_message msg{};
+		msg.topic = (char*)subs[r.subIndex].topic;
+		msg.payload = payload;
+		msg.payloadlen = r.payloadLen;
+		msg.qos = subs[r.subIndex].qos;
+
+		onMessage(nullptr, rp.mqttState, &msg);
+		++dispatched;
+	}
+
+	r64 elapsed_s = (r64)(monotonicNsec() - start_nsec) * 1e-9;
+	logInfo("Replay finished, {} of {} messages in {} s", dispatched, numRecords, elapsed_s);
+	rp.finished.store(true, std::memory_order_release);
+}
+
+
+bool initReplay(
+	MQTTState* mqttState,
+	const char* filename,
+	r32 speed)
+{
+	Replay& rp = replay;
+
+	rp.fd = open(filename, O_RDONLY);
+	if (rp.fd < 0) {
+		fprintf(stderr, "Could not open capture file %s: %s\n", filename, strerror(errno));
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(rp.fd, &st) != 0 || (size_t)st.st_size < sizeof(RecordHeader)) {
+		fprintf(stderr, "Capture file %s is too small\n", filename);
+		cleanupReplay();
+		return false;
+	}
+
+	rp.mapSize = (size_t)st.st_size;
+	void* map = mmap(nullptr, rp.mapSize, PROT_READ, MAP_PRIVATE, rp.fd, 0);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "Could not map capture file %s: %s\n", filename, strerror(errno));
+		rp.map = nullptr;
+		cleanupReplay();
+		return false;
+	}
+	rp.map = (u8*)map;
+	rp.header = (const RecordHeader*)rp.map;
+	rp.records = (const RecordedMessage*)(rp.map + sizeof(RecordHeader));
+
+	const RecordHeader& h = *rp.header;
+	if (memcmp(h.magic, RECORDER_MAGIC, sizeof(h.magic)) != 0
+		|| h.version != RECORDER_VERSION
+		|| h.recordSize != sizeof(RecordedMessage)
+		|| h.numRecords > (rp.mapSize - sizeof(RecordHeader)) / sizeof(RecordedMessage))
+	{
+		fprintf(stderr, "%s is not a valid capture file\n", filename);
+		cleanupReplay();
+		return false;
+	}
+
+	if (h.numTruncated > 0) {
+		fprintf(stderr, "%s: %llu payloads were truncated to %d bytes when recorded, replay will differ\n",
+				filename, (unsigned long long)h.numTruncated, RECORDER_PAYLOAD_SIZE);
+	}
+
+	rp.mqttState = mqttState;
+	rp.speed = speed;
+	rp.finished.store(false, std::memory_order_relaxed);
+	rp.running.store(true, std::memory_order_relaxed);
+
+	buildDispatchIndex(dispatchIndex);
+	rp.thread = std::thread(replayLoop);
+
+	if (speed > 0) {
+		printf("Replaying %llu messages from %s at %.2fx\n", (unsigned long long)h.numRecords, filename, speed);
+	}
+	else {
+		printf("Replaying %llu messages from %s as fast as possible\n", (unsigned long long)h.numRecords, filename);
+	}
+
+	return true;
+}
+
+
+bool isReplayFinished()
+{
+	return replay.finished.load(std::memory_order_acquire);
+}
+
+
+void cleanupReplay()
+{
+	Replay& rp = replay;
+
+	rp.running.store(false, std::memory_order_relaxed);
+	if (rp.thread.joinable()) {
+		rp.thread.join();
+	}
+	if (rp.map) {
+		munmap(rp.map, rp.mapSize);
+		rp.map = nullptr;
+	}
+	if (rp.fd >= 0) {
+		close(rp.fd);
+		rp.fd = -1;
+	}
+}
@@ -0,0 +1,65 @@
+#ifndef _RECORDER_H
+#define _RECORDER_H
+
+#include "utility/types.h"
+#include "mqtt.h"
+
+#define RECORDER_MAGIC			"ADIREC01"
+#define RECORDER_VERSION		1
+#define RECORDER_PAYLOAD_SIZE	16
+#define RECORDER_INITIAL_RECORDS	(64 * 1024)
+
+/**
+ * Capture file layout: one RecordHeader followed by numRecords fixed-size RecordedMessages. The
+ * file is memory mapped and append-only; numRecords is updated after every record so a capture
+ * from a process that did not exit cleanly is still readable.
+ */
+struct RecordHeader {
+	char	magic[8];
+	u32		version;
+	u32		recordSize;
+	u64		numRecords;
+	u64		numTruncated;	// records whose payload was longer than RECORDER_PAYLOAD_SIZE
+};
+static_assert(sizeof(RecordHeader) == 32, "");
+
+struct RecordedMessage {
+	u64		nsec;			// CLOCK_MONOTONIC receive time
+	u32		topicHash;		// subs[subIndex].topicHash when recorded, checked on replay
+	u16		subIndex;		// index into subs[] in mqtt.cpp
+	u16		payloadLen;		// bytes used in payload, longer payloads are truncated and counted
+	char	payload[RECORDER_PAYLOAD_SIZE];
+};
+static_assert(sizeof(RecordedMessage) == 32, "");
+
+/**
+ * Record every message that matches a subscription to filename. Recording runs on the mosquitto
+ * loop thread and only makes a syscall when the file has to grow.
+ */
+bool initRecorder(
+	const char* filename);
+
+void recordMessage(
+	u16 subIndex,
+	u32 topicHash,
+	const void* payload,
+	int payloadLen,
+	u64 nsec);
+
+void cleanupRecorder();
+
+/**
+ * Replace the network input with a capture. Messages are fed through the same MQTT dispatch and
+ * handlers on a replay thread. speed scales the recorded timing (2 = twice as fast), 0 replays as
+ * fast as possible.
+ */
+bool initReplay(
+	MQTTState* mqttState,
+	const char* filename,
+	r32 speed);
+
+bool isReplayFinished();
+
+void cleanupReplay();
+
+#endif
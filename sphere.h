@@ -0,0 +1,234 @@
+#ifndef _SPHERE_H
+#define _SPHERE_H
+
+#include "utility/types.h"
+#include "math/qmath.h"
+
+/**
+ * The visible band of the ADI ball: 90 degrees of longitude around the pitch axis (x) split into
+ * columns, the full 360 degrees of latitude split into rows, drawn as one triangle strip per
+ * column joined with degenerate triangles. The display uses the copy baked into sphere_mesh.h at
+ * build time by tools/gen_sphere_mesh.cpp; tools/mesh_bench builds it at runtime.
+ *
+ * SPHERE_COLS x SPHERE_ROWS is the finest level of detail. Level l uses every 2^l-th column and
+ * row of the same vertex grid, so all levels share one vertex buffer and differ only in their
+ * index lists, which are stored back to back in one index buffer.
+ */
+#define SPHERE_RADIUS			1.75f	// inches
+#ifndef SPHERE_COLS
+#define SPHERE_COLS				24
+#endif
+#ifndef SPHERE_ROWS
+#define SPHERE_ROWS				96
+#endif
+#ifndef SPHERE_LOD_LEVELS
+#define SPHERE_LOD_LEVELS		3
+#endif
+#define SPHERE_NUM_VERTS		((SPHERE_COLS + 1) * (SPHERE_ROWS + 1))
+static_assert(SPHERE_NUM_VERTS <= 65536, "indexes are u16");
+static_assert(SPHERE_LOD_LEVELS >= 1
+			  && (SPHERE_COLS % (1 << (SPHERE_LOD_LEVELS - 1))) == 0
+			  && (SPHERE_ROWS % (1 << (SPHERE_LOD_LEVELS - 1))) == 0,
+			  "every level must divide the finest grid evenly");
+
+/**
+ * Vertex as stored in the GL buffer. On a unit sphere the normal equals the position, so only the
+ * position is stored, as snorm16 scaled by SPHERE_RADIUS in the model matrix, and the vertex
+ * shader derives the normal from it. Texture coordinates are unorm16. 12 bytes, down from 32 for
+ * float position + normal + uv, and a single interleaved stream instead of three.
+ */
+struct SphereVertex {
+	i16		x, y, z;
+	i16		pad;		// keeps uv 4-byte aligned for the vertex fetch
+	u16		s, t;
+};
+static_assert(sizeof(SphereVertex) == 12, "");
+
+/**
+ * One level of detail, a range of the shared index buffer.
+ */
+struct SphereLod {
+	u32		firstIndex;
+	u32		numIndexes;
+	u32		cols;
+	u32		rows;
+};
+
+
+constexpr u32 sphereLodCols(
+	u32 level)
+{
+	return SPHERE_COLS >> level;
+}
+
+
+constexpr u32 sphereLodRows(
+	u32 level)
+{
+	return SPHERE_ROWS >> level;
+}
+
+
+constexpr u32 sphereLodNumIndexes(
+	u32 level)
+{
+	return (((sphereLodRows(level) + 1) * 2) + 2) * sphereLodCols(level) - 1;
+}
+
+
+constexpr u32 sphereLodFirstIndex(
+	u32 level)
+{
+	return (level == 0 ? 0 : sphereLodFirstIndex(level - 1) + sphereLodNumIndexes(level - 1));
+}
+
+#define SPHERE_NUM_INDEXES		sphereLodFirstIndex(SPHERE_LOD_LEVELS)
+
+
+inline i16 packSnorm16(
+	r32 v)
+{
+	v = (v < -1.0f ? -1.0f : (v > 1.0f ? 1.0f : v));
+	return (i16)lroundf(v * 32767.0f);
+}
+
+
+inline u16 packUnorm16(
+	r32 v)
+{
+	v = (v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v));
+	return (u16)lroundf(v * 65535.0f);
+}
+
+
+/**
+ * Unit position (also the normal) and uv of the finest level vertex at column c, row r.
+ */
+inline void sphereVertex(
+	u32 c,
+	u32 r,
+	vec3& pos,
+	vec2& uv)
+{
+	r32 colRad = -45.0f * DEG_TO_RADf + c * (90.0f * DEG_TO_RADf / SPHERE_COLS);
+	r32 rowRad = (r != SPHERE_ROWS
+		? r * (360.0f * DEG_TO_RADf / SPHERE_ROWS)
+		: 0);	// ensure last row exactly equals first
+
+	r32 colUnitRadius = cosf(colRad);
+	pos.x = sinf(colRad);
+	pos.y = sinf(rowRad) * colUnitRadius;
+	pos.z = cosf(rowRad) * colUnitRadius;
+	pos = normalize(pos);
+
+	uv.s = (r32)r / (r32)SPHERE_ROWS;
+	uv.t = (r32)c / (r32)SPHERE_COLS;
+}
+
+
+inline void makeSphereVertices(
+	SphereVertex* verts)
+{
+	u32 v = 0;
+	for (u32 c = 0; c <= SPHERE_COLS; ++c) {
+		for (u32 r = 0; r <= SPHERE_ROWS; ++r) {
+			vec3 pos;
+			vec2 uv;
+			sphereVertex(c, r, pos, uv);
+
+			SphereVertex& sv = verts[v++];
+			sv.x = packSnorm16(pos.x);
+			sv.y = packSnorm16(pos.y);
+			sv.z = packSnorm16(pos.z);
+			sv.pad = 0;
+			sv.s = packUnorm16(uv.s);
+			sv.t = packUnorm16(uv.t);
+		}
+	}
+}
+
+
+/**
+ * Triangle strip indexes for one level, referencing the finest level vertex grid.
+ */
+inline void makeSphereIndexes(
+	u16* indexes,
+	u32 level)
+{
+	const u32 step = 1 << level;
+	const u32 numRowVerts = SPHERE_ROWS + 1;
+	u32 i = 0;
+
+	for (u32 c = 0; c < SPHERE_COLS; c += step) {
+		u32 colBaseV = c * numRowVerts;
+		u32 nextColBaseV = (c + step) * numRowVerts;
+
+		// add point for degenerate triangle from end of row to start of next row
+		if (c > 0) {
+			indexes[i++] = colBaseV;
+		}
+
+		for (u32 r = 0; r < numRowVerts; r += step) {
+			indexes[i++] = colBaseV + r;
+			indexes[i++] = nextColBaseV + r;
+		}
+		// add point for degenerate triangle from end of row to start of next row
+		indexes[i] = indexes[i-1];
+		++i;
+	}
+	assert(i == sphereLodNumIndexes(level));
+}
+
+
+inline SphereLod sphereLod(
+	u32 level)
+{
+	return SphereLod{ sphereLodFirstIndex(level), sphereLodNumIndexes(level),
+					  sphereLodCols(level), sphereLodRows(level) };
+}
+
+
+/**
+ * Radius of the ball in pixels under an orthographic projection, the smaller of the two axes.
+ */
+inline r32 sphereProjectedRadius(
+	const mat4& orthoProj,
+	u32 screenWidth,
+	u32 screenHeight)
+{
+	r32 rx = SPHERE_RADIUS * fabsf(orthoProj.E[0]) * 0.5f * (r32)screenWidth;
+	r32 ry = SPHERE_RADIUS * fabsf(orthoProj.E[5]) * 0.5f * (r32)screenHeight;
+	return min(rx, ry);
+}
+
+
+/**
+ * Largest distance in pixels between the true surface and a level's facets, the sagitta of its
+ * widest segment.
+ */
+inline r32 sphereLodError(
+	u32 level,
+	r32 radius_px)
+{
+	r32 colRad = 0.5f * PIf / (r32)sphereLodCols(level);
+	r32 rowRad = 2.0f * PIf / (r32)sphereLodRows(level);
+	return radius_px * (1.0f - cosf(max(colRad, rowRad) * 0.5f));
+}
+
+
+/**
+ * Coarsest level whose facet error stays within maxError_px, the finest level if none does.
+ */
+inline u32 selectSphereLod(
+	r32 radius_px,
+	r32 maxError_px)
+{
+	for (u32 level = SPHERE_LOD_LEVELS; level-- > 0;) {
+		if (sphereLodError(level, radius_px) <= maxError_px) {
+			return level;
+		}
+	}
+	return 0;
+}
+
+#endif
@@ -0,0 +1,316 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "texture.h"
+#include "ktx.h"
+#include "utility/image.h"
+
+#ifndef GL_TEXTURE_MAX_ANISOTROPY_EXT
+#define GL_TEXTURE_MAX_ANISOTROPY_EXT		0x84FE
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT	0x84FF
+#endif
+
+
+static const char* textureFilterNames[Filter_Count] = {
+	"nearest", "bilinear", "nearest-mip", "bilinear-mip", "trilinear", "aniso"
+};
+
+
+const char* textureFilterName(
+	TextureFilter filter)
+{
+	return (filter < Filter_Count ? textureFilterNames[filter] : "unknown");
+}
+
+
+bool parseTextureFilter(
+	const char* name,
+	TextureFilter& filter)
+{
+	for (u32 f = 0; f < Filter_Count; ++f) {
+		if (strcmp(name, textureFilterNames[f]) == 0) {
+			filter = (TextureFilter)f;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+bool textureFilterUsesMips(
+	TextureFilter filter)
+{
+	return filter >= Filter_NearestMip;
+}
+
+
+bool hasGLExtension(
+	const char* name)
+{
+	const char* exts = (const char*)glGetString(GL_EXTENSIONS);
+	size_t len = strlen(name);
+
+	for (const char* e = exts; e && (e = strstr(e, name)) != nullptr; e += len) {
+		if ((e == exts || e[-1] == ' ') && (e[len] == ' ' || e[len] == '\0')) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/**
+ * Maps a KTX file made by tools/png_to_ktx.cpp and hands mip levels to glCompressedTexImage2D
+ * straight from the mapping, nothing is decoded or copied on the CPU. The first tier levels are
+ * skipped, and only one level is uploaded when mips is false. Returns false, leaving tex
+ * untouched, when the file is missing or not an ETC1 KTX.
+ */
+bool loadKTXTexture(
+	const char* filename,
+	u32 tier,
+	bool mips,
+	Texture& tex)
+{
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(KTXHeader)) {
+		close(fd);
+		return false;
+	}
+	size_t size = (size_t)st.st_size;
+
+	const u8* data = (const u8*)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		fprintf(stderr, "Texture map failed: %s\n", filename);
+		return false;
+	}
+
+	const KTXHeader& header = *(const KTXHeader*)data;
+	bool ok = isETC1KTXHeader(header);
+	if (!ok) {
+		fprintf(stderr, "Texture %s is not an ETC1 KTX file\n", filename);
+	}
+	else if (tier >= header.numberOfMipmapLevels) {
+		fprintf(stderr, "Texture %s has no tier %u, it has %u levels\n",
+				filename, tier, header.numberOfMipmapLevels);
+		ok = false;
+	}
+
+	Texture t{};
+	t.compressed = true;
+	if (ok) {
+		glGenTextures(1, &t.name);
+		glBindTexture(GL_TEXTURE_2D, t.name);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+
+	size_t offset = sizeof(KTXHeader) + header.bytesOfKeyValueData;
+	u32 w = header.pixelWidth;
+	u32 h = header.pixelHeight;
+	u32 lastLevel = (mips ? header.numberOfMipmapLevels : tier + 1);
+
+	for (u32 level = 0; ok && level < lastLevel; ++level) {
+		u32 imageSize = 0;
+		if (offset + sizeof(imageSize) <= size) {
+			memcpy(&imageSize, data + offset, sizeof(imageSize));
+			offset += sizeof(imageSize);
+		}
+
+		if (imageSize != etc1ImageSize(w, h) || offset + imageSize > size) {
+			fprintf(stderr, "Texture %s is truncated at level %u\n", filename, level);
+			ok = false;
+			break;
+		}
+
+		if (level >= tier) {
+			if (level == tier) {
+				t.width = w;
+				t.height = h;
+			}
+			glCompressedTexImage2D(
+				GL_TEXTURE_2D,
+				level - tier,
+				KTX_GL_ETC1_RGB8_OES,	// internal format
+				w, h,
+				0,						// border
+				imageSize,
+				data + offset);
+			++t.levels;
+			t.bytes += imageSize;
+		}
+
+		offset += (imageSize + 3) & ~3u;	// mip padding
+		w = max(w / 2, (u32)1);
+		h = max(h / 2, (u32)1);
+	}
+
+	if (ok && glGetError() != GL_NO_ERROR) {
+		fprintf(stderr, "Texture upload failed: %s\n", filename);
+		ok = false;
+	}
+
+	if (ok) {
+		tex = t;
+	}
+	else if (t.name != 0) {
+		glDeleteTextures(1, &t.name);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	munmap((void*)data, size);
+	return ok;
+}
+
+
+/**
+ * Decodes a PNG, box filters it down tier times and builds the mip chain with glGenerateMipmap
+ * when mips is true. GLES2 only mipmaps power of two textures, others get level 0 alone.
+ */
+bool loadPNGTexture(
+	const char* filename,
+	u32 tier,
+	bool mips,
+	Texture& tex)
+{
+	int w, h, n;
+
+	u8* img = stbi_load(filename, &w, &h, &n, 3);
+	if (img == nullptr) {
+		fprintf(stderr, "Texture load failed: %s - %s\n", filename, stbi_failure_reason());
+		return false;
+	}
+
+	u8* pixels = img;
+	u32 tw = (u32)w, th = (u32)h;
+	for (u32 t = 0; t < tier && pixels && (tw > 1 || th > 1); ++t) {
+		u32 nw, nh;
+		u8* next = downsampleRGB(pixels, tw, th, nw, nh);
+		if (pixels != img) {
+			free(pixels);
+		}
+		pixels = next;
+		tw = nw;
+		th = nh;
+	}
+	if (pixels == nullptr) {
+		stbi_image_free(img);
+		return false;
+	}
+
+	bool pow2 = ((tw & (tw - 1)) == 0 && (th & (th - 1)) == 0);
+	if (mips && !pow2) {
+		fprintf(stderr, "Texture %s is %ux%u, not a power of 2, no mips\n", filename, tw, th);
+		mips = false;
+	}
+
+	Texture t{};
+	t.width = tw;
+	t.height = th;
+
+	glGenTextures(1, &t.name);
+	glBindTexture(GL_TEXTURE_2D, t.name);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(
+		GL_TEXTURE_2D,
+		0,					// level
+		GL_RGB,				// internal format
+		tw, th,				// width, height
+		0,					// border
+		GL_RGB,				// format
+		GL_UNSIGNED_BYTE,	// type
+		pixels);
+	t.levels = 1;
+	t.bytes = tw * th * 3;
+
+	if (mips) {
+		glGenerateMipmap(GL_TEXTURE_2D);
+		t.levels = mipLevelCount(tw, th);
+		t.bytes += t.bytes / 3;		// geometric series of quarter size levels
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	if (pixels != img) {
+		free(pixels);
+	}
+	stbi_image_free(img);
+	tex = t;
+
+	return true;
+}
+
+
+void setTextureFilter(
+	const Texture& tex,
+	TextureQuality& quality)
+{
+	static const GLint minFilters[Filter_Count] = {
+		GL_NEAREST, GL_LINEAR, GL_NEAREST_MIPMAP_NEAREST, GL_LINEAR_MIPMAP_NEAREST,
+		GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR_MIPMAP_LINEAR
+	};
+
+	// a texture without its mip chain is incomplete under a mip filter and samples black
+	if (textureFilterUsesMips(quality.filter) && tex.levels < mipLevelCount(tex.width, tex.height)) {
+		quality.filter = Filter_Bilinear;
+	}
+
+	bool hasAnisotropy = hasGLExtension("GL_EXT_texture_filter_anisotropic");
+	r32 anisotropy = 1.0f;
+	if (quality.filter == Filter_Anisotropic) {
+		if (hasAnisotropy) {
+			r32 driverMax = 1.0f;
+			glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &driverMax);
+			anisotropy = max(1.0f, min(quality.maxAnisotropy, driverMax));
+			quality.maxAnisotropy = anisotropy;
+		}
+		else {
+			quality.filter = Filter_Trilinear;
+		}
+	}
+
+	glBindTexture(GL_TEXTURE_2D, tex.name);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilters[quality.filter]);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
+					(quality.filter == Filter_Nearest || quality.filter == Filter_NearestMip
+					 ? GL_NEAREST : GL_LINEAR));
+	if (hasAnisotropy) {
+		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, anisotropy);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+
+bool loadTexture(
+	const char* ktxFilename,
+	const char* pngFilename,
+	TextureQuality& quality,
+	Texture& tex)
+{
+	bool mips = textureFilterUsesMips(quality.filter);
+
+	// the ETC1 copy is built from the PNG by the Makefile, the PNG is the fallback for drivers
+	// without ETC1 and for trees where it was not built
+	bool loaded = hasGLExtension("GL_OES_compressed_ETC1_RGB8_texture")
+		&& loadKTXTexture(ktxFilename, quality.tier, mips, tex);
+
+	if (!loaded && !loadPNGTexture(pngFilename, quality.tier, mips, tex)) {
+		return false;
+	}
+
+	setTextureFilter(tex, quality);
+
+	return true;
+}
+
+
+void freeTexture(
+	Texture& tex)
+{
+	glDeleteTextures(1, &tex.name);
+	tex = Texture{};
+}
@@ -0,0 +1,71 @@
+#ifndef _TEXTURE_H
+#define _TEXTURE_H
+
+#include "utility/types.h"
+#include "GLES2/gl2.h"
+
+/**
+ * Instrument artwork loading and sampling quality. Artwork is loaded from the ETC1 KTX made by
+ * tools/png_to_ktx.cpp, which carries its mip chain, or decoded from the PNG with the chain built
+ * by glGenerateMipmap. Filter modes trade fill-rate for quality, cheapest first; modes without
+ * mips upload level 0 only. The resolution tier drops the largest levels, each tier halving both
+ * dimensions and quartering texture memory and sampling bandwidth, for small or slow displays.
+ */
+enum TextureFilter : u8
+{
+	Filter_Nearest = 0,		// GL_NEAREST, shimmers when minified
+	Filter_Bilinear,		// GL_LINEAR
+	Filter_NearestMip,		// GL_NEAREST_MIPMAP_NEAREST
+	Filter_BilinearMip,		// GL_LINEAR_MIPMAP_NEAREST
+	Filter_Trilinear,		// GL_LINEAR_MIPMAP_LINEAR
+	Filter_Anisotropic,		// trilinear plus EXT_texture_filter_anisotropic, trilinear without it
+	Filter_Count
+};
+
+struct TextureQuality {
+	TextureFilter	filter;
+	u32				tier;			// 0 = full resolution, each tier halves both dimensions
+	r32				maxAnisotropy;	// Filter_Anisotropic only, clamped to the driver limit
+};
+
+struct Texture {
+	GLuint		name;
+	u32			width;				// of the uploaded level 0, after the tier
+	u32			height;
+	u32			levels;
+	u32			bytes;				// all uploaded levels, as the data was handed to GL
+	bool		compressed;
+};
+
+const char* textureFilterName(
+	TextureFilter filter);
+
+bool parseTextureFilter(
+	const char* name,
+	TextureFilter& filter);
+
+bool textureFilterUsesMips(
+	TextureFilter filter);
+
+bool hasGLExtension(
+	const char* name);
+
+/**
+ * Loads ktxFilename when the driver has ETC1, otherwise decodes pngFilename. Mips are uploaded or
+ * generated only when the filter needs them. The filter is applied; Filter_Anisotropic becomes
+ * Filter_Trilinear, written back to quality, when the extension is missing.
+ */
+bool loadTexture(
+	const char* ktxFilename,
+	const char* pngFilename,
+	TextureQuality& quality,
+	Texture& tex);
+
+void setTextureFilter(
+	const Texture& tex,
+	TextureQuality& quality);
+
+void freeTexture(
+	Texture& tex);
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef _BENCH_H
+#define _BENCH_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <ctime>
+#include "utility/common.h"
+#include "utility/clock.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * Timing harness for the CPU microbenchmarks. A pass is a function running the code under test
+ * over a fixed set of items. The harness runs it for a warmup period, doubles the passes per
+ * sample until a sample is long enough for the clock to resolve, then takes the samples and
+ * summarizes them as ns per item. Times are CLOCK_MONOTONIC. On x86 the TSC is read alongside and
+ * reported as ticks, constant rate reference cycles rather than core cycles; other targets have
+ * no user readable cycle counter by default and report 0.
+ */
+#define BENCH_MAX_SAMPLES		101
+
+struct BenchConfig {
+	u64		warmupNsec;
+	u64		sampleNsec;			// minimum length of one sample
+	u32		samples;
+};
+
+struct BenchStats {
+	r64		minNs;				// all per item
+	r64		medianNs;
+	r64		meanNs;
+	r64		stddevNs;
+	r64		maxNs;
+	r64		medianTicks;
+	u32		samples;
+	u64		passesPerSample;
+	u32		itemsPerPass;
+};
+
+struct BenchResult {
+	const char*	name;
+	const char*	baseline;		// name of the result this one is compared to, or nullptr
+	BenchStats	stats;
+};
+
+
+inline u64 benchTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+
+inline const char* benchArch()
+{
+#if defined(__aarch64__)
+	return "aarch64";
+#elif defined(__arm__)
+	return "arm";
+#elif defined(__x86_64__)
+	return "x86_64";
+#elif defined(__i386__)
+	return "x86";
+#else
+	return "unknown";
+#endif
+}
+
+
+inline int benchCompareR64(
+	const void* a,
+	const void* b)
+{
+	r64 x = *(const r64*)a, y = *(const r64*)b;
+	return (x < y ? -1 : (x > y ? 1 : 0));
+}
+
+
+inline BenchStats benchMeasure(
+	void (*pass)(),
+	u32 itemsPerPass,
+	const BenchConfig& config)
+{
+	BenchStats s{};
+	s.itemsPerPass = itemsPerPass;
+	s.samples = min(max(config.samples, (u32)1), (u32)BENCH_MAX_SAMPLES);
+
+	u64 start_nsec = monotonicNsec();
+	do {
+		pass();
+	} while (monotonicNsec() - start_nsec < config.warmupNsec);
+
+	u64 passes = 1;
+	for (;;) {
+		start_nsec = monotonicNsec();
+		for (u64 p = 0; p < passes; ++p) {
+			pass();
+		}
+		if (monotonicNsec() - start_nsec >= config.sampleNsec) {
+			break;
+		}
+		passes *= 2;
+	}
+	s.passesPerSample = passes;
+
+	r64 ns[BENCH_MAX_SAMPLES];
+	r64 ticks[BENCH_MAX_SAMPLES];
+	r64 items = (r64)passes * itemsPerPass;
+
+	for (u32 i = 0; i < s.samples; ++i) {
+		u64 startTicks = benchTicks();
+		start_nsec = monotonicNsec();
+		for (u64 p = 0; p < passes; ++p) {
+			pass();
+		}
+		ns[i] = (r64)(monotonicNsec() - start_nsec) / items;
+		ticks[i] = (r64)(benchTicks() - startTicks) / items;
+	}
+
+	qsort(ns, s.samples, sizeof(r64), benchCompareR64);
+	qsort(ticks, s.samples, sizeof(r64), benchCompareR64);
+
+	r64 sum = 0;
+	for (u32 i = 0; i < s.samples; ++i) {
+		sum += ns[i];
+	}
+	s.meanNs = sum / s.samples;
+
+	r64 var = 0;
+	for (u32 i = 0; i < s.samples; ++i) {
+		var += (ns[i] - s.meanNs) * (ns[i] - s.meanNs);
+	}
+	s.stddevNs = (s.samples > 1 ? sqrt(var / (s.samples - 1)) : 0);
+
+	s.minNs = ns[0];
+	s.maxNs = ns[s.samples - 1];
+	s.medianNs = (s.samples & 1 ? ns[s.samples / 2] : (ns[s.samples / 2 - 1] + ns[s.samples / 2]) * 0.5);
+	s.medianTicks = (s.samples & 1 ? ticks[s.samples / 2]
+									: (ticks[s.samples / 2 - 1] + ticks[s.samples / 2]) * 0.5);
+	return s;
+}
+
+
+/**
+ * One JSON document per run: the build it came from, so runs with different compilers, flags and
+ * targets can be told apart, then every result. buildFlags is whatever the Makefile passed in.
+ */
+inline void benchWriteJSON(
+	FILE* f,
+	const char* suite,
+	const char* backend,
+	const char* buildFlags,
+	const BenchResult* results,
+	u32 count)
+{
+	fprintf(f, "{\n");
+	fprintf(f, "  \"suite\": \"%s\",\n", suite);
+	fprintf(f, "  \"timestamp\": %lld,\n", (long long)time(nullptr));
+	fprintf(f, "  \"arch\": \"%s\",\n", benchArch());
+	fprintf(f, "  \"compiler\": \"%s\",\n", __VERSION__);
+	fprintf(f, "  \"flags\": \"%s\",\n", buildFlags);
+	fprintf(f, "  \"backend\": \"%s\",\n", backend);
+	fprintf(f, "  \"unit\": \"ns\",\n");
+	fprintf(f, "  \"results\": [\n");
+
+	for (u32 i = 0; i < count; ++i) {
+		const BenchResult& r = results[i];
+		const BenchStats& s = r.stats;
+		fprintf(f, "    { \"name\": \"%s\", ", r.name);
+		if (r.baseline != nullptr) {
+			fprintf(f, "\"baseline\": \"%s\", ", r.baseline);
+		}
+		else {
+			fprintf(f, "\"baseline\": null, ");
+		}
+		fprintf(f, "\"min\": %.3f, \"median\": %.3f, \"mean\": %.3f, \"stddev\": %.3f, \"max\": %.3f, "
+				"\"median_ticks\": %.2f, \"samples\": %u, \"items_per_sample\": %llu }%s\n",
+				s.minNs, s.medianNs, s.meanNs, s.stddevNs, s.maxNs, s.medianTicks, s.samples,
+				(unsigned long long)(s.passesPerSample * s.itemsPerPass), (i + 1 < count ? "," : ""));
+	}
+
+	fprintf(f, "  ]\n");
+	fprintf(f, "}\n");
+}
+
+#endif
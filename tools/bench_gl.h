@@ -0,0 +1,96 @@
+#ifndef _BENCH_GL_H
+#define _BENCH_GL_H
+
+#include <cstdio>
+#include <cstring>
+#include "utility/common.h"
+#include "GLES2/gl2.h"
+#include "EGL/egl.h"
+#include "EGL/eglext.h"
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA	0x31DD
+#endif
+
+/**
+ * Offscreen GLES2 context shared by the benchmarks in tools/, a size x size pbuffer on a
+ * surfaceless Mesa display when available, the default EGL display otherwise.
+ */
+bool initEGL(
+	u32 size)
+{
+	typedef EGLDisplay (EGLAPIENTRYP GetPlatformDisplayEXT)(EGLenum, void*, const EGLint*);
+
+	EGLDisplay display = EGL_NO_DISPLAY;
+	const char* clientExts = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	GetPlatformDisplayEXT getPlatformDisplay =
+		(GetPlatformDisplayEXT)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (clientExts && strstr(clientExts, "EGL_MESA_platform_surfaceless") && getPlatformDisplay) {
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+	if (display == EGL_NO_DISPLAY) {
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+		fprintf(stderr, "Could not initialize an EGL display\n");
+		return false;
+	}
+
+	const EGLint configAttributes[] = {
+		EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_DEPTH_SIZE, 16,
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+		EGL_NONE
+	};
+	const EGLint contextAttributes[] = { EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE };
+	const EGLint surfaceAttributes[] = { EGL_WIDTH, (EGLint)size, EGL_HEIGHT, (EGLint)size, EGL_NONE };
+
+	EGLConfig config;
+	EGLint numConfig = 0;
+	if (!eglChooseConfig(display, configAttributes, &config, 1, &numConfig) || numConfig == 0) {
+		fprintf(stderr, "No GLES2 pbuffer config\n");
+		return false;
+	}
+
+	eglBindAPI(EGL_OPENGL_ES_API);
+	EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+	EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+	if (context == EGL_NO_CONTEXT || surface == EGL_NO_SURFACE
+		|| !eglMakeCurrent(display, surface, surface, context))
+	{
+		fprintf(stderr, "Could not create a GLES2 context\n");
+		return false;
+	}
+
+	printf("%s, %s\n", (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION));
+	return true;
+}
+
+
+GLuint compileProgram(
+	const char* vsSource,
+	const char* fsSource)
+{
+	GLuint vs = glCreateShader(GL_VERTEX_SHADER);
+	GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(vs, 1, &vsSource, nullptr);
+	glShaderSource(fs, 1, &fsSource, nullptr);
+	glCompileShader(vs);
+	glCompileShader(fs);
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vs);
+	glAttachShader(program, fs);
+	glLinkProgram(program);
+
+	GLint status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE) {
+		char log[1024];
+		glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+		fprintf(stderr, "Program link failed:\n%s\n", log);
+		return 0;
+	}
+	return program;
+}
+
+#endif
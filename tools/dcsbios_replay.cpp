@@ -0,0 +1,183 @@
+/**
+ * Stand-in for DCS on the network: sends a DCS-BIOS export stream to the multicast group the
+ * display listens on (see dcsbios.h). Either replays a raw capture of the stream, split into one
+ * datagram per frame at the sync bytes, or synthesizes frames with a slow pitch/bank sweep.
+ *
+ *	dcsbios_replay.bin [-f capture.bin] [-r frames per second] [-a destination address] [-n frames]
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include "utility/common.h"
+#include "utility/clock.h"
+#include "dcsbios.h"
+
+
+#define DCSBIOS_END_OF_FRAME_ADDR	0xFFFE
+
+
+void putU16(
+	std::vector<u8>& out,
+	u16 v)
+{
+	out.push_back((u8)(v & 0xFF));
+	out.push_back((u8)(v >> 8));
+}
+
+
+void putWrite(
+	std::vector<u8>& out,
+	u16 address,
+	u16 value)
+{
+	putU16(out, address);
+	putU16(out, 2);	// byte count
+	putU16(out, value);
+}
+
+
+void makeSweepFrame(
+	std::vector<u8>& out,
+	u32 frame,
+	r32 fps)
+{
+	r32 t = (r32)frame / fps;
+
+	// pitch +/-30 degrees around level, bank +/-60 degrees, values as DCS-BIOS scales them
+	r32 pitch = 0.5f + (30.0f / 180.0f) * sinf(t * 0.4f);
+	r32 bank  = 0.5f + (60.0f / 360.0f) * sinf(t * 0.25f);
+	r32 turn  = 0.5f + 0.25f * sinf(t * 0.1f);
+
+	out.clear();
+	for (int i = 0; i < 4; ++i) {
+		out.push_back(0x55);
+	}
+	putWrite(out, DCSBIOS_ADI_PITCH_ADDR, (u16)(pitch * 65535.0f));
+	putWrite(out, DCSBIOS_ADI_BANK_ADDR,  (u16)(bank * 65535.0f));
+	putWrite(out, DCSBIOS_ADI_TURN_ADDR,  (u16)(turn * 65535.0f));
+	putWrite(out, DCSBIOS_END_OF_FRAME_ADDR, (u16)frame);
+}
+
+
+/**
+ * Split a raw stream capture into frames, each starting at a run of four sync bytes.
+ */
+void splitCapture(
+	const std::vector<u8>& capture,
+	std::vector<std::vector<u8>>& frames)
+{
+	size_t start = 0;
+	for (size_t i = 4; i + 4 <= capture.size(); ++i) {
+		if (capture[i] == 0x55 && capture[i+1] == 0x55 && capture[i+2] == 0x55 && capture[i+3] == 0x55) {
+			frames.emplace_back(capture.begin() + start, capture.begin() + i);
+			start = i;
+			i += 3;
+		}
+	}
+	if (start < capture.size()) {
+		frames.emplace_back(capture.begin() + start, capture.end());
+	}
+}
+
+
+int main(
+	int argc,
+	char** argv)
+{
+	const char* captureFile = nullptr;
+	const char* destAddr = DCSBIOS_MULTICAST_GROUP;
+	r32 fps = 30.0f;
+	u32 maxFrames = 0;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "f:r:a:n:")) != -1) {
+		switch (opt) {
+			case 'f': captureFile = optarg; break;
+			case 'r': fps = (r32)atof(optarg); break;
+			case 'a': destAddr = optarg; break;
+			case 'n': maxFrames = (u32)atoi(optarg); break;
+			default:
+				fprintf(stderr, "usage: %s [-f capture.bin] [-r fps] [-a address] [-n frames]\n", argv[0]);
+				return 1;
+		}
+	}
+	if (fps <= 0) {
+		fps = 30.0f;
+	}
+
+	std::vector<std::vector<u8>> captureFrames;
+	if (captureFile) {
+		FILE* f = fopen(captureFile, "rb");
+		if (!f) {
+			fprintf(stderr, "Could not open %s\n", captureFile);
+			return 1;
+		}
+		std::vector<u8> capture;
+		u8 buf[4096];
+		size_t n;
+		while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+			capture.insert(capture.end(), buf, buf + n);
+		}
+		fclose(f);
+
+		splitCapture(capture, captureFrames);
+		if (captureFrames.empty()) {
+			fprintf(stderr, "No frames in %s\n", captureFile);
+			return 1;
+		}
+		printf("Replaying %zu frames from %s\n", captureFrames.size(), captureFile);
+	}
+
+	int sock = socket(AF_INET, SOCK_DGRAM, 0);
+	if (sock < 0) {
+		perror("socket");
+		return 1;
+	}
+
+	u8 ttl = 1;
+	u8 loop = 1;
+	setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+	setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+
+	sockaddr_in dest{};
+	dest.sin_family = AF_INET;
+	dest.sin_addr.s_addr = inet_addr(destAddr);
+	dest.sin_port = htons(DCSBIOS_PORT);
+
+	printf("Sending to %s:%d at %.1f fps...\n", destAddr, DCSBIOS_PORT, fps);
+
+	std::vector<u8> frameBuf;
+	u64 period_nsec = (u64)(1000000000.0 / fps);
+	u64 next_nsec = monotonicNsec();
+
+	for(u32 frame = 0;
+		maxFrames == 0 || frame < maxFrames;
+		++frame)
+	{
+		const std::vector<u8>* data = &frameBuf;
+		if (captureFile) {
+			data = &captureFrames[frame % captureFrames.size()];
+		}
+		else {
+			makeSweepFrame(frameBuf, frame, fps);
+		}
+
+		if (sendto(sock, data->data(), data->size(), 0, (sockaddr*)&dest, sizeof(dest)) < 0) {
+			perror("sendto");
+		}
+
+		next_nsec += period_nsec;
+		u64 now_nsec = monotonicNsec();
+		if (next_nsec > now_nsec) {
+			usleep((useconds_t)((next_nsec - now_nsec) / 1000));
+		}
+	}
+
+	close(sock);
+	return 0;
+}
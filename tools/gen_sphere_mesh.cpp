@@ -0,0 +1,58 @@
+/**
+ * Build step: bakes the ADI ball mesh from sphere.h into static, read-only arrays so the display
+ * does no mesh math at startup and uploads straight from .rodata. Emits the finest level vertex
+ * grid, the index lists of every level back to back and a SphereLod table. Counts come from
+ * SPHERE_COLS/SPHERE_ROWS/SPHERE_LOD_LEVELS, pass the same -D values to the display build (see the
+ * Makefile).
+ *
+ *	gen_sphere_mesh.bin > sphere_mesh.h
+ */
+#include <cstdio>
+#include <cmath>
+#include <cassert>
+#include "utility/common.h"
+#include "sphere.h"
+
+
+int main()
+{
+	static SphereVertex verts[SPHERE_NUM_VERTS];
+	static u16 indexes[SPHERE_NUM_INDEXES];
+	makeSphereVertices(verts);
+	for (u32 level = 0; level < SPHERE_LOD_LEVELS; ++level) {
+		makeSphereIndexes(indexes + sphereLodFirstIndex(level), level);
+	}
+
+	printf("// ADI ball mesh, %u columns x %u rows, %u levels of detail\n"
+		   "// generated by tools/gen_sphere_mesh.cpp, do not edit\n\n"
+		   "static_assert(SPHERE_COLS == %u && SPHERE_ROWS == %u && SPHERE_LOD_LEVELS == %u,\n"
+		   "              \"sphere_mesh.h is stale, rebuild it\");\n\n",
+		   SPHERE_COLS, SPHERE_ROWS, SPHERE_LOD_LEVELS,
+		   SPHERE_COLS, SPHERE_ROWS, SPHERE_LOD_LEVELS);
+
+	printf("static const SphereVertex sphereMeshVerts[%u] = {\n", SPHERE_NUM_VERTS);
+	for (u32 v = 0; v < SPHERE_NUM_VERTS; ++v) {
+		const SphereVertex& sv = verts[v];
+		printf("\t{ %6d, %6d, %6d, 0, %5u, %5u },\n", sv.x, sv.y, sv.z, sv.s, sv.t);
+	}
+	printf("};\n\n");
+
+	printf("static const u16 sphereMeshIndexes[%u] = {", SPHERE_NUM_INDEXES);
+	for (u32 level = 0; level < SPHERE_LOD_LEVELS; ++level) {
+		SphereLod lod = sphereLod(level);
+		printf("\n\t// level %u, %u x %u", level, lod.cols, lod.rows);
+		for (u32 i = 0; i < lod.numIndexes; ++i) {
+			printf("%s%u,", (i % 16 == 0 ? "\n\t" : " "), indexes[lod.firstIndex + i]);
+		}
+	}
+	printf("\n};\n\n");
+
+	printf("static const SphereLod sphereMeshLods[%u] = {\n", SPHERE_LOD_LEVELS);
+	for (u32 level = 0; level < SPHERE_LOD_LEVELS; ++level) {
+		SphereLod lod = sphereLod(level);
+		printf("\t{ %5u, %5u, %3u, %3u },\n", lod.firstIndex, lod.numIndexes, lod.cols, lod.rows);
+	}
+	printf("};\n");
+
+	return 0;
+}
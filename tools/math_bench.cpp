@@ -0,0 +1,600 @@
+/**
+ * Microbenchmarks for the math library, run by make bench.
+ *
+ * check: runs every SIMD kernel (math/simd.h) and its *_scalar reference on the same random
+ * inputs, general matrices and modelview-like rotate/scale/translate ones, and compares the
+ * results bit for bit. Exits 1 on the first difference, so a backend or compiler flag that changes
+ * rounding fails the bench. Then sweeps the ball's attitude over the sphere, checking the
+ * quaternion against the rotate calls it replaced and slerpEase's paths, see checkAttitude.
+ *
+ * time: ns per call of each function over a working set that stays in L1, with the tools/bench.h
+ * harness. Covers the SIMD kernels against their references, the fast transforms against their
+ * _slow versions, the inverses, quaternion interpolation and conversions, the view and projection
+ * builders, the normal matrix chain, and the per-instrument transform chain against
+ * transformBatch (math/batch.h) called for 1, 4, 16 and all instruments at a time, with both
+ * normal matrix forms, and the view and projection with and without the camera cache. Prints a
+ * table, and with -j writes the results and the build they came from as JSON, - for stdout.
+ *
+ * Build with MATH_CFLAGS+=-DQMATH_SIMD_SCALAR for a scalar-only baseline, where the kernels and
+ * their references run the same code, and MATH_BENCH_CFLAGS for other optimization flags.
+ *
+ *	math_bench.bin [-n inputs] [-s samples] [-j results.json]
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include "utility/common.h"
+#include "math/qmath.h"
+#include "tools/bench.h"
+
+#ifndef BENCH_FLAGS
+#define BENCH_FLAGS				""
+#endif
+
+
+static u32 numInputs = 256;
+static u32 outHalf = 0;			// the check writes the references to the second half
+
+static mat4* ma;
+static mat4* mb;
+static vec4* va;
+static vec3* v3a;
+static vec3* v3b;
+static quat* qa;
+static quat* qb;
+static quat* qc;
+static quat* qd;
+static r32* sa;
+
+static mat4* outMat4;
+static mat3* outMat3;
+static vec4* outVec4;
+static quat* outQuat;
+
+static r32* angleZ;				// batch attitudes as the bank and pitch ballAttitude takes
+static r32* angleX;
+static TransformBatch batch;		// numInputs instruments
+static TransformBatch batchRef;		// same inputs, for transformBatch_scalar
+static mat4 batchView;
+static mat4 batchProj;
+
+
+r32 randomUnit()
+{
+	return (r32)rand() / (r32)RAND_MAX * 2.0f - 1.0f;
+}
+
+
+quat randomQuat()
+{
+	return normalize(quat{ randomUnit(), randomUnit(), randomUnit(), randomUnit() });
+}
+
+
+/**
+ * Even inputs are general matrices, odd ones are shaped like the ball's modelview
+ */
+void makeInputs()
+{
+	ma = (mat4*)malloc(sizeof(mat4) * numInputs);
+	mb = (mat4*)malloc(sizeof(mat4) * numInputs);
+	va = (vec4*)malloc(sizeof(vec4) * numInputs);
+	v3a = (vec3*)malloc(sizeof(vec3) * numInputs);
+	v3b = (vec3*)malloc(sizeof(vec3) * numInputs);
+	qa = (quat*)malloc(sizeof(quat) * numInputs);
+	qb = (quat*)malloc(sizeof(quat) * numInputs);
+	qc = (quat*)malloc(sizeof(quat) * numInputs);
+	qd = (quat*)malloc(sizeof(quat) * numInputs);
+	sa = (r32*)malloc(sizeof(r32) * numInputs);
+	outMat4 = (mat4*)malloc(sizeof(mat4) * numInputs * 2);
+	outMat3 = (mat3*)malloc(sizeof(mat3) * numInputs * 2);
+	outVec4 = (vec4*)malloc(sizeof(vec4) * numInputs * 2);
+	outQuat = (quat*)malloc(sizeof(quat) * numInputs * 2);
+
+	srand(1);
+	for (u32 i = 0; i < numInputs; ++i) {
+		mat4* m[2] = { &ma[i], &mb[i] };
+		for (u32 k = 0; k < 2; ++k) {
+			if (i & 1) {
+				vec3 axis{ randomUnit(), randomUnit(), randomUnit() + 2.0f };
+				mat4 t = translate(mat4{}, vec3{ randomUnit(), randomUnit(), randomUnit() * 10.0f });
+				t = rotate(t, randomUnit() * PIf, axis);
+				*m[k] = scale(t, vec3{ 0.5f + randomUnit() * 0.25f, 0.5f, 0.5f });
+			}
+			else {
+				for (u32 e = 0; e < 16; ++e) {
+					m[k]->E[e] = randomUnit();
+				}
+			}
+		}
+		va[i] = vec4{ randomUnit(), randomUnit(), randomUnit(), 1.0f };
+		v3a[i] = vec3{ randomUnit(), randomUnit(), randomUnit() + 2.0f };
+		v3b[i] = vec3{ randomUnit(), randomUnit(), randomUnit() - 2.0f };
+		qa[i] = randomQuat();
+		qb[i] = randomQuat();
+		qc[i] = randomQuat();
+		qd[i] = randomQuat();
+		sa[i] = randomUnit() * 0.5f + 0.5f;
+	}
+
+	angleZ = (r32*)malloc(sizeof(r32) * numInputs);
+	angleX = (r32*)malloc(sizeof(r32) * numInputs);
+	initTransformBatch(batch, numInputs, malloc(transformBatchBytes(numInputs)));
+	initTransformBatch(batchRef, numInputs, malloc(transformBatchBytes(numInputs)));
+	for (u32 i = 0; i < numInputs; ++i) {
+		angleZ[i] = randomUnit() * PIf;
+		angleX[i] = randomUnit() * PIf;
+		quat q = angleAxis(angleZ[i], vec3{ 0, 0, 1.0f }) * angleAxis(angleX[i], vec3{ 1.0f, 0, 0 });
+		for (u32 e = 0; e < 4; ++e) {
+			batch.rotation[e][i] = batchRef.rotation[e][i] = q.E[e];
+		}
+		batch.scale[i] = batchRef.scale[i] = sa[i] + 0.5f;
+	}
+	batchView = lookAtRH(vec3{ 0, 20.0f, 100.0f }, vec3{ 0, 0, 0 }, vec3{ 0, 1.0f, 0 });
+	batchProj = orthoRH(-1.68f, 1.68f, -2.24f, 2.24f, 0, 200.0f);
+}
+
+
+/**
+ * One pass over the inputs writing to out, the call is inlined into the loop when the compiler
+ * chooses to so the timings are not all call overhead
+ */
+#define BENCH_LOOP(name, Out, outArray, expr) \
+	void name() { \
+		Out* out = outArray + outHalf * numInputs; \
+		for (u32 i = 0; i < numInputs; ++i) { out[i] = (expr); } \
+	}
+
+BENCH_LOOP(mulMat4,					mat4, outMat4, ma[i] * mb[i])
+BENCH_LOOP(mulMat4_scalar,			mat4, outMat4, multiply_scalar(ma[i], mb[i]))
+BENCH_LOOP(mulMat4Vec4,				vec4, outVec4, ma[i] * va[i])
+BENCH_LOOP(mulMat4Vec4_scalar,		vec4, outVec4, multiply_scalar(ma[i], va[i]))
+BENCH_LOOP(mulVec4Mat4,				vec4, outVec4, va[i] * ma[i])
+BENCH_LOOP(mulVec4Mat4_scalar,		vec4, outVec4, multiply_scalar(va[i], ma[i]))
+BENCH_LOOP(transposeMat4,			mat4, outMat4, transpose(ma[i]))
+BENCH_LOOP(transposeMat4_scalar,	mat4, outMat4, transpose_scalar(ma[i]))
+BENCH_LOOP(inverseMat4,				mat4, outMat4, inverse(ma[i]))
+BENCH_LOOP(inverseMat4_scalar,		mat4, outMat4, inverse_scalar(ma[i]))
+BENCH_LOOP(mulQuat,					quat, outQuat, qa[i] * qb[i])
+BENCH_LOOP(mulQuat_scalar,			quat, outQuat, multiply_scalar(qa[i], qb[i]))
+
+BENCH_LOOP(rotateMat4,				mat4, outMat4, rotate(ma[i], sa[i] * PIf, v3a[i]))
+BENCH_LOOP(rotateMat4_slow,			mat4, outMat4, rotate_slow(ma[i], sa[i] * PIf, v3a[i]))
+BENCH_LOOP(scaleMat4,				mat4, outMat4, scale(ma[i], v3a[i]))
+BENCH_LOOP(scaleMat4_slow,			mat4, outMat4, scale_slow(ma[i], v3a[i]))
+BENCH_LOOP(affineInverseMat4,		mat4, outMat4, affineInverse(ma[i | 1]))
+BENCH_LOOP(slerpQuat,				quat, outQuat, slerp(qa[i], qb[i], sa[i]))
+BENCH_LOOP(nlerpQuat,				quat, outQuat, nlerp(qa[i], qb[i], sa[i]))
+BENCH_LOOP(squadQuat,				quat, outQuat, squad(qa[i], qb[i], qc[i], qd[i], sa[i]))
+BENCH_LOOP(quatCast,				quat, outQuat, quat_cast(ma[i | 1]))
+BENCH_LOOP(mat4Cast,				mat4, outMat4, mat4_cast(qa[i]))
+BENCH_LOOP(lookAt,					mat4, outMat4, lookAtRH(v3a[i], v3b[i], vec3{ 0.0f, 1.0f, 0.0f }))
+BENCH_LOOP(orthoProjection,			mat4, outMat4, orthoRH(-sa[i], sa[i], -1.0f, 1.0f, 0.1f, 10.0f + sa[i]))
+BENCH_LOOP(normalMatrix,			mat3, outMat3, transpose(inverse(make_mat3(ma[i]))))
+
+
+/**
+ * The batch's attitudes one instrument at a time the way ballTransform built them before the
+ * batch, from bank and pitch: rotate, rotate, scale, view * model, projection * modelView and the
+ * normal matrix chain.
+ */
+void transformChain()
+{
+	for (u32 i = 0; i < numInputs; ++i) {
+		mat4 model = rotate(mat4{}, angleZ[i], vec3{ 0, 0, 1.0f });
+		model = rotate(model, angleX[i], vec3{ 1.0f, 0, 0 });
+		model = scale(model, vec3{ batch.scale[i], batch.scale[i], batch.scale[i] });
+		mat4 modelView = batchView * model;
+		outMat4[i] = modelView;
+		outMat4[numInputs + i] = batchProj * modelView;
+		outMat3[i] = transpose(inverse(make_mat3(modelView)));
+	}
+}
+
+
+/**
+ * All of the batch in calls of size instruments, a multiple of TRANSFORM_BATCH_LANES so every
+ * slice keeps its padding inside the batch, showing the per-call setup at small sizes
+ */
+void transformBatchSlices(
+	u32 size)
+{
+	for (u32 first = 0; first < numInputs; first += size) {
+		TransformBatch slice = batch;
+		slice.count = min(size, numInputs - first);
+		slice.stride = transformBatchStride(slice.count);
+		for (u32 e = 0; e < 4; ++e) {
+			slice.rotation[e] += first;
+		}
+		slice.scale += first;
+		for (u32 e = 0; e < 16; ++e) {
+			slice.modelView[e] += first;
+			slice.modelViewProj[e] += first;
+		}
+		for (u32 e = 0; e < 9; ++e) {
+			slice.normal[e] += first;
+		}
+		transformBatch(slice, batchView, batchProj);
+	}
+}
+
+
+/**
+ * Each instrument through a batch of one, the way ballTransform drives the ball: angles in, one
+ * call, matrices gathered out
+ */
+void transformBatch1()
+{
+	static TransformBatch single;
+	static r32 memory[TRANSFORM_BATCH_LANES * TRANSFORM_BATCH_ARRAYS];
+	if (single.stride == 0) {
+		initTransformBatch(single, 1, memory);
+	}
+	for (u32 i = 0; i < numInputs; ++i) {
+		for (u32 e = 0; e < 4; ++e) {
+			single.rotation[e][0] = batch.rotation[e][i];
+		}
+		single.scale[0] = batch.scale[i];
+		transformBatch(single, batchView, batchProj);
+		outMat4[i] = batchModelView(single, 0);
+		outMat4[numInputs + i] = batchModelViewProj(single, 0);
+		outMat3[i] = batchNormal(single, 0);
+	}
+}
+
+void transformBatch4()			{ transformBatchSlices(4); }
+void transformBatch16()			{ transformBatchSlices(16); }
+void transformBatchAll()		{ transformBatch(batch, batchView, batchProj); }
+void transformBatchAll_scalar()	{ transformBatch_scalar(batch, batchView, batchProj); }
+
+void transformBatchRigid()
+{
+	batch.rigidView = true;
+	transformBatch(batch, batchView, batchProj);
+	batch.rigidView = false;
+}
+
+
+/**
+ * The view and projection ballTransform asks for every frame, through the cache
+ */
+void cameraCached()
+{
+	static CameraCache camera;
+	for (u32 i = 0; i < numInputs; ++i) {
+		outMat4[i] = cameraLookAtRH(camera, vec3{ 0, 20.0f, 100.0f }, vec3{ 0, 0, 0 },
+									vec3{ 0, 1.0f, 0 });
+		outMat4[numInputs + i] = cameraOrthoRH(camera, -1.68f, 1.68f, -2.24f, 2.24f, 0, 200.0f);
+	}
+}
+
+
+void cameraUncached()
+{
+	for (u32 i = 0; i < numInputs; ++i) {
+		outMat4[i] = lookAtRH(vec3{ 0, 20.0f, 100.0f }, vec3{ 0, 0, 0 }, vec3{ 0, 1.0f, 0 });
+		outMat4[numInputs + i] = orthoRH(-1.68f, 1.68f, -2.24f, 2.24f, 0, 200.0f);
+	}
+}
+
+
+/**
+ * A SIMD kernel and the scalar function it must match
+ */
+struct CheckPair {
+	const char*	name;
+	void		(*simd)();
+	void		(*scalar)();
+	void**		out;
+	size_t		outSize;
+};
+
+static CheckPair checks[] = {
+	{ "mat4 * mat4",	mulMat4,		mulMat4_scalar,			(void**)&outMat4, sizeof(mat4) },
+	{ "mat4 * vec4",	mulMat4Vec4,	mulMat4Vec4_scalar,		(void**)&outVec4, sizeof(vec4) },
+	{ "vec4 * mat4",	mulVec4Mat4,	mulVec4Mat4_scalar,		(void**)&outVec4, sizeof(vec4) },
+	{ "transpose",		transposeMat4,	transposeMat4_scalar,	(void**)&outMat4, sizeof(mat4) },
+	{ "inverse",		inverseMat4,	inverseMat4_scalar,		(void**)&outMat4, sizeof(mat4) },
+	{ "quat * quat",	mulQuat,		mulQuat_scalar,			(void**)&outQuat, sizeof(quat) }
+};
+
+
+struct Bench {
+	const char*	name;
+	void		(*pass)();
+	const char*	baseline;		// the table shows baseline time / this time
+};
+
+static Bench benches[] = {
+	{ "mat4 * mat4",			mulMat4,				"mat4 * mat4 scalar" },
+	{ "mat4 * mat4 scalar",		mulMat4_scalar,			nullptr },
+	{ "mat4 * vec4",			mulMat4Vec4,			"mat4 * vec4 scalar" },
+	{ "mat4 * vec4 scalar",		mulMat4Vec4_scalar,		nullptr },
+	{ "vec4 * mat4",			mulVec4Mat4,			"vec4 * mat4 scalar" },
+	{ "vec4 * mat4 scalar",		mulVec4Mat4_scalar,		nullptr },
+	{ "transpose",				transposeMat4,			"transpose scalar" },
+	{ "transpose scalar",		transposeMat4_scalar,	nullptr },
+	{ "inverse",				inverseMat4,			"inverse scalar" },
+	{ "inverse scalar",			inverseMat4_scalar,		nullptr },
+	{ "quat * quat",			mulQuat,				"quat * quat scalar" },
+	{ "quat * quat scalar",		mulQuat_scalar,			nullptr },
+	{ "rotate",					rotateMat4,				"rotate_slow" },
+	{ "rotate_slow",			rotateMat4_slow,		nullptr },
+	{ "scale",					scaleMat4,				"scale_slow" },
+	{ "scale_slow",				scaleMat4_slow,			nullptr },
+	{ "affineInverse",			affineInverseMat4,		"inverse" },
+	{ "slerp",					slerpQuat,				nullptr },
+	{ "nlerp",					nlerpQuat,				"slerp" },
+	{ "squad",					squadQuat,				nullptr },
+	{ "quat_cast",				quatCast,				nullptr },
+	{ "mat4_cast",				mat4Cast,				nullptr },
+	{ "lookAtRH",				lookAt,					nullptr },
+	{ "orthoRH",				orthoProjection,		nullptr },
+	{ "normal matrix",			normalMatrix,			nullptr },
+	{ "transform chain",		transformChain,			nullptr },
+	{ "transform batch 1",		transformBatch1,		"transform chain" },
+	{ "transform batch 4",		transformBatch4,		"transform chain" },
+	{ "transform batch 16",		transformBatch16,		"transform chain" },
+	{ "transform batch all",	transformBatchAll,		"transform chain" },
+	{ "transform batch scalar",	transformBatchAll_scalar,	"transform chain" },
+	{ "transform batch rigid",	transformBatchRigid,	"transform batch all" },
+	{ "camera uncached",		cameraUncached,			nullptr },
+	{ "camera cached",			cameraCached,			"camera uncached" }
+};
+
+
+/**
+ * Runs both versions of each kernel into the two halves of its output array and compares them.
+ */
+bool checkKernels(
+	FILE* table)
+{
+	for (u32 k = 0; k < Q_countof(checks); ++k) {
+		const CheckPair& c = checks[k];
+		outHalf = 0;
+		c.simd();
+		outHalf = 1;
+		c.scalar();
+		outHalf = 0;
+
+		const u8* simdOut = (const u8*)*c.out;
+		const u8* scalarOut = simdOut + c.outSize * numInputs;
+		for (u32 i = 0; i < numInputs; ++i) {
+			if (memcmp(simdOut + c.outSize * i, scalarOut + c.outSize * i, c.outSize) != 0) {
+				fprintf(stderr, "check: %s differs from its scalar reference at input %u\n", c.name, i);
+				const r32* a = (const r32*)(simdOut + c.outSize * i);
+				const r32* b = (const r32*)(scalarOut + c.outSize * i);
+				for (u32 e = 0; e < c.outSize / sizeof(r32); ++e) {
+					fprintf(stderr, "  [%2u] %.9g %.9g\n", e, a[e], b[e]);
+				}
+				return false;
+			}
+		}
+	}
+
+	// an odd count too, so the lone instrument after the last SIMD group is covered, and both
+	// normal matrix forms
+	for (u32 run = 0; run < 4; ++run) {
+		u32 count = numInputs - 1 + (run & 1);
+		batch.count = batchRef.count = count;
+		batch.rigidView = batchRef.rigidView = (run >= 2);
+		transformBatch(batch, batchView, batchProj);
+		transformBatch_scalar(batchRef, batchView, batchProj);
+		for (u32 e = 0; e < 16 + 16 + 9; ++e) {
+			const r32* a = (e < 16 ? batch.modelView[e]
+							: (e < 32 ? batch.modelViewProj[e - 16] : batch.normal[e - 32]));
+			const r32* b = (e < 16 ? batchRef.modelView[e]
+							: (e < 32 ? batchRef.modelViewProj[e - 16] : batchRef.normal[e - 32]));
+			for (u32 i = 0; i < count; ++i) {
+				if (memcmp(&a[i], &b[i], sizeof(r32)) != 0) {
+					fprintf(stderr, "check: transformBatch differs from its scalar reference at "
+							"instrument %u of %u, output %u%s: %.9g %.9g\n", i, count, e,
+							(batch.rigidView ? ", rigid view" : ""), a[i], b[i]);
+					return false;
+				}
+			}
+		}
+	}
+
+	fprintf(table, "check: %u kernels bit identical to their scalar references over %u inputs\n",
+			(u32)Q_countof(checks) + 1, numInputs);
+	return true;
+}
+
+
+/**
+ * Rotation angle between two attitudes, either sign of either quaternion
+ */
+r32 attitudeAngle(
+	const quat& a,
+	const quat& b)
+{
+	return 2.0f * acosf(min((r32)fabs(dot(a, b)), 1.0f));
+}
+
+
+/**
+ * Sweeps bank and pitch over the whole sphere. Every attitude built as bank about z then pitch
+ * about x must give the matrix the two rotate calls do. Easing between pairs of attitudes with
+ * slerpEase must reach the target exactly, never move away from it, stay on the shortest arc
+ * (angle covered plus angle left equals the angle between the ends, so no detour through the
+ * poles) and not depend on the step size. Tolerances are the acosf resolution near 1.
+ */
+bool checkAttitude(
+	FILE* table)
+{
+	const vec3 zAxis{ 0, 0, 1.0f };
+	const vec3 xAxis{ 1.0f, 0, 0 };
+	const r32 matrixTolerance = 0.00001f;
+	const r32 angleTolerance = 0.002f;
+	const u32 maxSteps = 200;
+
+	u32 attitudes = 0;
+	for (s32 b = -24; b <= 24; ++b) {
+		for (s32 p = -24; p <= 24; ++p) {
+			r32 bank = (r32)b * 7.5f * DEG_TO_RADf, pitch = (r32)p * 7.5f * DEG_TO_RADf;
+			mat4 fromQuat = mat4_cast(angleAxis(bank, zAxis) * angleAxis(pitch, xAxis));
+			mat4 fromRotate = rotate(rotate(mat4{}, bank, zAxis), pitch, xAxis);
+			for (u32 e = 0; e < 16; ++e) {
+				if (fabs(fromQuat.E[e] - fromRotate.E[e]) > matrixTolerance) {
+					fprintf(stderr, "check: attitude bank %.1f pitch %.1f element %u is %.9g, rotate gives "
+							"%.9g\n", bank * RAD_TO_DEGf, pitch * RAD_TO_DEGf, e, fromQuat.E[e],
+							fromRotate.E[e]);
+					return false;
+				}
+			}
+			++attitudes;
+		}
+	}
+
+	u32 paths = 0, longest = 0;
+	for (s32 b0 = -12; b0 <= 12; ++b0) {
+		for (s32 p0 = -12; p0 <= 12; ++p0) {
+			quat start = angleAxis((r32)b0 * 15.0f * DEG_TO_RADf, zAxis)
+						 * angleAxis((r32)p0 * 15.0f * DEG_TO_RADf, xAxis);
+
+			for (s32 b1 = -4; b1 <= 4; ++b1) {
+				for (s32 p1 = -4; p1 <= 4; ++p1) {
+					quat target = angleAxis((r32)b1 * 45.0f * DEG_TO_RADf, zAxis)
+								  * angleAxis((r32)p1 * 45.0f * DEG_TO_RADf, xAxis);
+					r32 total = attitudeAngle(start, target);
+
+					r32 oneStep = attitudeAngle(slerpEase(start, target, 0.25f, 2.0f),
+						slerpEase(slerpEase(start, target, 0.25f, 1.0f), target, 0.25f, 1.0f));
+					if (oneStep > angleTolerance) {
+						fprintf(stderr, "check: easing from bank %d pitch %d to bank %d pitch %d by 2 "
+								"steps is %.9g rad from 2 steps of 1\n",
+								b0 * 15, p0 * 15, b1 * 45, p1 * 45, oneStep);
+						return false;
+					}
+
+					quat q = start;
+					r32 left = total;
+					u32 steps = 0;
+					while (memcmp(&q, &target, sizeof(quat)) != 0 && steps < maxSteps) {
+						q = slerpEase(q, target, 0.25f, 1.0f);
+						r32 newLeft = attitudeAngle(q, target);
+						r32 covered = attitudeAngle(start, q);
+						if (newLeft > left + angleTolerance
+							|| fabs(covered + newLeft - total) > angleTolerance)
+						{
+							fprintf(stderr, "check: easing from bank %d pitch %d to bank %d pitch %d left "
+									"the shortest arc at step %u, %.9g rad covered, %.9g left of "
+									"%.9g\n", b0 * 15, p0 * 15, b1 * 45, p1 * 45, steps, covered,
+									newLeft, total);
+							return false;
+						}
+						left = newLeft;
+						++steps;
+					}
+					if (steps == maxSteps) {
+						fprintf(stderr, "check: easing from bank %d pitch %d to bank %d pitch %d did not "
+								"converge in %u steps\n", b0 * 15, p0 * 15, b1 * 45, p1 * 45,
+								maxSteps);
+						return false;
+					}
+					longest = max(longest, steps);
+					++paths;
+				}
+			}
+		}
+	}
+
+	fprintf(table, "check: %u attitudes match rotate, %u eased paths on the shortest arc, converged "
+			"in at most %u steps\n", attitudes, paths, longest);
+	return true;
+}
+
+
+const BenchResult* findResult(
+	const BenchResult* results,
+	u32 count,
+	const char* name)
+{
+	for (u32 i = 0; i < count; ++i) {
+		if (strcmp(results[i].name, name) == 0) {
+			return &results[i];
+		}
+	}
+	return nullptr;
+}
+
+
+int main(
+	int argc,
+	char** argv)
+{
+	BenchConfig config{ 20000000, 1000000, 21 };	// 20ms warmup, 1ms samples
+	const char* jsonFilename = nullptr;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "n:s:j:")) != -1) {
+		switch (opt) {
+			case 'n': numInputs = (u32)atoi(optarg); break;
+			case 's': config.samples = (u32)atoi(optarg); break;
+			case 'j': jsonFilename = optarg; break;
+			default:
+				fprintf(stderr, "usage: %s [-n inputs] [-s samples] [-j results.json]\n", argv[0]);
+				return 1;
+		}
+	}
+	if (numInputs < 2 || config.samples == 0 || config.samples > BENCH_MAX_SAMPLES) {
+		fprintf(stderr, "-n must be above 1, -s from 1 to %u\n", BENCH_MAX_SAMPLES);
+		return 1;
+	}
+
+	numInputs = (numInputs + 1) & ~1u;	// odd inputs are the modelview-like ones, keep both kinds
+
+	// json on stdout stays parseable, the table goes to stderr
+	FILE* table = (jsonFilename && strcmp(jsonFilename, "-") == 0 ? stderr : stdout);
+
+	makeInputs();
+
+	fprintf(table, "math: %s backend, %s, %u inputs, %u samples\n",
+			QMATH_SIMD_NAME, benchArch(), numInputs, config.samples);
+	if (!checkKernels(table) || !checkAttitude(table)) {
+		return 1;
+	}
+
+	const u32 count = Q_countof(benches);
+	BenchResult results[Q_countof(benches)];
+	for (u32 b = 0; b < count; ++b) {
+		results[b].name = benches[b].name;
+		results[b].baseline = benches[b].baseline;
+		results[b].stats = benchMeasure(benches[b].pass, numInputs, config);
+	}
+
+	fprintf(table, "  function                median ns     min ns  stddev  vs baseline\n");
+	for (u32 b = 0; b < count; ++b) {
+		const BenchStats& s = results[b].stats;
+		fprintf(table, "  %-22s  %9.2f  %9.2f  %5.1f%%", results[b].name, s.medianNs, s.minNs,
+				s.stddevNs / s.meanNs * 100.0);
+
+		const BenchResult* base = (results[b].baseline ? findResult(results, count, results[b].baseline)
+													   : nullptr);
+		if (base != nullptr) {
+			fprintf(table, "  %6.2fx %s", base->stats.medianNs / s.medianNs, base->name);
+		}
+		fprintf(table, "\n");
+	}
+
+	if (jsonFilename != nullptr) {
+		bool toStdout = (strcmp(jsonFilename, "-") == 0);
+		FILE* f = (toStdout ? stdout : fopen(jsonFilename, "w"));
+		if (f == nullptr) {
+			fprintf(stderr, "could not write %s\n", jsonFilename);
+			return 1;
+		}
+		benchWriteJSON(f, "qmath", QMATH_SIMD_NAME, BENCH_FLAGS, results, count);
+		if (!toStdout && fclose(f) != 0) {
+			fprintf(stderr, "could not write %s\n", jsonFilename);
+			return 1;
+		}
+		if (!toStdout) {
+			fprintf(table, "results written to %s\n", jsonFilename);
+		}
+	}
+
+	return 0;
+}
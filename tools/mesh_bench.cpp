@@ -0,0 +1,380 @@
+/**
+ * Benchmarks for the ADI ball mesh, drawn into an offscreen pbuffer.
+ *
+ * layout: draws the sphere many times per frame with two vertex layouts and reports GPU time per
+ * frame for each
+ *	soa		three float streams, position + normal + uv, 32 bytes per vertex (the original layout)
+ *	packed	one interleaved SphereVertex stream, snorm16 position + unorm16 uv, 12 bytes per vertex,
+ *			normal derived from position in the vertex shader (the current layout)
+ *
+ * lod: for every level of detail in sphere.h, vertex throughput with the packed layout against
+ * visual error, both the predicted facet error (sphereLodError) and the measured pixel difference
+ * from the finest level when one ball of the -r radius is drawn
+ *
+ * Runs on any EGL + GLES2 driver, including Mesa llvmpipe on a non-Pi Linux box. A software
+ * rasterizer has no vertex fetch bandwidth limit like the VideoCore does, so treat its timings as
+ * relative and run it on the Pi for the real numbers.
+ *
+ *	mesh_bench.bin [-m layout|lod] [-n draws per frame] [-f frames] [-s viewport size]
+ *	               [-l level for layout mode] [-r ball radius px for lod mode]
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+#include <cassert>
+#include <unistd.h>
+#include "utility/common.h"
+#include "utility/clock.h"
+#include "sphere.h"
+#include "tools/bench_gl.h"
+
+
+struct Layout {
+	const char*	name;
+	GLuint		program;
+	GLuint		vertexBuffer;
+	GLint		attrPosition;
+	GLint		attrNormal;		// -1 for the packed layout
+	GLint		attrUV;
+	GLint		unifTransform;
+	u32			vertexBytes;
+};
+
+
+// transform.xy is the offset, transform.z the scale, both in clip space
+const char* soaVertexShader =
+	"#version 100\n"
+	"uniform vec3 transform;"
+	"attribute vec3 vertexPosition;"
+	"attribute vec3 vertexNormal;"
+	"attribute vec2 vertexUV;"
+	"varying vec3 color;"
+	"void main() {"
+		"color = vertexNormal * 0.5 + vec3(vertexUV, 0.0) * 0.5;"
+		"gl_Position = vec4(vertexPosition.xy * transform.z + transform.xy, vertexPosition.z * 0.1, 1.0);"
+	"}";
+
+const char* packedVertexShader =
+	"#version 100\n"
+	"uniform vec3 transform;"
+	"attribute vec3 vertexPosition;"
+	"attribute vec2 vertexUV;"
+	"varying vec3 color;"
+	"void main() {"
+		"color = vertexPosition * 0.5 + vec3(vertexUV, 0.0) * 0.5;"
+		"gl_Position = vec4(vertexPosition.xy * transform.z + transform.xy, vertexPosition.z * 0.1, 1.0);"
+	"}";
+
+const char* fragmentShader =
+	"#version 100\n"
+	"precision mediump float;"
+	"varying vec3 color;"
+	"void main() {"
+		"gl_FragColor = vec4(color, 1.0);"
+	"}";
+
+
+void makeSoALayout(
+	Layout& l)
+{
+	// the original makeARU2BA buffer: all positions, then all normals, then all uvs
+	r32* data = (r32*)malloc(sizeof(r32) * 8 * SPHERE_NUM_VERTS);
+	vec3* positions = (vec3*)data;
+	vec3* normals = positions + SPHERE_NUM_VERTS;
+	vec2* uvs = (vec2*)(normals + SPHERE_NUM_VERTS);
+
+	u32 v = 0;
+	for (u32 c = 0; c <= SPHERE_COLS; ++c) {
+		for (u32 r = 0; r <= SPHERE_ROWS; ++r, ++v) {
+			sphereVertex(c, r, normals[v], uvs[v]);
+			positions[v] = normals[v];
+		}
+	}
+
+	l.name = "soa float";
+	l.vertexBytes = sizeof(r32) * 8;
+	l.program = compileProgram(soaVertexShader, fragmentShader);
+	l.attrPosition = glGetAttribLocation(l.program, "vertexPosition");
+	l.attrNormal = glGetAttribLocation(l.program, "vertexNormal");
+	l.attrUV = glGetAttribLocation(l.program, "vertexUV");
+	l.unifTransform = glGetUniformLocation(l.program, "transform");
+
+	glGenBuffers(1, &l.vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, l.vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(r32) * 8 * SPHERE_NUM_VERTS, data, GL_STATIC_DRAW);
+	free(data);
+}
+
+
+void makePackedLayout(
+	Layout& l)
+{
+	SphereVertex* verts = (SphereVertex*)malloc(sizeof(SphereVertex) * SPHERE_NUM_VERTS);
+	makeSphereVertices(verts);
+
+	l.name = "packed aos";
+	l.vertexBytes = sizeof(SphereVertex);
+	l.program = compileProgram(packedVertexShader, fragmentShader);
+	l.attrPosition = glGetAttribLocation(l.program, "vertexPosition");
+	l.attrNormal = -1;
+	l.attrUV = glGetAttribLocation(l.program, "vertexUV");
+	l.unifTransform = glGetUniformLocation(l.program, "transform");
+
+	glGenBuffers(1, &l.vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, l.vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(SphereVertex) * SPHERE_NUM_VERTS, verts, GL_STATIC_DRAW);
+	free(verts);
+}
+
+
+void bindLayout(
+	const Layout& l)
+{
+	glUseProgram(l.program);
+	glBindBuffer(GL_ARRAY_BUFFER, l.vertexBuffer);
+	glEnableVertexAttribArray(l.attrPosition);
+	glEnableVertexAttribArray(l.attrUV);
+
+	if (l.attrNormal >= 0) {
+		glEnableVertexAttribArray(l.attrNormal);
+		glVertexAttribPointer(l.attrPosition, 3, GL_FLOAT, GL_FALSE, 0, (const GLvoid*)0);
+		glVertexAttribPointer(l.attrNormal, 3, GL_FLOAT, GL_FALSE, 0,
+							  (const GLvoid*)(sizeof(vec3) * SPHERE_NUM_VERTS));
+		glVertexAttribPointer(l.attrUV, 2, GL_FLOAT, GL_FALSE, 0,
+							  (const GLvoid*)(sizeof(vec3) * 2 * SPHERE_NUM_VERTS));
+	}
+	else {
+		glVertexAttribPointer(l.attrPosition, 3, GL_SHORT, GL_TRUE, sizeof(SphereVertex),
+							  (const GLvoid*)offsetof(SphereVertex, x));
+		glVertexAttribPointer(l.attrUV, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(SphereVertex),
+							  (const GLvoid*)offsetof(SphereVertex, s));
+	}
+}
+
+
+void unbindLayout(
+	const Layout& l)
+{
+	glDisableVertexAttribArray(l.attrPosition);
+	glDisableVertexAttribArray(l.attrUV);
+	if (l.attrNormal >= 0) {
+		glDisableVertexAttribArray(l.attrNormal);
+	}
+}
+
+
+void drawLod(
+	const SphereLod& lod)
+{
+	glDrawElements(GL_TRIANGLE_STRIP, lod.numIndexes, GL_UNSIGNED_SHORT,
+				   (const GLvoid*)(sizeof(u16) * lod.firstIndex));
+}
+
+
+/**
+ * Returns mean milliseconds per frame of drawsPerFrame small spheres, each frame finished with
+ * glFinish so GPU time is included. The layout must be bound.
+ */
+r64 timeDraws(
+	const Layout& l,
+	const SphereLod& lod,
+	u32 drawsPerFrame,
+	u32 frames)
+{
+	u64 start_nsec = 0;
+	for (u32 f = 0; f < frames + 1; ++f) {
+		if (f == 1) {
+			start_nsec = monotonicNsec();	// frame 0 is warmup
+		}
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		for (u32 d = 0; d < drawsPerFrame; ++d) {
+			r32 x = (r32)(d % 7) * 0.25f - 0.75f;
+			r32 y = (r32)((d / 7) % 7) * 0.25f - 0.75f;
+			glUniform3f(l.unifTransform, x, y, 0.25f);
+			drawLod(lod);
+		}
+		glFinish();
+	}
+	return (r64)(monotonicNsec() - start_nsec) * 1e-6 / frames;
+}
+
+
+u32 lodNumVerts(
+	const SphereLod& lod)
+{
+	return (lod.cols + 1) * (lod.rows + 1);
+}
+
+
+void runLayoutBench(
+	Layout* layouts,
+	u32 level,
+	u32 drawsPerFrame,
+	u32 frames)
+{
+	SphereLod lod = sphereLod(level);
+	printf("layout: level %u, %u verts, %u indexes, %u draws per frame, %u frames\n",
+		   level, lodNumVerts(lod), lod.numIndexes, drawsPerFrame, frames);
+
+	// interleave the runs so clock and thermal drift hit both layouts alike
+	r64 totalMs[2] = {};
+	const u32 rounds = 3;
+	for (u32 round = 0; round < rounds; ++round) {
+		for (u32 i = 0; i < 2; ++i) {
+			bindLayout(layouts[i]);
+			totalMs[i] += timeDraws(layouts[i], lod, drawsPerFrame, frames);
+			unbindLayout(layouts[i]);
+		}
+	}
+
+	for (u32 i = 0; i < 2; ++i) {
+		r64 ms = totalMs[i] / rounds;
+		r64 mbPerFrame = (r64)layouts[i].vertexBytes * lodNumVerts(lod) * drawsPerFrame / (1024.0 * 1024.0);
+		printf("  %-12s %2u bytes/vertex  %8.3f ms/frame  %6.2f MB vertex data/frame\n",
+			   layouts[i].name, layouts[i].vertexBytes, ms, mbPerFrame);
+	}
+	printf("  packed/soa time ratio %.3f\n", totalMs[1] / totalMs[0]);
+}
+
+
+/**
+ * Draw one centered ball of radius_px and read it back as RGBA.
+ */
+void renderBall(
+	const Layout& l,
+	const SphereLod& lod,
+	u32 size,
+	r32 radius_px,
+	u8* pixels)
+{
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glUniform3f(l.unifTransform, 0, 0, radius_px * 2.0f / (r32)size);
+	drawLod(lod);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+}
+
+
+void runLodBench(
+	const Layout& l,
+	u32 size,
+	r32 radius_px,
+	u32 drawsPerFrame,
+	u32 frames)
+{
+	printf("lod: %u levels, %u draws per frame, %u frames, error measured at radius %.0f px\n",
+		   SPHERE_LOD_LEVELS, drawsPerFrame, frames, radius_px);
+	printf("  level   grid     verts  indexes   ms/frame  Mverts/s  facet err px  pixels off  mean abs diff\n");
+
+	u32 numPixels = size * size;
+	u8* reference = (u8*)malloc(numPixels * 4);
+	u8* pixels = (u8*)malloc(numPixels * 4);
+
+	bindLayout(l);
+	renderBall(l, sphereLod(0), size, radius_px, reference);
+
+	for (u32 level = 0; level < SPHERE_LOD_LEVELS; ++level) {
+		SphereLod lod = sphereLod(level);
+		r64 ms = timeDraws(l, lod, drawsPerFrame, frames);
+		// strip vertices submitted, what the vertex stage processes without a post-transform cache
+		r64 mvertsPerSec = (r64)lod.numIndexes * drawsPerFrame / (ms * 1e-3) * 1e-6;
+
+		renderBall(l, lod, size, radius_px, pixels);
+		u32 off = 0;
+		u64 absDiff = 0;
+		for (u32 p = 0; p < numPixels; ++p) {
+			u32 maxDiff = 0;
+			for (u32 ch = 0; ch < 3; ++ch) {
+				u32 d = (u32)abs((int)pixels[p*4 + ch] - (int)reference[p*4 + ch]);
+				maxDiff = max(maxDiff, d);
+				absDiff += d;
+			}
+			off += (maxDiff > 8 ? 1 : 0);
+		}
+
+		printf("  %5u  %3ux%-3u  %6u  %7u  %9.3f  %8.2f  %12.2f  %9.3f%%  %13.4f\n",
+			   level, lod.cols, lod.rows, lodNumVerts(lod), lod.numIndexes, ms, mvertsPerSec,
+			   sphereLodError(level, radius_px),
+			   100.0 * off / numPixels,
+			   (r64)absDiff / (numPixels * 3));
+	}
+	unbindLayout(l);
+
+	free(reference);
+	free(pixels);
+}
+
+
+int main(
+	int argc,
+	char** argv)
+{
+	const char* mode = nullptr;
+	u32 drawsPerFrame = 200;
+	u32 frames = 20;
+	u32 size = 256;
+	u32 level = 1;
+	r32 radius_px = 0;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "m:n:f:s:l:r:")) != -1) {
+		switch (opt) {
+			case 'm': mode = optarg; break;
+			case 'n': drawsPerFrame = (u32)atoi(optarg); break;
+			case 'f': frames = (u32)atoi(optarg); break;
+			case 's': size = (u32)atoi(optarg); break;
+			case 'l': level = (u32)atoi(optarg); break;
+			case 'r': radius_px = (r32)atof(optarg); break;
+			default:
+				fprintf(stderr, "usage: %s [-m layout|lod] [-n draws per frame] [-f frames] [-s viewport size]\n"
+								"       [-l level for layout mode] [-r ball radius px for lod mode]\n", argv[0]);
+				return 1;
+		}
+	}
+	if (drawsPerFrame == 0 || frames == 0 || size == 0) {
+		fprintf(stderr, "-n, -f and -s must be above 0\n");
+		return 1;
+	}
+	if (level >= SPHERE_LOD_LEVELS) {
+		fprintf(stderr, "-l must be below %u\n", SPHERE_LOD_LEVELS);
+		return 1;
+	}
+	if (radius_px <= 0) {
+		radius_px = size * 0.45f;
+	}
+	bool runLayout = (!mode || strcmp(mode, "layout") == 0);
+	bool runLod = (!mode || strcmp(mode, "lod") == 0);
+
+	if (!initEGL(size)) {
+		return 1;
+	}
+	glViewport(0, 0, size, size);
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_CULL_FACE);
+
+	static u16 indexes[SPHERE_NUM_INDEXES];
+	for (u32 l = 0; l < SPHERE_LOD_LEVELS; ++l) {
+		makeSphereIndexes(indexes + sphereLodFirstIndex(l), l);
+	}
+	GLuint indexBuffer;
+	glGenBuffers(1, &indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indexes), indexes, GL_STATIC_DRAW);
+
+	Layout layouts[2] = {};
+	makeSoALayout(layouts[0]);
+	makePackedLayout(layouts[1]);
+	if (layouts[0].program == 0 || layouts[1].program == 0) {
+		return 1;
+	}
+
+	if (runLayout) {
+		runLayoutBench(layouts, level, drawsPerFrame, frames);
+	}
+	if (runLod) {
+		runLodBench(layouts[1], size, radius_px, drawsPerFrame, frames);
+	}
+
+	return 0;
+}
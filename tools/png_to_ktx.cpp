@@ -0,0 +1,376 @@
+/**
+ * Build step: converts PNG artwork to an ETC1 compressed KTX file with a full mip chain, so the
+ * display uploads it with glCompressedTexImage2D and never decodes an image on the device. Mip
+ * levels are 2x2 box filtered from the level above, each level is encoded block by block with an
+ * exhaustive search of the ETC1 modifier tables, both subblock orientations and both base color
+ * modes. Alpha is dropped, ETC1 is RGB only.
+ *
+ *	png_to_ktx.bin backup_adi.png backup_adi.ktx
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include "utility/common.h"
+#include "utility/image.h"
+#include "ktx.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#include "nanovg/src/stb_image.h"
+
+
+static const i32 etc1Modifiers[8][4] = {
+	{  2,   8,  -2,   -8 },
+	{  5,  17,  -5,  -17 },
+	{  9,  29,  -9,  -29 },
+	{ 13,  42, -13,  -42 },
+	{ 18,  60, -18,  -60 },
+	{ 24,  80, -24,  -80 },
+	{ 33, 106, -33, -106 },
+	{ 47, 183, -47, -183 }
+};
+
+
+struct Subblock {
+	u8		rgb[8][3];
+};
+
+
+/**
+ * Best table and per-pixel modifiers for one subblock around an expanded 8-bit base color.
+ */
+struct SubblockFit {
+	u32		error;
+	u32		table;
+	u8		modifier[8];
+};
+
+
+inline i32 clamp255(
+	i32 v)
+{
+	return (v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+
+SubblockFit fitSubblock(
+	const Subblock& sb,
+	const i32 base[3])
+{
+	SubblockFit best{};
+	best.error = UINT32_MAX;
+
+	for (u32 t = 0; t < 8; ++t) {
+		SubblockFit fit{};
+		fit.table = t;
+
+		for (u32 p = 0; p < 8; ++p) {
+			u32 pixelBest = UINT32_MAX;
+			for (u32 m = 0; m < 4; ++m) {
+				u32 err = 0;
+				for (u32 c = 0; c < 3; ++c) {
+					i32 d = clamp255(base[c] + etc1Modifiers[t][m]) - sb.rgb[p][c];
+					err += (u32)(d * d);
+				}
+				if (err < pixelBest) {
+					pixelBest = err;
+					fit.modifier[p] = (u8)m;
+				}
+			}
+			fit.error += pixelBest;
+		}
+
+		if (fit.error < best.error) {
+			best = fit;
+		}
+	}
+	return best;
+}
+
+
+inline i32 expand4(
+	i32 c)
+{
+	return (c << 4) | c;
+}
+
+
+inline i32 expand5(
+	i32 c)
+{
+	return (c << 3) | (c >> 2);
+}
+
+
+/**
+ * Base color candidates for a subblock, quantized to bits per channel: the mean, which suits
+ * smooth regions, and the midpoint of the range, which suits a line on a flat background.
+ */
+void baseCandidates(
+	const Subblock& sb,
+	u32 bits,
+	i32 out[2][3])
+{
+	i32 maxVal = (1 << bits) - 1;
+	for (u32 c = 0; c < 3; ++c) {
+		i32 sum = 0, lo = 255, hi = 0;
+		for (u32 p = 0; p < 8; ++p) {
+			sum += sb.rgb[p][c];
+			lo = min(lo, (i32)sb.rgb[p][c]);
+			hi = max(hi, (i32)sb.rgb[p][c]);
+		}
+		out[0][c] = (i32)lroundf((r32)sum / 8.0f * (r32)maxVal / 255.0f);
+		out[1][c] = (i32)lroundf((r32)(lo + hi) * 0.5f * (r32)maxVal / 255.0f);
+	}
+}
+
+
+struct BlockFit {
+	u32			error;
+	bool		diff;
+	bool		flip;
+	i32			color[2][3];	// quantized, 4 bits individual or 5 bits differential
+	SubblockFit	fit[2];
+};
+
+
+void fitIndividual(
+	const Subblock sb[2],
+	BlockFit& out)
+{
+	out.diff = false;
+	out.error = 0;
+	for (u32 s = 0; s < 2; ++s) {
+		i32 cands[2][3];
+		baseCandidates(sb[s], 4, cands);
+
+		SubblockFit best{};
+		best.error = UINT32_MAX;
+		for (u32 k = 0; k < 2; ++k) {
+			i32 base[3] = { expand4(cands[k][0]), expand4(cands[k][1]), expand4(cands[k][2]) };
+			SubblockFit fit = fitSubblock(sb[s], base);
+			if (fit.error < best.error) {
+				best = fit;
+				memcpy(out.color[s], cands[k], sizeof(out.color[s]));
+			}
+		}
+		out.fit[s] = best;
+		out.error += best.error;
+	}
+}
+
+
+void fitDifferential(
+	const Subblock sb[2],
+	BlockFit& out)
+{
+	out.diff = true;
+
+	i32 cands[2][2][3];
+	baseCandidates(sb[0], 5, cands[0]);
+	baseCandidates(sb[1], 5, cands[1]);
+
+	out.error = UINT32_MAX;
+	for (u32 k0 = 0; k0 < 2; ++k0) {
+		i32 base0[3] = { expand5(cands[0][k0][0]), expand5(cands[0][k0][1]), expand5(cands[0][k0][2]) };
+		SubblockFit fit0 = fitSubblock(sb[0], base0);
+
+		for (u32 k1 = 0; k1 < 2; ++k1) {
+			// second color is stored as a 3 bit signed delta from the first
+			i32 c1[3];
+			for (u32 c = 0; c < 3; ++c) {
+				i32 d = cands[1][k1][c] - cands[0][k0][c];
+				d = (d < -4 ? -4 : (d > 3 ? 3 : d));
+				c1[c] = cands[0][k0][c] + d;
+			}
+			i32 base1[3] = { expand5(c1[0]), expand5(c1[1]), expand5(c1[2]) };
+			SubblockFit fit1 = fitSubblock(sb[1], base1);
+
+			if (fit0.error + fit1.error < out.error) {
+				out.error = fit0.error + fit1.error;
+				out.fit[0] = fit0;
+				out.fit[1] = fit1;
+				memcpy(out.color[0], cands[0][k0], sizeof(out.color[0]));
+				memcpy(out.color[1], c1, sizeof(out.color[1]));
+			}
+		}
+	}
+}
+
+
+u64 packETC1Block(
+	const BlockFit& b)
+{
+	u64 bits = 0;
+	for (u32 c = 0; c < 3; ++c) {
+		u32 lsb = 56 - c * 8;		// R in bits 63-56, G in 55-48, B in 47-40
+		if (b.diff) {
+			bits |= (u64)b.color[0][c] << (lsb + 3);
+			bits |= (u64)((b.color[1][c] - b.color[0][c]) & 7) << lsb;
+		}
+		else {
+			bits |= (u64)b.color[0][c] << (lsb + 4);
+			bits |= (u64)b.color[1][c] << lsb;
+		}
+	}
+	bits |= (u64)b.fit[0].table << 37;
+	bits |= (u64)b.fit[1].table << 34;
+	bits |= (u64)(b.diff ? 1 : 0) << 33;
+	bits |= (u64)(b.flip ? 1 : 0) << 32;
+
+	for (u32 s = 0; s < 2; ++s) {
+		for (u32 p = 0; p < 8; ++p) {
+			u32 i = b.fit[s].modifier[p];
+			u32 x = (b.flip ? p % 4 : p % 2 + s * 2);
+			u32 y = (b.flip ? p / 4 + s * 2 : p / 2);
+			u32 bit = x * 4 + y;
+			bits |= (u64)(i >> 1) << (16 + bit);
+			bits |= (u64)(i & 1) << bit;
+		}
+	}
+	return bits;
+}
+
+
+/**
+ * Encodes the 4x4 block at bx, by of an RGB image, edge pixels are repeated past the border.
+ * Returns the summed squared error of the encoded block.
+ */
+u32 encodeETC1Block(
+	const u8* rgb,
+	u32 width,
+	u32 height,
+	u32 bx,
+	u32 by,
+	u8* out)
+{
+	BlockFit best{};
+	best.error = UINT32_MAX;
+
+	for (u32 flip = 0; flip < 2; ++flip) {
+		// flip 0: two 2x4 subblocks side by side, flip 1: two 4x2 subblocks stacked
+		Subblock sb[2];
+		for (u32 s = 0; s < 2; ++s) {
+			for (u32 p = 0; p < 8; ++p) {
+				u32 x = (flip ? p % 4 : p % 2 + s * 2);
+				u32 y = (flip ? p / 4 + s * 2 : p / 2);
+				u32 px = min(bx * 4 + x, width - 1);
+				u32 py = min(by * 4 + y, height - 1);
+				memcpy(sb[s].rgb[p], rgb + (py * width + px) * 3, 3);
+			}
+		}
+
+		BlockFit fits[2];
+		fitIndividual(sb, fits[0]);
+		fitDifferential(sb, fits[1]);
+		for (u32 f = 0; f < 2; ++f) {
+			fits[f].flip = (flip != 0);
+			if (fits[f].error < best.error) {
+				best = fits[f];
+			}
+		}
+	}
+
+	u64 bits = packETC1Block(best);
+	for (u32 b = 0; b < 8; ++b) {
+		out[b] = (u8)(bits >> (56 - b * 8));	// blocks are stored big endian
+	}
+	return best.error;
+}
+
+
+int main(
+	int argc,
+	char** argv)
+{
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s <in.png> <out.ktx>\n", argv[0]);
+		return 1;
+	}
+
+	int w, h, n;
+	u8* img = stbi_load(argv[1], &w, &h, &n, 3);
+	if (img == nullptr) {
+		fprintf(stderr, "%s: %s\n", argv[1], stbi_failure_reason());
+		return 1;
+	}
+
+	u32 numLevels = mipLevelCount((u32)w, (u32)h);
+	if (numLevels > KTX_MAX_LEVELS) {
+		fprintf(stderr, "%s: %dx%d is too large\n", argv[1], w, h);
+		return 1;
+	}
+
+	FILE* f = fopen(argv[2], "wb");
+	if (f == nullptr) {
+		fprintf(stderr, "could not write %s\n", argv[2]);
+		return 1;
+	}
+
+	KTXHeader header{};
+	memcpy(header.identifier, ktxIdentifier, sizeof(ktxIdentifier));
+	header.endianness = KTX_ENDIANNESS;
+	header.glTypeSize = 1;
+	header.glInternalFormat = KTX_GL_ETC1_RGB8_OES;
+	header.glBaseInternalFormat = KTX_GL_RGB;
+	header.pixelWidth = (u32)w;
+	header.pixelHeight = (u32)h;
+	header.numberOfFaces = 1;
+	header.numberOfMipmapLevels = numLevels;
+	fwrite(&header, sizeof(header), 1, f);
+
+	u8* level = img;
+	u32 lw = (u32)w, lh = (u32)h;
+	u64 totalBytes = sizeof(header);
+	r64 level0Error = 0;
+
+	for (u32 l = 0; l < numLevels; ++l) {
+		u32 imageSize = etc1ImageSize(lw, lh);
+		u8* blocks = (u8*)malloc(imageSize);
+		u32 blocksX = (lw + 3) / 4, blocksY = (lh + 3) / 4;
+
+		r64 error = 0;
+		for (u32 by = 0; by < blocksY; ++by) {
+			for (u32 bx = 0; bx < blocksX; ++bx) {
+				error += encodeETC1Block(level, lw, lh, bx, by,
+										 blocks + (by * blocksX + bx) * ETC1_BLOCK_BYTES);
+			}
+		}
+		if (l == 0) {
+			level0Error = error;
+		}
+
+		// image sizes are multiples of 8, no mip padding needed
+		fwrite(&imageSize, sizeof(imageSize), 1, f);
+		fwrite(blocks, imageSize, 1, f);
+		totalBytes += sizeof(imageSize) + imageSize;
+		free(blocks);
+
+		if (l + 1 < numLevels) {
+			u32 nw, nh;
+			u8* next = downsampleRGB(level, lw, lh, nw, nh);
+			if (level != img) {
+				free(level);
+			}
+			level = next;
+			lw = nw;
+			lh = nh;
+		}
+	}
+	if (level != img) {
+		free(level);
+	}
+
+	if (fclose(f) != 0) {
+		fprintf(stderr, "could not write %s\n", argv[2]);
+		return 1;
+	}
+
+	r64 mse = level0Error / ((r64)w * (r64)h * 3.0);
+	printf("%s: %dx%d ETC1, %u levels, %llu bytes (RGB level 0 alone %u bytes), level 0 PSNR %.1f dB\n",
+		   argv[2], w, h, numLevels, (unsigned long long)totalBytes, (u32)(w * h * 3),
+		   (mse > 0 ? 10.0 * log10(255.0 * 255.0 / mse) : 99.0));
+
+	stbi_image_free(img);
+	return 0;
+}
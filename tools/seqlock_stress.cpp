@@ -0,0 +1,160 @@
+/**
+ * Stress test for utility/seqlock.h: one thread publishes ADIValues as fast as it can, every word
+ * derived from a single counter, while the reader threads check that each snapshot they get is
+ * coherent, all words from the same publish, and that snapshots never go back in time. Exits
+ * non-zero on the first torn or out of order read.
+ *
+ *	seqlock_stress.bin [-t seconds] [-r reader threads]
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "utility/common.h"
+#include "utility/clock.h"
+#include "mqtt.h"
+
+
+SeqLock<ADIValues>	snapshot;
+std::atomic<bool>	running;
+
+
+/**
+ * Every word of the payload is a different function of c, so a snapshot mixing two publishes
+ * can't pass expected()
+ */
+ADIValues makeValues(
+	u32 c)
+{
+	ADIValues v;
+	v.rawPitch = c;
+	v.rawBank = c * 2654435761u;
+	v.rawTurn = ~c;
+	v.pitch_nsec = ((u64)c << 32) | (c ^ 0x5A5A5A5Au);
+	v.bank_nsec = ((u64)~c << 32) | (c * 40503u);
+	v.turn_nsec = (u64)c * 0x9E3779B97F4A7C15ull;
+	return v;
+}
+
+
+bool expected(
+	const ADIValues& v)
+{
+	ADIValues e = makeValues(v.rawPitch);
+	return memcmp(&e, &v, sizeof(ADIValues)) == 0;
+}
+
+
+struct ReaderResult {
+	u64		reads;
+	u64		retries;
+	u64		torn;
+	u64		backwards;
+};
+
+
+void writer(
+	u64* outWrites)
+{
+	u64 c = 0;
+	while (running.load(std::memory_order_relaxed)) {
+		++c;
+		seqlockWrite(snapshot, makeValues((u32)c));
+	}
+	*outWrites = c;
+}
+
+
+void reader(
+	ReaderResult* result)
+{
+	u32 lastCounter = 0;
+	u32 lastSeq = 0;
+	ADIValues v;
+
+	while (running.load(std::memory_order_relaxed)) {
+		u32 seq = 0;
+		if (!seqlockTryRead(snapshot, v, &seq)) {
+			++result->retries;
+			continue;
+		}
+		++result->reads;
+
+		// the zeroed payload before the first publish is the only one makeValues doesn't produce
+		if (seq != 0 && !expected(v)) {
+			if (result->torn++ == 0) {
+				fprintf(stderr, "torn read at seq %u: pitch %08x bank %08x turn %08x\n",
+						seq, v.rawPitch, v.rawBank, v.rawTurn);
+			}
+		}
+		// wrap safe, the sequence passes 2^31 after a minute or two of publishing
+		if ((i32)(seq - lastSeq) < 0 || (i32)(v.rawPitch - lastCounter) < 0) {
+			++result->backwards;
+		}
+		lastSeq = seq;
+		lastCounter = v.rawPitch;
+	}
+}
+
+
+int main(
+	int argc,
+	char** argv)
+{
+	r64 seconds = 2.0;
+	u32 numReaders = 2;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "t:r:")) != -1) {
+		switch (opt) {
+			case 't': seconds = atof(optarg); break;
+			case 'r': numReaders = (u32)atoi(optarg); break;
+			default:
+				fprintf(stderr, "usage: %s [-t seconds] [-r reader threads]\n", argv[0]);
+				return 1;
+		}
+	}
+	if (seconds <= 0.0 || numReaders == 0) {
+		fprintf(stderr, "-t and -r must be above 0\n");
+		return 1;
+	}
+
+	running.store(true);
+	u64 writes = 0;
+	std::vector<ReaderResult> results(numReaders, ReaderResult{});
+	std::vector<std::thread> readers;
+	for (u32 r = 0; r < numReaders; ++r) {
+		readers.emplace_back(reader, &results[r]);
+	}
+	std::thread writerThread(writer, &writes);
+
+	u64 end_nsec = monotonicNsec() + (u64)(seconds * 1e9);
+	while (monotonicNsec() < end_nsec) {
+		usleep(10000);
+	}
+	running.store(false);
+	writerThread.join();
+
+	ReaderResult total{};
+	for (u32 r = 0; r < numReaders; ++r) {
+		readers[r].join();
+		total.reads += results[r].reads;
+		total.retries += results[r].retries;
+		total.torn += results[r].torn;
+		total.backwards += results[r].backwards;
+	}
+
+	printf("seqlock: %llu writes, %u readers, %llu reads, %llu retries, %llu torn, %llu out of order\n",
+		   (unsigned long long)writes, numReaders, (unsigned long long)total.reads,
+		   (unsigned long long)total.retries, (unsigned long long)total.torn,
+		   (unsigned long long)total.backwards);
+
+	if (total.reads == 0) {
+		fprintf(stderr, "no snapshot was read, the test proved nothing\n");
+		return 1;
+	}
+	return (total.torn == 0 && total.backwards == 0) ? 0 : 1;
+}
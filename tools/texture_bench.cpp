@@ -0,0 +1,255 @@
+/**
+ * Fragment cost of the ball texture quality modes, drawn into an offscreen pbuffer.
+ *
+ * For every resolution tier and filter mode in texture.h, loads the ball artwork the way the
+ * display does (ETC1 KTX when the driver has it, else the PNG with generated mips), then draws
+ * the textured ball many times per frame with depth testing off, so every draw shades every
+ * covered pixel. The ball is tilted like the display's so its edges are minified. Reports GPU
+ * time per frame, textured pixels per second, and the cost relative to nearest at full size.
+ *
+ * Run from the repo root, or pass -t with the artwork path without its extension. On a software
+ * rasterizer like llvmpipe filtering is ALU work rather than texture cache traffic, so treat the
+ * numbers as relative and run it on the Pi for the real ones.
+ *
+ *	texture_bench.bin [-n draws per frame] [-f frames] [-s viewport size] [-t artwork]
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+#include <unistd.h>
+#include "utility/common.h"
+#include "utility/clock.h"
+#include "math/qmath.h"
+#include "sphere.h"
+#include "tools/bench_gl.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#include "nanovg/src/stb_image.h"
+#include "texture.h"
+#include "texture.cpp"
+
+#define BENCH_TIERS		3
+
+
+const char* vertexShader =
+	"#version 100\n"
+	"uniform mat3 rotation;"
+	"uniform float scale;"
+	"attribute vec3 vertexPosition;"
+	"attribute vec2 vertexUV;"
+	"varying vec2 uv;"
+	"void main() {"
+		"vec3 p = rotation * vertexPosition;"
+		"uv = vertexUV;"
+		"gl_Position = vec4(p.xy * scale, -p.z * 0.5, 1.0);"
+	"}";
+
+const char* fragmentShader =
+	"#version 100\n"
+	"precision mediump float;"
+	"uniform sampler2D diffuseTex;"
+	"varying vec2 uv;"
+	"void main() {"
+		"gl_FragColor = texture2D(diffuseTex, uv);"
+	"}";
+
+
+struct Ball {
+	GLuint		program;
+	GLuint		vertexBuffer;
+	GLuint		indexBuffer;
+	GLint		attrPosition;
+	GLint		attrUV;
+	GLint		unifRotation;
+	GLint		unifScale;
+	GLint		unifTex;
+	SphereLod	lod;
+};
+
+
+bool makeBall(
+	Ball& b)
+{
+	static SphereVertex verts[SPHERE_NUM_VERTS];
+	static u16 indexes[SPHERE_NUM_INDEXES];
+	makeSphereVertices(verts);
+	makeSphereIndexes(indexes, 0);
+	b.lod = sphereLod(0);
+
+	b.program = compileProgram(vertexShader, fragmentShader);
+	if (b.program == 0) {
+		return false;
+	}
+	b.attrPosition = glGetAttribLocation(b.program, "vertexPosition");
+	b.attrUV = glGetAttribLocation(b.program, "vertexUV");
+	b.unifRotation = glGetUniformLocation(b.program, "rotation");
+	b.unifScale = glGetUniformLocation(b.program, "scale");
+	b.unifTex = glGetUniformLocation(b.program, "diffuseTex");
+
+	glGenBuffers(1, &b.vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, b.vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &b.indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, b.indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(u16) * b.lod.numIndexes, indexes, GL_STATIC_DRAW);
+
+	glUseProgram(b.program);
+	glEnableVertexAttribArray(b.attrPosition);
+	glEnableVertexAttribArray(b.attrUV);
+	glVertexAttribPointer(b.attrPosition, 3, GL_SHORT, GL_TRUE, sizeof(SphereVertex),
+						  (const GLvoid*)offsetof(SphereVertex, x));
+	glVertexAttribPointer(b.attrUV, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(SphereVertex),
+						  (const GLvoid*)offsetof(SphereVertex, s));
+
+	// banked and pitched so the band curves away and its edges are minified, as on the display
+	mat4 rot = rotate(rotate(mat4{}, 30.0f * DEG_TO_RADf, vec3{ 0, 0, 1 }),
+					  200.0f * DEG_TO_RADf, vec3{ 1, 0, 0 });
+	mat3 rot3 = make_mat3(rot);
+	glUniformMatrix3fv(b.unifRotation, 1, GL_FALSE, rot3.E);
+	glUniform1f(b.unifScale, 0.9f);
+	glUniform1i(b.unifTex, 0);
+
+	return true;
+}
+
+
+void drawBall(
+	const Ball& b)
+{
+	glDrawElements(GL_TRIANGLE_STRIP, b.lod.numIndexes, GL_UNSIGNED_SHORT, (const GLvoid*)0);
+}
+
+
+/**
+ * Pixels one draw covers, read back from a single draw on a clear color the artwork never uses.
+ */
+u32 coveredPixels(
+	const Ball& b,
+	u32 size)
+{
+	u8* pixels = (u8*)malloc(size * size * 4);
+	glClearColor(1, 0, 1, 1);
+	glClear(GL_COLOR_BUFFER_BIT);
+	drawBall(b);
+	glClearColor(0, 0, 0, 1);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+	u32 covered = 0;
+	for (u32 p = 0; p < size * size; ++p) {
+		const u8* px = pixels + p * 4;
+		covered += !(px[0] == 255 && px[1] == 0 && px[2] == 255);
+	}
+	free(pixels);
+	return covered;
+}
+
+
+/**
+ * Mean milliseconds per frame, each frame finished with glFinish so GPU time is included.
+ */
+r64 timeDraws(
+	const Ball& b,
+	u32 drawsPerFrame,
+	u32 frames)
+{
+	u64 start_nsec = 0;
+	for (u32 f = 0; f < frames + 1; ++f) {
+		if (f == 1) {
+			start_nsec = monotonicNsec();	// frame 0 is warmup
+		}
+		glClear(GL_COLOR_BUFFER_BIT);
+		for (u32 d = 0; d < drawsPerFrame; ++d) {
+			drawBall(b);
+		}
+		glFinish();
+	}
+	return (r64)(monotonicNsec() - start_nsec) * 1e-6 / frames;
+}
+
+
+int main(
+	int argc,
+	char** argv)
+{
+	u32 drawsPerFrame = 10;
+	u32 frames = 5;
+	u32 size = 512;
+	const char* artwork = "backup_adi";
+
+	int opt;
+	while ((opt = getopt(argc, argv, "n:f:s:t:")) != -1) {
+		switch (opt) {
+			case 'n': drawsPerFrame = (u32)atoi(optarg); break;
+			case 'f': frames = (u32)atoi(optarg); break;
+			case 's': size = (u32)atoi(optarg); break;
+			case 't': artwork = optarg; break;
+			default:
+				fprintf(stderr, "usage: %s [-n draws per frame] [-f frames] [-s viewport size] [-t artwork]\n",
+						argv[0]);
+				return 1;
+		}
+	}
+	if (drawsPerFrame == 0 || frames == 0 || size == 0) {
+		fprintf(stderr, "-n, -f and -s must be above 0\n");
+		return 1;
+	}
+
+	char ktxFilename[512], pngFilename[512];
+	snprintf(ktxFilename, sizeof(ktxFilename), "%s.ktx", artwork);
+	snprintf(pngFilename, sizeof(pngFilename), "%s.png", artwork);
+
+	if (!initEGL(size)) {
+		return 1;
+	}
+	glViewport(0, 0, size, size);
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_CULL_FACE);
+
+	Ball ball{};
+	if (!makeBall(ball)) {
+		return 1;
+	}
+
+	u32 covered = coveredPixels(ball, size);
+	printf("texture: %u draws per frame, %u frames, %u pixels per draw\n",
+		   drawsPerFrame, frames, covered);
+	printf("  tier  size        filter         levels     bytes   ms/frame  Mtexels/s  vs nearest\n");
+
+	r64 baselineMs = 0;
+	for (u32 tier = 0; tier < BENCH_TIERS; ++tier) {
+		for (u32 f = 0; f < Filter_Count; ++f) {
+			TextureQuality quality{ (TextureFilter)f, tier, 4.0f };
+			Texture tex{};
+			if (!loadTexture(ktxFilename, pngFilename, quality, tex)) {
+				return 1;
+			}
+			glBindTexture(GL_TEXTURE_2D, tex.name);
+
+			r64 ms = timeDraws(ball, drawsPerFrame, frames);
+			if (tier == 0 && f == Filter_Nearest) {
+				baselineMs = ms;
+			}
+
+			char sizeText[16];
+			snprintf(sizeText, sizeof(sizeText), "%ux%u", tex.width, tex.height);
+			char filterText[24];
+			snprintf(filterText, sizeof(filterText), "%s%s", textureFilterName(quality.filter),
+					 (quality.filter != (TextureFilter)f ? "*" : ""));
+
+			printf("  %4u  %-10s  %-13s  %6u  %8u  %9.3f  %9.1f  %9.2fx\n",
+				   tier, sizeText, filterText, tex.levels, tex.bytes, ms,
+				   (r64)covered * drawsPerFrame / (ms * 1e-3) * 1e-6,
+				   ms / baselineMs);
+
+			glBindTexture(GL_TEXTURE_2D, 0);
+			freeTexture(tex);
+		}
+	}
+	printf("  * mode not supported by the driver, fell back to the one shown\n");
+
+	return 0;
+}
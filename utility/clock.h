@@ -0,0 +1,30 @@
+#ifndef _CLOCK_H
+#define _CLOCK_H
+
+#include <time.h>
+#include <cerrno>
+#include "types.h"
+
+/**
+ * CLOCK_MONOTONIC in nanoseconds. Safe to call from any thread, so timestamps taken on the network
+ * thread can be compared directly with the render loop's timer.
+ */
+inline u64 monotonicNsec()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec;
+}
+
+/**
+ * Sleep until monotonicNsec() reaches deadline_nsec. Absolute deadlines do not drift when the
+ * caller is preempted between computing the deadline and sleeping.
+ */
+inline void sleepUntilNsec(
+	u64 deadline_nsec)
+{
+	timespec ts{ (time_t)(deadline_nsec / 1000000000ULL), (long)(deadline_nsec % 1000000000ULL) };
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+}
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef _HISTOGRAM_H
+#define _HISTOGRAM_H
+
+#include "common.h"
+
+/**
+ * Fixed-size log-linear histogram in the style of HdrHistogram. Values below 2*HISTOGRAM_SUB_BUCKETS
+ * are counted exactly; above that each power of 2 is split into HISTOGRAM_SUB_BUCKETS linear
+ * buckets, so any recorded value is reported within 1/HISTOGRAM_SUB_BUCKETS (6.25%) of its true
+ * value. Covers the full u64 range with no allocation, recording is a clz and an increment.
+ */
+#define HISTOGRAM_SUB_BUCKET_BITS	4
+#define HISTOGRAM_SUB_BUCKETS		(1 << HISTOGRAM_SUB_BUCKET_BITS)
+#define HISTOGRAM_NUM_BUCKETS		((64 - HISTOGRAM_SUB_BUCKET_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+struct Histogram {
+	u32		counts[HISTOGRAM_NUM_BUCKETS];
+	u64		total;
+	u64		min;
+	u64		max;
+	r64		sum;
+};
+
+
+u32 histogramBucket(
+	u64 value)
+{
+	if (value < 2 * HISTOGRAM_SUB_BUCKETS) {
+		return (u32)value;
+	}
+	u32 msb = 63 - (u32)__builtin_clzll(value);
+	u32 shift = msb - HISTOGRAM_SUB_BUCKET_BITS;
+	u32 mantissa = (u32)(value >> shift);		// in [SUB_BUCKETS, 2*SUB_BUCKETS)
+	return (shift + 1) * HISTOGRAM_SUB_BUCKETS + (mantissa - HISTOGRAM_SUB_BUCKETS);
+}
+
+/**
+ * Largest value that falls into bucket.
+ */
+u64 histogramBucketValue(
+	u32 bucket)
+{
+	if (bucket < 2 * HISTOGRAM_SUB_BUCKETS) {
+		return bucket;
+	}
+	u32 shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+	u64 mantissa = bucket % HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BUCKETS;
+	return ((mantissa + 1) << shift) - 1;
+}
+
+
+void histogramReset(
+	Histogram& h)
+{
+	memset(h.counts, 0, sizeof(h.counts));
+	h.total = 0;
+	h.min = UINT64_MAX;
+	h.max = 0;
+	h.sum = 0;
+}
+
+
+void histogramRecord(
+	Histogram& h,
+	u64 value)
+{
+	++h.counts[histogramBucket(value)];
+	++h.total;
+	h.min = min(h.min, value);
+	h.max = max(h.max, value);
+	h.sum += (r64)value;
+}
+
+
+/**
+ * Value at percentile p (0-100), clamped to the exact recorded max. Returns 0 when empty.
+ */
+u64 histogramPercentile(
+	const Histogram& h,
+	r64 p)
+{
+	if (h.total == 0) {
+		return 0;
+	}
+
+	u64 rank = (u64)(p / 100.0 * (r64)h.total + 0.5);
+	rank = max(rank, (u64)1);
+
+	u64 seen = 0;
+	for (u32 b = 0; b < HISTOGRAM_NUM_BUCKETS; ++b) {
+		seen += h.counts[b];
+		if (seen >= rank) {
+			return min(histogramBucketValue(b), h.max);
+		}
+	}
+	return h.max;
+}
+
+
+r64 histogramMean(
+	const Histogram& h)
+{
+	return (h.total ? h.sum / (r64)h.total : 0);
+}
+
+
+#endif
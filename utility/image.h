@@ -0,0 +1,39 @@
+#ifndef _IMAGE_H
+#define _IMAGE_H
+
+#include <cstdlib>
+#include "common.h"
+
+/**
+ * Half size copy of a tightly packed RGB image from a 2x2 box filter, odd edges repeat their last
+ * pixel. Returns a malloc'd image the caller frees.
+ */
+inline u8* downsampleRGB(
+	const u8* rgb,
+	u32 width,
+	u32 height,
+	u32& outWidth,
+	u32& outHeight)
+{
+	outWidth = max(width / 2, (u32)1);
+	outHeight = max(height / 2, (u32)1);
+	u8* out = (u8*)malloc(outWidth * outHeight * 3);
+	if (out == nullptr) {
+		return nullptr;
+	}
+
+	for (u32 y = 0; y < outHeight; ++y) {
+		for (u32 x = 0; x < outWidth; ++x) {
+			u32 x0 = min(x * 2, width - 1), x1 = min(x * 2 + 1, width - 1);
+			u32 y0 = min(y * 2, height - 1), y1 = min(y * 2 + 1, height - 1);
+			for (u32 c = 0; c < 3; ++c) {
+				u32 sum = rgb[(y0 * width + x0) * 3 + c] + rgb[(y0 * width + x1) * 3 + c]
+						+ rgb[(y1 * width + x0) * 3 + c] + rgb[(y1 * width + x1) * 3 + c];
+				out[(y * outWidth + x) * 3 + c] = (u8)((sum + 2) / 4);
+			}
+		}
+	}
+	return out;
+}
+
+#endif
@@ -0,0 +1,325 @@
+#ifndef _LOG_H
+#define _LOG_H
+
+#include <atomic>
+#include <thread>
+#include <type_traits>
+#include <cstdio>
+#include <unistd.h>
+#include "common.h"
+#include "clock.h"
+
+/**
+ * Structured, asynchronous logging for hot paths. Call sites capture a static format string and up
+ * to LOG_MAX_ARGS typed arguments into a fixed-size record in a lock-free ring buffer; a background
+ * thread started by initLog formats and prints them. Logging never allocates, never makes a
+ * syscall and never blocks. When the ring is full the record is dropped and counted.
+ *
+ * Format strings use {} placeholders, one per argument, e.g.
+ *		logDebug("pitch={} at {}", val, now_nsec);
+ *
+ * Levels below LOG_LEVEL are compiled out entirely, arguments included.
+ */
+#define LOG_LEVEL_DEBUG		0
+#define LOG_LEVEL_INFO		1
+#define LOG_LEVEL_WARN		2
+#define LOG_LEVEL_ERROR		3
+#define LOG_LEVEL_NONE		4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL			LOG_LEVEL_INFO
+#endif
+
+#define LOG_RING_SIZE		1024	// records, power of 2
+#define LOG_MAX_ARGS		6
+#define LOG_TEXT_SIZE		96		// bytes of copied string argument data per record
+#define LOG_DRAIN_SLEEP_US	2000
+
+static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "LOG_RING_SIZE must be a power of 2");
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define logDebug(...)	logWrite(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define logDebug(...)	((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define logInfo(...)	logWrite(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define logInfo(...)	((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_WARN
+#define logWarn(...)	logWrite(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define logWarn(...)	((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define logError(...)	logWrite(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define logError(...)	((void)0)
+#endif
+
+
+enum LogArgType : u8 {
+	LogArg_I64 = 0,
+	LogArg_U64,
+	LogArg_R64,
+	LogArg_Str		// offset/length into LogRecord::text
+};
+
+struct LogArg {
+	union {
+		i64		i;
+		u64		u;
+		r64		f;
+		struct {
+			u16	offset;
+			u16	len;
+		} str;
+	};
+	LogArgType	type;
+};
+
+/**
+ * String argument with an explicit length, for data that is not NUL terminated.
+ */
+struct LogStr {
+	const char*	str;
+	u32			len;
+};
+
+inline LogStr logStr(const void* str, u32 len) { return LogStr{ (const char*)str, len }; }
+
+struct LogRecord {
+	std::atomic<u32>	seq;		// ring slot sequence, see logWrite/logDrain
+	u8					level;
+	u8					numArgs;
+	u16					textLen;
+	u64					nsec;
+	const char*			fmt;		// must have static storage duration
+	LogArg				args[LOG_MAX_ARGS];
+	char				text[LOG_TEXT_SIZE];
+};
+
+struct LogState {
+	LogRecord			ring[LOG_RING_SIZE];
+	std::atomic<u32>	writePos;
+	u32					readPos;	// consumer only
+	std::atomic<u32>	dropped;
+	std::atomic<bool>	running;
+	std::thread			drainThread;
+};
+
+LogState logState;
+
+
+// argument capture
+
+inline void logSetArg(LogRecord& r, LogArg& a, i64 v) { a.type = LogArg_I64; a.i = v; }
+inline void logSetArg(LogRecord& r, LogArg& a, u64 v) { a.type = LogArg_U64; a.u = v; }
+inline void logSetArg(LogRecord& r, LogArg& a, r64 v) { a.type = LogArg_R64; a.f = v; }
+inline void logSetArg(LogRecord& r, LogArg& a, i32 v) { logSetArg(r, a, (i64)v); }
+inline void logSetArg(LogRecord& r, LogArg& a, u32 v) { logSetArg(r, a, (u64)v); }
+inline void logSetArg(LogRecord& r, LogArg& a, r32 v) { logSetArg(r, a, (r64)v); }
+inline void logSetArg(LogRecord& r, LogArg& a, bool v) { logSetArg(r, a, (u64)v); }
+
+inline void logSetArg(
+	LogRecord& r,
+	LogArg& a,
+	LogStr s)
+{
+	u32 len = min(s.len, (u32)(LOG_TEXT_SIZE - r.textLen));
+	memcpy(r.text + r.textLen, s.str, len);
+	a.type = LogArg_Str;
+	a.str.offset = r.textLen;
+	a.str.len = (u16)len;
+	r.textLen += (u16)len;
+}
+
+inline void logSetArg(
+	LogRecord& r,
+	LogArg& a,
+	const char* s)
+{
+	u32 len = 0;
+	u32 maxLen = LOG_TEXT_SIZE - r.textLen;
+	while (len < maxLen && s[len]) {
+		++len;
+	}
+	logSetArg(r, a, LogStr{ s, len });
+}
+
+inline void logSetArg(LogRecord& r, LogArg& a, char* s) { logSetArg(r, a, (const char*)s); }
+
+// long / long long are distinct types from the fixed width typedefs on some platforms
+template <typename T>
+inline void logSetArg(LogRecord& r, LogArg& a, T v)
+{
+	static_assert(std::is_integral<T>::value, "unsupported log argument type");
+	if (std::is_signed<T>::value) {
+		logSetArg(r, a, (i64)v);
+	}
+	else {
+		logSetArg(r, a, (u64)v);
+	}
+}
+
+
+/**
+ * Multi-producer, single-consumer bounded ring (after Dmitry Vyukov's bounded MPMC queue). A slot
+ * is free for position p when its seq == p, and ready for the consumer when seq == p + 1.
+ */
+template <typename... Args>
+void logWrite(
+	u8 level,
+	const char* fmt,
+	Args... args)
+{
+	static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many log arguments, increase LOG_MAX_ARGS");
+
+	LogState& ls = logState;
+	u32 pos = ls.writePos.load(std::memory_order_relaxed);
+	LogRecord* r;
+
+	for (;;) {
+		r = &ls.ring[pos & (LOG_RING_SIZE - 1)];
+		u32 seq = r->seq.load(std::memory_order_acquire);
+		i32 diff = (i32)(seq - pos);
+		if (diff == 0) {
+			if (ls.writePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		}
+		else if (diff < 0) {
+			// ring is full
+			ls.dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		else {
+			pos = ls.writePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	r->level = level;
+	r->nsec = monotonicNsec();
+	r->fmt = fmt;
+	r->numArgs = (u8)sizeof...(Args);
+	r->textLen = 0;
+
+	u32 a = 0;
+	int expand[] = { 0, (logSetArg(*r, r->args[a++], args), 0)... };
+	(void)expand;
+	(void)a;
+
+	r->seq.store(pos + 1, std::memory_order_release);
+}
+
+
+// consumer side
+
+void logFormatRecord(
+	const LogRecord& r,
+	FILE* out)
+{
+	static const char* levelNames[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+
+	fprintf(out, "%llu.%06llu [%s] ",
+			(unsigned long long)(r.nsec / 1000000000ULL),
+			(unsigned long long)((r.nsec / 1000ULL) % 1000000ULL),
+			levelNames[r.level]);
+
+	u32 a = 0;
+	for (const char* c = r.fmt; *c; ++c) {
+		if (c[0] == '{' && c[1] == '}' && a < r.numArgs) {
+			const LogArg& arg = r.args[a++];
+			switch (arg.type) {
+				case LogArg_I64: fprintf(out, "%lld", (long long)arg.i); break;
+				case LogArg_U64: fprintf(out, "%llu", (unsigned long long)arg.u); break;
+				case LogArg_R64: fprintf(out, "%g", arg.f); break;
+				case LogArg_Str: fwrite(r.text + arg.str.offset, 1, arg.str.len, out); break;
+			}
+			++c;
+		}
+		else {
+			fputc(*c, out);
+		}
+	}
+	fputc('\n', out);
+}
+
+
+/**
+ * Print all ready records, returns the number printed. Only called from one thread at a time.
+ */
+u32 logDrain()
+{
+	LogState& ls = logState;
+	u32 count = 0;
+
+	for (;;) {
+		LogRecord& r = ls.ring[ls.readPos & (LOG_RING_SIZE - 1)];
+		if (r.seq.load(std::memory_order_acquire) != ls.readPos + 1) {
+			break;
+		}
+
+		logFormatRecord(r, (r.level >= LOG_LEVEL_WARN ? stderr : stdout));
+
+		r.seq.store(ls.readPos + LOG_RING_SIZE, std::memory_order_release);
+		++ls.readPos;
+		++count;
+	}
+
+	u32 dropped = ls.dropped.exchange(0, std::memory_order_relaxed);
+	if (dropped) {
+		fprintf(stderr, "log: %u records dropped, ring buffer full\n", dropped);
+	}
+	if (count || dropped) {
+		fflush(stdout);
+	}
+
+	return count;
+}
+
+
+void logDrainThread()
+{
+	while (logState.running.load(std::memory_order_relaxed)) {
+		if (logDrain() == 0) {
+			usleep(LOG_DRAIN_SLEEP_US);
+		}
+	}
+}
+
+
+void initLog()
+{
+	LogState& ls = logState;
+	for (u32 i = 0; i < LOG_RING_SIZE; ++i) {
+		ls.ring[i].seq.store(i, std::memory_order_relaxed);
+	}
+	ls.writePos.store(0, std::memory_order_relaxed);
+	ls.readPos = 0;
+	ls.dropped.store(0, std::memory_order_relaxed);
+	ls.running.store(true, std::memory_order_release);
+
+	ls.drainThread = std::thread(logDrainThread);
+}
+
+
+/**
+ * Stops the drain thread and prints anything still queued.
+ */
+void cleanupLog()
+{
+	LogState& ls = logState;
+	if (ls.drainThread.joinable()) {
+		ls.running.store(false, std::memory_order_relaxed);
+		ls.drainThread.join();
+		logDrain();
+	}
+}
+
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef _SEQLOCK_H
+#define _SEQLOCK_H
+
+#include <atomic>
+#include <type_traits>
+#include "common.h"
+
+/**
+ * Single-writer sequence lock for publishing a small POD snapshot from one thread to any number
+ * of readers. The writer never waits. Readers copy the payload and retry if the sequence was odd
+ * (write in progress) or changed during the copy, so a read never observes a torn value.
+ *
+ * The payload is stored as relaxed atomic words rather than a plain T so the racing copy made by
+ * readers is well defined under the C++11 memory model. Zero-initialized storage (e.g. a global)
+ * reads back as a zeroed T.
+ */
+template <typename T>
+struct SeqLock {
+	static_assert(std::is_trivially_copyable<T>::value, "SeqLock payload must be trivially copyable");
+
+	enum : u32 { NumWords = (sizeof(T) + sizeof(u32) - 1) / sizeof(u32) };
+
+	std::atomic<u32>	seq;
+	std::atomic<u32>	words[NumWords];
+};
+
+
+/**
+ * Publish value. Only one thread may write to a given SeqLock.
+ */
+template <typename T>
+void seqlockWrite(
+	SeqLock<T>& lock,
+	const T& value)
+{
+	u32 words[SeqLock<T>::NumWords] = {};
+	memcpy(words, &value, sizeof(T));
+
+	u32 seq = lock.seq.load(std::memory_order_relaxed);
+	lock.seq.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	for (u32 w = 0; w < SeqLock<T>::NumWords; ++w) {
+		lock.words[w].store(words[w], std::memory_order_relaxed);
+	}
+
+	lock.seq.store(seq + 2, std::memory_order_release);
+}
+
+
+/**
+ * Single read attempt, returns false if it raced with the writer and outValue was not written.
+ * outSeq receives the sequence number of the snapshot, which increases by 2 with every publish.
+ */
+template <typename T>
+bool seqlockTryRead(
+	const SeqLock<T>& lock,
+	T& outValue,
+	u32* outSeq = nullptr)
+{
+	u32 seq0 = lock.seq.load(std::memory_order_acquire);
+	if (seq0 & 1) {
+		return false;
+	}
+
+	u32 words[SeqLock<T>::NumWords];
+	for (u32 w = 0; w < SeqLock<T>::NumWords; ++w) {
+		words[w] = lock.words[w].load(std::memory_order_relaxed);
+	}
+
+	std::atomic_thread_fence(std::memory_order_acquire);
+	u32 seq1 = lock.seq.load(std::memory_order_relaxed);
+	if (seq0 != seq1) {
+		return false;
+	}
+
+	memcpy(&outValue, words, sizeof(T));
+	if (outSeq) {
+		*outSeq = seq0;
+	}
+	return true;
+}
+
+
+/**
+ * Read a coherent snapshot, retrying until the copy does not overlap a write. Returns the
+ * sequence number of the snapshot.
+ */
+template <typename T>
+u32 seqlockRead(
+	const SeqLock<T>& lock,
+	T& outValue)
+{
+	u32 seq = 0;
+	while (!seqlockTryRead(lock, outValue, &seq)) {}
+	return seq;
+}
+
+
+#endif